@@ -2,6 +2,8 @@
 
 #include "AM2301.h"
 
+#include "clock.h"
+
 static const char *TAG = "AM2301";
 
 AM2301::AM2301()
@@ -12,11 +14,11 @@ AM2301::~AM2301()
 {
 }
 
-void AM2301::setup(gpio_num_t pin, const char *temperature_topic, const char *humidity_topic, const char *status_topic,
-        const char *timestamp_topic, uint32_t measurement_period_ms)
+void AM2301::setup(gpio_num_t pin, pubsub::Topic<float> temperature_topic, pubsub::Topic<float> humidity_topic,
+        pubsub::Topic<int32_t> status_topic, pubsub::Topic<int64_t> timestamp_topic, uint32_t measurement_period_ms)
 {
-    ESP_LOGD(TAG, "setup, pin:%d, t:%s, rh:%s, status:%s, time:%s", pin, temperature_topic, humidity_topic, status_topic,
-            timestamp_topic);
+    ESP_LOGD(TAG, "setup, pin:%d, t:%d, rh:%d, status:%d, time:%d", pin, temperature_topic.get_handle(),
+            humidity_topic.get_handle(), status_topic.get_handle(), timestamp_topic.get_handle());
 
     if (state != COMPONENT_UNINITIALIZED) {
         state = COMPONENT_FATAL;
@@ -41,6 +43,11 @@ void AM2301::setup(gpio_num_t pin, const char *temperature_topic, const char *hu
     this->humidity_topic = humidity_topic;
     this->status_topic = status_topic;
     this->timestamp_topic = timestamp_topic;
+    if (!temperature_topic.valid() || !humidity_topic.valid() || !status_topic.valid() || !timestamp_topic.valid()) {
+        state = COMPONENT_FATAL;
+        ESP_LOGE(TAG, "setup, requires registered topics (FATAL)");
+        return;
+    }
 
     decoderQueue = xQueueCreate(NUMBER_OF_EDGES_IN_DATA_FRAME, sizeof(decoder_data_t));
     if (decoderQueue == 0) {
@@ -263,7 +270,7 @@ void AM2301::handle_instruction_edge_detected()
 void IRAM_ATTR AM2301::run()
 {
     while (true) {
-        if (xQueueReceive(decoderQueue, &decoderData, measurement_period_ms / portTICK_PERIOD_MS)) {
+        if (clock_receive(decoderQueue, &decoderData, CLOCK_MS(measurement_period_ms))) {
             if (decoderData.instruction == INSTRUCTION_EDGE_DETECTED) {
                 handle_instruction_edge_detected();
             } else if (decoderData.instruction == INSTRUCTION_START) {
@@ -294,22 +301,25 @@ void AM2301::frame_finished(int64_t frame, int64_t timestamp)
     uint8_t expectedChecksum = b4 + b3 + b2 + b1;
     if (actualChecksum == expectedChecksum) {
         // frame contains humidity times ten
-        double humidity = ((frame >> 24) & 0xFFFF) / 10.0;
+        float humidity = ((frame >> 24) & 0xFFFF) / 10.0f;
         // frame contains temperature times ten
-        double t = ((frame >> 8) & 0x7FFF) / 10.0;
+        float t = ((frame >> 8) & 0x7FFF) / 10.0f;
         // frame contains temperature sign as bit
         bool t_negative = (frame >> 8) & 0x8000;
         if (t_negative) {
-            t *= -1.0;
+            t = -t;
         }
-        double temperature = t + TEMPERATURE_C_TO_K;
+        float temperature = t + TEMPERATURE_C_TO_K;
 
         ESP_LOGD(TAG, "frame_finished, T:%.1fK, RH:%.1f%%", temperature, humidity);
 
-        pubsub_publish_double(temperature_topic, temperature);
-        pubsub_publish_double(humidity_topic, humidity);
-        pubsub_publish_int(timestamp_topic, timestamp);
-        pubsub_publish_int(status_topic, RESULT_OK);
+        // one sample, subscribers see all values together
+        pubsub::Batch batch;
+        batch.add(temperature_topic, temperature);
+        batch.add(humidity_topic, humidity);
+        batch.add(timestamp_topic, timestamp);
+        batch.add(status_topic, (int32_t) RESULT_OK);
+        batch.commit();
 
     } else {
         fire_recoverable(timestamp);
@@ -326,7 +336,7 @@ void AM2301::fire_recoverable(int64_t timestamp)
     if (state != COMPONENT_RECOVERABLE) {
         state = COMPONENT_RECOVERABLE;
 
-        pubsub_publish_int(status_topic, RESULT_RECOVERABLE);
+        status_topic.publish((int32_t) RESULT_RECOVERABLE);
     }
 }
 
@@ -13,7 +13,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
 
 /**
  * AM2301 temperature and relative humidity sensor.
@@ -28,14 +28,14 @@ public:
     /**
      * Setup once before use.
      * @param pin one wire (input/output) pin
-     * @param temperature_topic temperature measurement topic [double, K].
-     * @param humidity_topic humidity measurement topic [double, %].
-     * @param status_topic measurement status topic [int, result_status_t].
-     * @param timestamp_topic measurement timestamp topic [int, timt_t].
+     * @param temperature_topic temperature measurement topic [K].
+     * @param humidity_topic humidity measurement topic [%].
+     * @param status_topic measurement status topic [result_status_t].
+     * @param timestamp_topic measurement timestamp topic [us since boot].
      * @param measurement_period_ms measurement period [ms].
      */
-    void setup(gpio_num_t pin, const char *temperature_topic, const char *humidity_topic, const char *status_topic,
-            const char *timestamp_topic, uint32_t measurement_period_ms);
+    void setup(gpio_num_t pin, pubsub::Topic<float> temperature_topic, pubsub::Topic<float> humidity_topic,
+            pubsub::Topic<int32_t> status_topic, pubsub::Topic<int64_t> timestamp_topic, uint32_t measurement_period_ms);
 
     typedef enum
     {
@@ -108,19 +108,19 @@ private:
     /**
      * Temperature measurement topic.
      */
-    const char *temperature_topic = 0;
+    pubsub::Topic<float> temperature_topic;
     /**
      * Humidity measurement topic.
      */
-    const char *humidity_topic = 0;
+    pubsub::Topic<float> humidity_topic;
     /**
      * Measurement status topic.
      */
-    const char *status_topic = 0;
+    pubsub::Topic<int32_t> status_topic;
     /**
      * Measurement timestamp topic.
      */
-    const char *timestamp_topic = 0;
+    pubsub::Topic<int64_t> timestamp_topic;
 
     // timestamp of previous edge detected
     int64_t previousTimestamp = 0;
@@ -150,7 +150,7 @@ private:
     void one_wire_start();
     void one_wire_listen();
 
-    static constexpr float TEMPERATURE_C_TO_K = 273.15;
+    static constexpr float TEMPERATURE_C_TO_K = 273.15f;
     static constexpr int NUMBER_OF_EDGES_IN_DATA_FRAME = 100;
     static constexpr int MICRO_PER_MILLI = 1000;
 
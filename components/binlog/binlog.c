@@ -0,0 +1,257 @@
+// The author disclaims copyright to this source code.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "binlog.h"
+#include "clock.h"
+
+static const char *TAG = "binlog";
+
+#define BINLOG_MASK (BINLOG_RECORDS - 1)
+#define BINLOG_DRAIN_PERIOD pdMS_TO_TICKS(CONFIG_BINLOG_DRAIN_PERIOD_MS)
+/** Formatted record length, longer lines are truncated */
+#define BINLOG_LINE_SIZE 160
+
+_Static_assert((BINLOG_RECORDS & BINLOG_MASK) == 0, "BINLOG_RECORDS is a power of two");
+
+/*
+ * Ring
+ *
+ * Bounded queue with a sequence per slot, any task or ISR writes, the drain task reads.
+ * A slot is free for position pos when its sequence is pos,
+ * filled when pos + 1, and free again for pos + BINLOG_RECORDS after reading.
+ * A writer claims a position with compare and swap, never waits,
+ * drops the record when the ring is full.
+ */
+
+/** Ring slot */
+typedef struct
+{
+    atomic_uint sequence;
+    binlog_record_t record;
+} binlog_slot_t;
+
+static binlog_slot_t binlog_ring[BINLOG_RECORDS];
+/** next write position */
+static atomic_uint binlog_head;
+/** next read position, drain task only */
+static unsigned int binlog_tail;
+/** records dropped, ring full */
+static atomic_uint binlog_dropped_count;
+
+/**
+ * Log record, lock free, also from ISR.
+ * Before binlog_initialize records are dropped.
+ * @return false if dropped.
+ */
+bool binlog_write(const binlog_format_t *format, const binlog_arg_t *args, size_t count)
+{
+    int64_t time = clock_now();
+    unsigned int pos = atomic_load_explicit(&binlog_head, memory_order_relaxed);
+    binlog_slot_t *slot;
+    while (true) {
+        slot = &binlog_ring[pos & BINLOG_MASK];
+        unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int difference = (int) (sequence - pos);
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&binlog_head, &pos, pos + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            atomic_fetch_add_explicit(&binlog_dropped_count, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&binlog_head, memory_order_relaxed);
+        }
+    }
+    if (count > BINLOG_MAX_ARGS) {
+        count = BINLOG_MAX_ARGS;
+    }
+    slot->record.time = time;
+    slot->record.format = format;
+    slot->record.count = count;
+    for (int index = 0; index < count; index++) {
+        slot->record.args[index] = args[index];
+    }
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Take oldest record, single reader.
+ * @return false if ring empty.
+ */
+bool binlog_read(binlog_record_t *record)
+{
+    binlog_slot_t *slot = &binlog_ring[binlog_tail & BINLOG_MASK];
+    unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != binlog_tail + 1) {
+        return false;
+    }
+    *record = slot->record;
+    atomic_store_explicit(&slot->sequence, binlog_tail + BINLOG_RECORDS, memory_order_release);
+    binlog_tail++;
+    return true;
+}
+
+/**
+ * Format one conversion specification with one argument.
+ * @return characters written (as snprintf).
+ */
+static int binlog_format_arg(char *buffer, size_t size, const char *spec, size_t spec_length, const binlog_arg_t *arg)
+{
+    // conversion without length modifiers, rebuilt with the modifier of the argument type
+    char conversion = spec[spec_length - 1];
+    size_t length = spec_length - 1;
+    while (length > 1 && strchr("hlLzjt", spec[length - 1]) != NULL) {
+        length--;
+    }
+    char format[16];
+    if (length > sizeof(format) - 4) {
+        return snprintf(buffer, size, "%.*s", (int) spec_length, spec);
+    }
+    memcpy(format, spec, length);
+    if (strchr("diouxX", conversion) != NULL) {
+        format[length] = 'l';
+        format[length + 1] = 'l';
+        format[length + 2] = conversion;
+        format[length + 3] = 0;
+        if (strchr("di", conversion) != NULL) {
+            return snprintf(buffer, size, format, (long long) arg->int_val);
+        }
+        return snprintf(buffer, size, format, (unsigned long long) arg->int_val);
+    }
+    format[length] = conversion;
+    format[length + 1] = 0;
+    if (conversion == 'c') {
+        return snprintf(buffer, size, format, (int) arg->int_val);
+    } else if (strchr("fFeEgGaA", conversion) != NULL) {
+        return snprintf(buffer, size, format, arg->double_val);
+    } else if (conversion == 's') {
+        return snprintf(buffer, size, format, arg->string_val != NULL ? arg->string_val : "(null)");
+    } else if (conversion == 'p') {
+        return snprintf(buffer, size, format, arg->pointer_val);
+    }
+    return snprintf(buffer, size, "%.*s", (int) spec_length, spec);
+}
+
+/**
+ * Format record message, each conversion takes the next argument.
+ * @return length of message in buffer.
+ */
+size_t binlog_format(const binlog_record_t *record, char *buffer, size_t size)
+{
+    const char *format = record->format->format;
+    size_t used = 0;
+    int arg = 0;
+    buffer[0] = 0;
+    while (*format != 0 && used + 1 < size) {
+        if (*format != '%') {
+            buffer[used++] = *format++;
+            continue;
+        }
+        if (format[1] == '%') {
+            buffer[used++] = '%';
+            format += 2;
+            continue;
+        }
+        // specification up to and including the conversion character
+        size_t spec_length = 1;
+        while (format[spec_length] != 0 && strchr("diouxXcfFeEgGaAsp", format[spec_length]) == NULL) {
+            spec_length++;
+        }
+        if (format[spec_length] == 0) {
+            break;
+        }
+        spec_length++;
+        int written;
+        if (arg < record->count) {
+            written = binlog_format_arg(buffer + used, size - used, format, spec_length, &record->args[arg++]);
+        } else {
+            written = snprintf(buffer + used, size - used, "?");
+        }
+        if (written > 0) {
+            used += written;
+        }
+        if (used >= size) {
+            used = size - 1;
+        }
+        format += spec_length;
+    }
+    buffer[used] = 0;
+    return used;
+}
+
+static char binlog_level_letter(esp_log_level_t level)
+{
+    if (level == ESP_LOG_ERROR) {
+        return 'E';
+    } else if (level == ESP_LOG_WARN) {
+        return 'W';
+    } else if (level == ESP_LOG_INFO) {
+        return 'I';
+    } else if (level == ESP_LOG_DEBUG) {
+        return 'D';
+    }
+    return 'V';
+}
+
+/**
+ * Format and write all records to the console, drain task only.
+ */
+void binlog_flush()
+{
+    static char line[BINLOG_LINE_SIZE];
+    binlog_record_t record;
+    while (binlog_read(&record)) {
+        const binlog_format_t *format = record.format;
+        binlog_format(&record, line, sizeof(line));
+        esp_log_write(format->level, *format->tag, "%c (%u) %s: %s\n", binlog_level_letter(format->level),
+                (uint32_t) (record.time / 1000), *format->tag, line);
+    }
+}
+
+uint32_t binlog_dropped()
+{
+    return atomic_load(&binlog_dropped_count);
+}
+
+static void binlog_task(void *pvParameter)
+{
+    uint32_t dropped_logged = 0;
+    while (true) {
+        binlog_flush();
+        uint32_t dropped = binlog_dropped();
+        if (dropped != dropped_logged) {
+            ESP_LOGW(TAG, "binlog_task, dropped:%u", dropped - dropped_logged);
+            dropped_logged = dropped;
+        }
+        vTaskDelay(BINLOG_DRAIN_PERIOD);
+    }
+}
+
+/**
+ * Prepare ring and start the drain task, before any other component logs.
+ */
+void binlog_initialize()
+{
+    for (unsigned int pos = 0; pos < BINLOG_RECORDS; pos++) {
+        atomic_store(&binlog_ring[pos].sequence, pos);
+    }
+    binlog_tail = 0;
+    atomic_store(&binlog_dropped_count, 0);
+    atomic_store(&binlog_head, 0);
+
+    BaseType_t ret = xTaskCreate(&binlog_task, TAG, 2048, NULL, tskIDLE_PRIORITY + 1, NULL);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "binlog_initialize, failed to create task (FATAL)");
+    }
+}
@@ -0,0 +1,122 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _BINLOG_H_
+#define _BINLOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+/**
+ * Binary log.
+ * Hot path logging stores a record (time, format, raw arguments) in a lock free ring,
+ * the drain task formats records and writes them to the console later.
+ * A record costs a few stores instead of printf and UART time on the logging task.
+ *
+ * Usage: BINLOG_I(TAG, "decode, co2:%d [ppm]", binlog_int(ppm)), TAG is a tag variable.
+ * - the format is a string literal, its conversion selects the argument member
+ *   (d i u x X o c: int, f e g: double, s: string, p: pointer),
+ * - %s arguments must stay valid until drained (literals, interned topic names).
+ */
+
+/** Records in the ring */
+#define BINLOG_RECORDS CONFIG_BINLOG_RECORDS
+/** Maximum arguments per record */
+#define BINLOG_MAX_ARGS 4
+
+/**
+ * Format descriptor, static per log statement, its address is the format id.
+ * The tag is referenced through the tag variable (static const char *TAG),
+ * keeps the descriptor a constant initializer.
+ */
+typedef struct
+{
+    esp_log_level_t level;
+    const char *const *tag;
+    const char *format;
+} binlog_format_t;
+
+/** Raw argument */
+typedef union
+{
+    int64_t int_val;
+    double double_val;
+    const char *string_val;
+    const void *pointer_val;
+} binlog_arg_t;
+
+/** Drained record */
+typedef struct
+{
+    /** time of logging [us] */
+    int64_t time;
+    const binlog_format_t *format;
+    uint8_t count;
+    binlog_arg_t args[BINLOG_MAX_ARGS];
+} binlog_record_t;
+
+static inline binlog_arg_t binlog_int(int64_t value)
+{
+    binlog_arg_t arg;
+    arg.int_val = value;
+    return arg;
+}
+
+static inline binlog_arg_t binlog_double(double value)
+{
+    binlog_arg_t arg;
+    arg.double_val = value;
+    return arg;
+}
+
+static inline binlog_arg_t binlog_string(const char *value)
+{
+    binlog_arg_t arg;
+    arg.string_val = value;
+    return arg;
+}
+
+static inline binlog_arg_t binlog_pointer(const void *value)
+{
+    binlog_arg_t arg;
+    arg.pointer_val = value;
+    return arg;
+}
+
+/**
+ * Log with level, compiled out above LOG_LOCAL_LEVEL, runtime level applied when drained.
+ * At least one argument, at most BINLOG_MAX_ARGS.
+ */
+#define BINLOG(level, tag, format, ...) \
+    do { \
+        if (LOG_LOCAL_LEVEL >= (level)) { \
+            static const binlog_format_t binlog_format_ = { (level), &(tag), (format) }; \
+            const binlog_arg_t binlog_args_[] = { __VA_ARGS__ }; \
+            binlog_write(&binlog_format_, binlog_args_, sizeof(binlog_args_) / sizeof(binlog_args_[0])); \
+        } \
+    } while (0)
+
+#define BINLOG_E(tag, format, ...) BINLOG(ESP_LOG_ERROR, tag, format, __VA_ARGS__)
+#define BINLOG_W(tag, format, ...) BINLOG(ESP_LOG_WARN, tag, format, __VA_ARGS__)
+#define BINLOG_I(tag, format, ...) BINLOG(ESP_LOG_INFO, tag, format, __VA_ARGS__)
+#define BINLOG_D(tag, format, ...) BINLOG(ESP_LOG_DEBUG, tag, format, __VA_ARGS__)
+
+extern void binlog_initialize();
+extern bool binlog_write(const binlog_format_t *format, const binlog_arg_t *args, size_t count);
+extern bool binlog_read(binlog_record_t *record);
+extern size_t binlog_format(const binlog_record_t *record, char *buffer, size_t size);
+extern void binlog_flush();
+extern uint32_t binlog_dropped();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BINLOG_H_ */
@@ -0,0 +1,254 @@
+// The author disclaims copyright to this source code.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "clock.h"
+
+/** Tick period [us] */
+#define CLOCK_TICK_US ((int64_t) portTICK_PERIOD_MS * 1000)
+
+#ifdef CONFIG_CLOCK_SIMULATION
+
+static const char *TAG = "clock";
+
+/*
+ * Simulated clock
+ *
+ * A task waiting on the clock blocks without timeout, its entry holds the end of the wait.
+ * clock_advance aborts the block (xTaskAbortDelay) of each wait that passed its end,
+ * the blocking call returns as on a timeout.
+ * Tasks are registered on their first wait, advancing waits until all of them are blocked,
+ * so a task woken by the clock or by a publish runs to its next wait at the same simulated time.
+ */
+
+/** Task waiting on the simulated clock */
+typedef struct
+{
+    TaskHandle_t task;
+    /** end of the current wait [us], CLOCK_FOREVER if none */
+    int64_t wakeup;
+} clock_task_t;
+
+static bool clock_simulated;
+static _Atomic int64_t clock_simulated_time;
+static clock_task_t clock_tasks[CONFIG_CLOCK_MAX_TASKS];
+static int clock_task_count;
+static portMUX_TYPE clock_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Entry of the calling task, registered on its first wait.
+ * Only called in the critical section.
+ * @return NULL if all entries are taken.
+ */
+static clock_task_t* clock_current_task()
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (int index = 0; index < clock_task_count; index++) {
+        if (clock_tasks[index].task == task) {
+            return &clock_tasks[index];
+        }
+    }
+    if (clock_task_count == CONFIG_CLOCK_MAX_TASKS) {
+        return NULL;
+    }
+    clock_task_t *entry = &clock_tasks[clock_task_count++];
+    entry->task = task;
+    entry->wakeup = CLOCK_FOREVER;
+    return entry;
+}
+
+/**
+ * @return true if all tasks waiting on the clock, except the caller, are blocked.
+ */
+static bool clock_quiet()
+{
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&clock_spinlock);
+    int count = clock_task_count;
+    portEXIT_CRITICAL(&clock_spinlock);
+    for (int index = 0; index < count; index++) {
+        if (clock_tasks[index].task != current) {
+            eTaskState state = eTaskGetState(clock_tasks[index].task);
+            if (state == eReady || state == eRunning) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Let tasks waiting on the clock run until they are blocked again.
+ * Immediate when the caller has the lowest priority.
+ */
+static void clock_settle()
+{
+    while (!clock_quiet()) {
+        vTaskDelay(1);
+    }
+}
+
+/**
+ * Abort the block of waits that passed their end.
+ * @return number of aborted waits.
+ */
+static int clock_wake()
+{
+    TaskHandle_t woken[CONFIG_CLOCK_MAX_TASKS];
+    int count = 0;
+    portENTER_CRITICAL(&clock_spinlock);
+    int64_t now = atomic_load(&clock_simulated_time);
+    for (int index = 0; index < clock_task_count; index++) {
+        if (clock_tasks[index].wakeup <= now) {
+            woken[count++] = clock_tasks[index].task;
+        }
+    }
+    portEXIT_CRITICAL(&clock_spinlock);
+    for (int index = 0; index < count; index++) {
+        xTaskAbortDelay(woken[index]);
+    }
+    return count;
+}
+
+void clock_simulate(int64_t start)
+{
+    ESP_LOGI(TAG, "clock_simulate, start:%lldus", start);
+    atomic_store(&clock_simulated_time, start);
+    clock_simulated = true;
+}
+
+void clock_advance(int64_t duration)
+{
+    atomic_fetch_add(&clock_simulated_time, duration);
+    // a wait can end before its task blocked, abort again until it did end
+    while (clock_wake() > 0) {
+        clock_settle();
+    }
+    clock_settle();
+}
+
+int64_t clock_next_wakeup()
+{
+    int64_t next = CLOCK_FOREVER;
+    portENTER_CRITICAL(&clock_spinlock);
+    for (int index = 0; index < clock_task_count; index++) {
+        if (clock_tasks[index].wakeup < next) {
+            next = clock_tasks[index].wakeup;
+        }
+    }
+    portEXIT_CRITICAL(&clock_spinlock);
+    return next;
+}
+
+void clock_run_until(int64_t end)
+{
+    clock_settle();
+    int64_t now = clock_now();
+    while (now < end) {
+        int64_t next = clock_next_wakeup();
+        if (next > end) {
+            next = end;
+        }
+        clock_advance(next > now ? next - now : 0);
+        now = clock_now();
+    }
+}
+
+#endif
+
+/**
+ * @return ticks to block for timeout [us], rounded up, a wait never ends early.
+ */
+static TickType_t clock_ticks(int64_t timeout)
+{
+    if (timeout <= 0) {
+        return 0;
+    }
+    if (timeout == CLOCK_FOREVER) {
+        return portMAX_DELAY;
+    }
+    int64_t ticks = (timeout + CLOCK_TICK_US - 1) / CLOCK_TICK_US;
+    return ticks < portMAX_DELAY ? (TickType_t) ticks : portMAX_DELAY - 1;
+}
+
+int64_t clock_now()
+{
+#ifdef CONFIG_CLOCK_SIMULATION
+    if (clock_simulated) {
+        return atomic_load(&clock_simulated_time);
+    }
+#endif
+    return esp_timer_get_time();
+}
+
+TickType_t clock_wait_begin(int64_t timeout)
+{
+#ifdef CONFIG_CLOCK_SIMULATION
+    if (clock_simulated && timeout > 0) {
+        portENTER_CRITICAL(&clock_spinlock);
+        clock_task_t *entry = clock_current_task();
+        if (entry != NULL) {
+            entry->wakeup = timeout == CLOCK_FOREVER ? CLOCK_FOREVER : atomic_load(&clock_simulated_time) + timeout;
+        }
+        portEXIT_CRITICAL(&clock_spinlock);
+        if (entry != NULL) {
+            // clock_advance ends the wait
+            return portMAX_DELAY;
+        }
+        ESP_LOGE(TAG, "clock_wait_begin, more than %d tasks, waits in real time", CONFIG_CLOCK_MAX_TASKS);
+    }
+#endif
+    return clock_ticks(timeout);
+}
+
+void clock_wait_end()
+{
+#ifdef CONFIG_CLOCK_SIMULATION
+    if (clock_simulated) {
+        portENTER_CRITICAL(&clock_spinlock);
+        clock_task_t *entry = clock_current_task();
+        if (entry != NULL) {
+            entry->wakeup = CLOCK_FOREVER;
+        }
+        portEXIT_CRITICAL(&clock_spinlock);
+    }
+#endif
+}
+
+void clock_delay(int64_t duration)
+{
+#ifdef CONFIG_CLOCK_SIMULATION
+    if (clock_simulated) {
+        int64_t end = clock_now() + duration;
+        for (int64_t remaining = duration; remaining > 0; remaining = end - clock_now()) {
+            vTaskDelay(clock_wait_begin(remaining));
+            clock_wait_end();
+        }
+        return;
+    }
+#endif
+    vTaskDelay(clock_ticks(duration));
+}
+
+BaseType_t clock_receive(QueueHandle_t queue, void *item, int64_t timeout)
+{
+    BaseType_t received = xQueueReceive(queue, item, clock_wait_begin(timeout));
+    clock_wait_end();
+    return received;
+}
+
+BaseType_t clock_notify_wait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, int64_t timeout)
+{
+    BaseType_t notified = xTaskNotifyWait(clear_on_entry, clear_on_exit, value, clock_wait_begin(timeout));
+    clock_wait_end();
+    return notified;
+}
@@ -0,0 +1,87 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+/**
+ * Clock of all components: the time, delays and timeouts of waits.
+ *
+ * The real clock is esp_timer_get_time, waits block for FreeRTOS ticks.
+ * The simulated clock (CONFIG_CLOCK_SIMULATION) only moves on clock_advance or clock_run_until,
+ * a wait ends when the simulated time passes its end, a simulated day takes milliseconds.
+ *
+ * Times and durations are in us. Interrupt timing, e.g. AM2301 bit decoding,
+ * and CPU time measurements stay on esp_timer_get_time.
+ */
+
+/** Timeout of a wait without end */
+#define CLOCK_FOREVER INT64_MAX
+
+/** Duration of ms [us] */
+#define CLOCK_MS(ms) ((int64_t) (ms) * 1000)
+
+/** @return time since start [us], monotonic, also from ISR */
+int64_t clock_now();
+
+/** Block the calling task for duration [us] */
+void clock_delay(int64_t duration);
+
+/** xQueueReceive with timeout [us] */
+BaseType_t clock_receive(QueueHandle_t queue, void *item, int64_t timeout);
+
+/** xTaskNotifyWait with timeout [us] */
+BaseType_t clock_notify_wait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, int64_t timeout);
+
+/**
+ * Wrap another blocking FreeRTOS call, e.g. pubsub_receive:
+ *     BaseType_t received = pubsub_receive(queue, &message, clock_wait_begin(timeout));
+ *     clock_wait_end();
+ * @return ticks to block for timeout [us], the simulated clock ends the wait itself.
+ */
+TickType_t clock_wait_begin(int64_t timeout);
+
+/** End of the wait started by clock_wait_begin */
+void clock_wait_end();
+
+#ifdef CONFIG_CLOCK_SIMULATION
+
+/**
+ * Switch to the simulated clock at time start [us], before tasks wait on the clock.
+ * Start after 0 as esp_timer_get_time after boot, pubsub takes time 0 as no change.
+ */
+void clock_simulate(int64_t start);
+
+/**
+ * Advance the simulated clock by duration [us], step by step.
+ * Ends the waits that passed their end, returns when the woken tasks wait again.
+ */
+void clock_advance(int64_t duration);
+
+/** @return end of the earliest wait [us], CLOCK_FOREVER if none */
+int64_t clock_next_wakeup();
+
+/**
+ * Run as fast as possible until time end [us]: jump from wait end to wait end,
+ * each time after all tasks waiting on the clock are blocked again.
+ */
+void clock_run_until(int64_t end);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CLOCK_H_ */
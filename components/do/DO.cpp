@@ -12,47 +12,46 @@ DO::~DO()
 {
 }
 
-void DO::setup(gpio_num_t pin, bool active_high, const char *topic)
+void DO::setup(gpio_num_t pin, bool active_high, pubsub::Topic<bool> topic)
 {
-    ESP_LOGD(TAG, "setup, pin:%d, topic:%s, active_high:%s", pin, topic, active_high ? "true" : "false");
+    ESP_LOGD(TAG, "setup, pin:%d, topic:%d, active_high:%s", pin, topic.get_handle(), active_high ? "true" : "false");
 
     if (pin < GPIO_NUM_0 || pin >= GPIO_NUM_MAX) {
         ESP_LOGE(TAG, "setup requires GPIO pin number (FATAL)");
         return;
     }
-    if (topic == 0) {
+    if (!topic.valid()) {
         ESP_LOGE(TAG, "setup requires topic (FATAL)");
         return;
     }
 
-    // big queue not useful
-    QueueHandle_t queue = xQueueCreate(10, sizeof(pubsub_message_t));
-    if (queue == 0) {
+    // coalesced, at most one message queued, actuator output delivered before display subscribers
+    if (!subscription.create(1, PUBSUB_PRIORITY_HIGH)) {
         ESP_LOGE(TAG, "setup, failed to create queue (FATAL)");
         return;
     }
 
     this->pin = pin;
     this->active_high = active_high;
-    this->queue = queue;
 
     gpio_pad_select_gpio(pin);
     gpio_set_direction(pin, GPIO_MODE_OUTPUT);
-    BaseType_t ret = xTaskCreate(&task, TAG, 2048, this, (tskIDLE_PRIORITY + 1), NULL);
+    // above the ctrl and display tasks
+    BaseType_t ret = xTaskCreate(&task, TAG, 2048, this, (tskIDLE_PRIORITY + 3), NULL);
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "setup, failed to create task (FATAL)");
     }
 
     // need pin to output initial value
-    pubsub_add_subscription(queue, topic, true);
+    subscription.add(topic, true, PUBSUB_DELIVERY_COALESCE);
 }
 
 void DO::run()
 {
-    pubsub_message_t message;
+    bool active;
     while (true) {
-        if (xQueueReceive(queue, &message, portMAX_DELAY)) {
-            write(message.boolean_val);
+        if (subscription.receive(&active, portMAX_DELAY)) {
+            write(active);
         }
     };
 }
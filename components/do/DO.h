@@ -10,7 +10,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
 
 /**
  * Digital output.
@@ -27,12 +27,12 @@ public:
      * @param active_high true if active high output
      * @param topic topic receiving messages
      */
-    void setup(gpio_num_t pin, bool active_high, const char *topic);
+    void setup(gpio_num_t pin, bool active_high, pubsub::Topic<bool> topic);
 
 private:
     gpio_num_t pin = GPIO_NUM_NC;
     bool active_high = true;
-    QueueHandle_t queue = 0;
+    pubsub::Subscription<bool> subscription;
 
     void run();
     void write(bool on);
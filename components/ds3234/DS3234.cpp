@@ -15,7 +15,8 @@
 #include "freertos/queue.h"
 #include "freertos/timers.h"
 
-#include "pubsub.h"
+#include "clock.h"
+#include "pubsub.hpp"
 
 #include "DS3234.h"
 
@@ -148,9 +149,9 @@ void DS3234::task(void *pvParameter)
     }
 }
 
-void DS3234::setup(spi_host_device_t host_id, gpio_num_t cs_pin, const char *time_topic)
+void DS3234::setup(spi_host_device_t host_id, gpio_num_t cs_pin, pubsub::Topic<pubsub::Time> time_topic)
 {
-    ESP_LOGD(TAG, "setup, host_id:%d, cs_pin:%d, topic_name:%s, this:%p", host_id, cs_pin, time_topic, this);
+    ESP_LOGD(TAG, "setup, host_id:%d, cs_pin:%d, topic:%d, this:%p", host_id, cs_pin, time_topic.get_handle(), this);
 
     this->host_id = host_id;
     this->cs_pin = cs_pin;
@@ -168,8 +169,11 @@ void DS3234::setup(spi_host_device_t host_id, gpio_num_t cs_pin, const char *tim
     }
 
     // when time set actions arrive fast
-    time_queue = xQueueCreate(10, sizeof(pubsub_message_t));
-    pubsub_add_subscription(time_queue, time_topic, false);
+    if (!time_subscription.create(10)) {
+        ESP_LOGE(TAG, "setup, failed to create queue (FATAL)");
+        return;
+    }
+    time_subscription.add(time_topic, false);
 
     // start task
     esp_err_t ret = xTaskCreate(&task, TAG, 3072, this, tskIDLE_PRIORITY,
@@ -307,19 +311,21 @@ void DS3234::run()
     // periodic listen for set time changes and publish time updates
     uint8_t raw[] = { 0, 0, 0, 0, 0, 0, 0 };
     time_t time = -1;
-    pubsub_message_t message;
+    pubsub::Time set_time;
     while (true) {
 
-        if (xQueueReceive(time_queue, &message, DS3432_LOOK_INTERVAL_MS / portTICK_PERIOD_MS)) {
+        bool received = time_subscription.receive(&set_time, clock_wait_begin(CLOCK_MS(DS3432_LOOK_INTERVAL_MS)));
+        clock_wait_end();
+        if (received) {
 
             // truncate incoming date
-            if (message.int_val < TM_MINIMUM) {
+            if (set_time.seconds < TM_MINIMUM) {
                 time = TM_MINIMUM;
             }
             // ignore own publish action
-            if (time != message.int_val) {
+            if (time != set_time.seconds) {
                 ESP_LOGD(TAG, "run, set time");
-                encode_time(message.int_val, raw);
+                encode_time(set_time.seconds, raw);
                 write_data(TIME_REG, raw, 7);
             }
         } else {
@@ -327,7 +333,7 @@ void DS3234::run()
             ESP_LOGD(TAG, "run, read time");
             read_data(TIME_REG, raw, 7);
             time = decode_time(raw);
-            pubsub_publish_int(timestamp_topic, time);
+            timestamp_topic.publish(pubsub::Time { time });
         }
     };
 }
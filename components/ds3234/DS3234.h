@@ -7,7 +7,7 @@
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
 
 /**
  * DS3234 time.
@@ -25,7 +25,7 @@ public:
      * @param cs_pin chip select pin number
      * @param time_topic time topic, used to publish and subscribe to time changes.
      */
-    void setup(spi_host_device_t host_id, gpio_num_t cs_pin, const char *time_topic);
+    void setup(spi_host_device_t host_id, gpio_num_t cs_pin, pubsub::Topic<pubsub::Time> time_topic);
 
 private:
 
@@ -35,15 +35,15 @@ private:
     /**
      * Timestamp topic. Publish ticks since epoch.
      */
-    const char *timestamp_topic = 0;
+    pubsub::Topic<pubsub::Time> timestamp_topic;
 
     /**
      * Handle to SPI device.
      */
     spi_device_handle_t device_handle = 0;
 
-    /** set time queue */
-    QueueHandle_t time_queue = 0;
+    /** set time subscription */
+    pubsub::Subscription<pubsub::Time> time_subscription;
 
     void *tx = 0;
     void *rx = 0;
@@ -2,6 +2,8 @@
 
 #include "LED.h"
 
+#include "clock.h"
+
 static const char *TAG = "LED";
 
 LED::LED()
@@ -12,7 +14,7 @@ LED::~LED()
 {
 }
 
-void LED::setup(gpio_num_t pin, bool on, const char *topic)
+void LED::setup(gpio_num_t pin, bool on, pubsub::Topic<int32_t> topic)
 {
     ESP_LOGD(TAG, "setup, pin:%d, on:%d", pin, on);
 
@@ -20,22 +22,21 @@ void LED::setup(gpio_num_t pin, bool on, const char *topic)
         ESP_LOGE(TAG, "setup requires GPIO pin number (FATAL)");
         return;
     }
-    if (topic == 0) {
+    if (!topic.valid()) {
         ESP_LOGE(TAG, "setup requires topic (FATAL)");
         return;
     }
 
     // big queue not useful
-    QueueHandle_t led_queue = xQueueCreate(10, sizeof(pubsub_message_t));
-    if (led_queue == 0) {
+    if (!subscription.create(10)) {
         ESP_LOGE(TAG, "setup, failed to create queue (FATAL)");
         return;
     }
-    pubsub_add_subscription(led_queue, topic, false);
+    // blink requests are commands, wait briefly instead of dropping
+    subscription.add(topic, false, PUBSUB_DELIVERY_BLOCK, pdMS_TO_TICKS(100));
 
     this->pin = pin;
     this->on = on;
-    this->queue = led_queue;
 
     gpio_pad_select_gpio(pin);
     gpio_set_direction(pin, GPIO_MODE_OUTPUT);
@@ -47,15 +48,15 @@ void LED::setup(gpio_num_t pin, bool on, const char *topic)
 
 void LED::run()
 {
-    pubsub_message_t message;
+    int32_t count;
     while (true) {
-        if (xQueueReceive(queue, &message, portMAX_DELAY)) {
-            ESP_LOGD(TAG, "run, blink %lld", message.int_val);
-            for (int i = 0; i < message.int_val; i++) {
+        if (subscription.receive(&count, portMAX_DELAY)) {
+            ESP_LOGD(TAG, "run, blink %d", count);
+            for (int i = 0; i < count; i++) {
                 gpio_set_level(pin, on);
-                vTaskDelay(20 / portTICK_PERIOD_MS);
+                clock_delay(CLOCK_MS(20));
                 gpio_set_level(pin, !on);
-                vTaskDelay(80 / portTICK_PERIOD_MS);
+                clock_delay(CLOCK_MS(80));
             }
         }
     };
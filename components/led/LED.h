@@ -10,7 +10,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
 
 /**
  * Signal LED.
@@ -28,12 +28,12 @@ public:
      * @param on level used to light LED
      * @param topic topic receiving messages
      */
-    void setup(gpio_num_t pin, bool on, const char *topic);
+    void setup(gpio_num_t pin, bool on, pubsub::Topic<int32_t> topic);
 
 private:
     gpio_num_t pin = GPIO_NUM_NC;
     bool on = true;
-    QueueHandle_t queue = 0;
+    pubsub::Subscription<int32_t> subscription;
 
     void run();
 
@@ -17,7 +17,9 @@
 #include "freertos/queue.h"
 #include "freertos/task.h"
 
-#include "pubsub.h"
+#include "binlog.h"
+#include "pubsub.hpp"
+#include "pubsub_trace.h"
 
 static const char *TAG = "MCP23S17";
 
@@ -43,7 +45,7 @@ void MCP23S17::task(void *pvParameter)
     }
 }
 
-void MCP23S17::setup(spi_host_device_t host_id, gpio_num_t cs_pin, uint8_t address, const char *topics[16])
+void MCP23S17::setup(spi_host_device_t host_id, gpio_num_t cs_pin, uint8_t address, const pubsub::Topic<bool> topics[16])
 {
     ESP_LOGD(TAG, "setup, host_id:%d, cs_pin:%d, address:%d, topics:%p, this:%p", host_id, cs_pin, address, topics, this);
 
@@ -74,11 +76,16 @@ void MCP23S17::setup(spi_host_device_t host_id, gpio_num_t cs_pin, uint8_t addre
     write_byte(IOCON, 0x08);
 
     // create queue and connect output bit topics
-    queue = xQueueCreate(64, sizeof(pubsub_message_t));
+    // coalesced, at most one message per output bit queued
+    // actuator outputs, delivered before display subscribers
+    if (!subscription.create(16, PUBSUB_PRIORITY_HIGH)) {
+        ESP_LOGE(TAG, "setup, failed to create queue (FATAL)");
+        return;
+    }
     init_topics(topics);
 
-    // start task
-    ret = xTaskCreate(&task, TAG, 3072, this, tskIDLE_PRIORITY,
+    // start task, above the ctrl and display tasks
+    ret = xTaskCreate(&task, TAG, 3072, this, tskIDLE_PRIORITY + 3,
     NULL);
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "setup, xTaskCreate failed:%d (FATAL)", ret);
@@ -86,20 +93,18 @@ void MCP23S17::setup(spi_host_device_t host_id, gpio_num_t cs_pin, uint8_t addre
     }
 }
 
-void MCP23S17::init_topics(const char *topic_list[])
+void MCP23S17::init_topics(const pubsub::Topic<bool> topic_list[])
 {
     // all bits initially inputs (1)
     uint16_t input_bits = 0xFFFF;
     // scan all topicss
     for (int topic_index = 0; topic_index < 16; topic_index++) {
-        if (topic_list[topic_index] == NULL) {
-            // topic not present
-            topics[topic_index] = NULL;
-        } else {
-            // topic present (clone it)
-            topics[topic_index] = strdup(topic_list[topic_index]);
-            // subscribe to it
-            pubsub_add_subscription(queue, topics[topic_index], true);
+        const pubsub::Topic<bool> topic = topic_list[topic_index];
+        if (topic.valid()) {
+            // subscribe to it, only the last output state matters
+            subscription.add(topic, true, PUBSUB_DELIVERY_COALESCE);
+            // map handle to bit, avoids name compare on each message
+            topic_bits[topic.get_handle()] |= BIT_ON[topic_index];
             // and make the bit an output (0)
             input_bits &= BIT_OFF[topic_index];
         }
@@ -169,8 +174,8 @@ uint32_t MCP23S17::read_word(const uint8_t reg)
         ESP_LOGE(TAG, "write_word, spi_device_transmit failed:%d", ret);
         return -1;
     }
-    ESP_LOGI(TAG, "read_word, %02X %02X %02X %02X", transaction.rx_data[0], transaction.rx_data[1], transaction.rx_data[2],
-            transaction.rx_data[3]);
+    BINLOG_I(TAG, "read_word, %02X %02X %02X %02X", binlog_int(transaction.rx_data[0]), binlog_int(transaction.rx_data[1]),
+            binlog_int(transaction.rx_data[2]), binlog_int(transaction.rx_data[3]));
     return ((transaction.rx_data[0] << 8) | transaction.rx_data[1]);
 }
 
@@ -182,21 +187,20 @@ void MCP23S17::run()
     ESP_LOGD(TAG, "run, this:%p", this);
 
     // wait for output messages
-    pubsub_message_t message;
+    pubsub_topic_t topic;
+    bool value;
     while (true) {
-        while (xQueueReceive(queue, &message, portMAX_DELAY)) {
-            for (int topic_index = 0; topic_index < 16; topic_index++) {
-                if (strcmp(message.topic, topics[topic_index]) == 0) {
-                    // found
-                    bool value = message.boolean_val;
-                    if (value) {
-                        output_state |= BIT_ON[topic_index];
-                    } else {
-                        output_state &= BIT_OFF[topic_index];
-                    }
-                    // write GPIOA + GPIOB
-                    write_word(GPIOA, output_state);
+        while (subscription.receive(&topic, &value, portMAX_DELAY)) {
+            uint16_t bits = topic < PUBSUB_MAX_TOPICS ? topic_bits[topic] : 0;
+            if (bits) {
+                if (value) {
+                    output_state |= bits;
+                } else {
+                    output_state &= ~bits;
                 }
+                // write GPIOA + GPIOB
+                write_word(GPIOA, output_state);
+                pubsub_trace_mark("mcp23s17.write");
             }
         };
     };
@@ -7,7 +7,7 @@
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
 
 /**
  * MCP23S17 16-bit I/O expander.<br>
@@ -26,9 +26,9 @@ public:
      * @param host_id SPI host id
      * @param cs_pin chip select pin number
      * @param address address of device [0..7]
-     * @param topics list of topics [16]
+     * @param topics output bit topics [16], invalid topic for an input bit
      */
-    void setup(spi_host_device_t host_id, gpio_num_t cs_pin, uint8_t address, const char *topics[16]);
+    void setup(spi_host_device_t host_id, gpio_num_t cs_pin, uint8_t address, const pubsub::Topic<bool> topics[16]);
 
 private:
     const uint8_t BASE_ADDRESS = 0x40;
@@ -56,11 +56,12 @@ private:
      */
     spi_device_handle_t device_handle = 0;
 
-    QueueHandle_t queue = 0;
+    pubsub::Subscription<bool> subscription;
 
-    const char *topics[16];
+    /** output bits per topic handle */
+    uint16_t topic_bits[PUBSUB_MAX_TOPICS] = { 0 };
 
-    void init_topics(const char *topics[]);
+    void init_topics(const pubsub::Topic<bool> topics[]);
     void write_byte(const uint8_t reg, const uint8_t value);
     void write_word(const uint8_t reg, const uint16_t value);
     uint32_t read_word(const uint8_t reg);
@@ -13,6 +13,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "binlog.h"
+#include "clock.h"
 #include "pubsub.h"
 
 static const char *TAG = "MHZ19B";
@@ -68,14 +70,18 @@ bool MHZ19B::initialize_uart()
     return true;
 }
 
-void MHZ19B::setup(uart_port_t uart_port, gpio_num_t rx_pin, gpio_num_t tx_pin, const char *co2_topic,
+void MHZ19B::setup(uart_port_t uart_port, gpio_num_t rx_pin, gpio_num_t tx_pin, pubsub::Topic<float> co2_topic,
         uint32_t measurement_period_ms)
 {
-    ESP_LOGI(TAG, "setup, uart_port:%d, rx_pin:%d, tx_pin:%d, topic_name:%s, this:%p", uart_port, rx_pin, tx_pin, co2_topic, this);
+    ESP_LOGI(TAG, "setup, uart_port:%d, rx_pin:%d, tx_pin:%d, topic:%d, this:%p", uart_port, rx_pin, tx_pin, co2_topic.get_handle(), this);
     this->uart_port = uart_port;
     this->rx_pin = rx_pin;
     this->tx_pin = tx_pin;
     this->co2_topic = co2_topic;
+    if (!co2_topic.valid()) {
+        ESP_LOGE(TAG, "setup, requires registered topic (FATAL)");
+        return;
+    }
     this->measurement_period_ms = measurement_period_ms;
 
     bool success = initialize_uart();
@@ -101,7 +107,7 @@ void MHZ19B::setup(uart_port_t uart_port, gpio_num_t rx_pin, gpio_num_t tx_pin,
 
 void MHZ19B::command_read_co2_concentration()
 {
-    ESP_LOGI(TAG, "command_read_co2_concentration");
+    ESP_LOGD(TAG, "command_read_co2_concentration");
     MHZ19B::write_frame(READ_CO2_CONCENTRATION_FRAME);
 }
 
@@ -140,15 +146,16 @@ void MHZ19B::decode_co2_concentration(const uint8_t *frame)
     uint8_t ppm_hi = frame[2];
     uint8_t ppm_lo = frame[3];
     uint16_t ppm_co2 = ppm_hi * 256 + ppm_lo;
-    ESP_LOGI(TAG, "decode_co2_concentration, %02x %02x", ppm_hi, ppm_lo);
-    ESP_LOGI(TAG, "decode_co2_concentration, co2:%d [ppm]", ppm_co2);
-    pubsub_publish_double(co2_topic, (double) ppm_co2);
+    BINLOG_I(TAG, "decode_co2_concentration, %02x %02x, co2:%d [ppm]", binlog_int(ppm_hi), binlog_int(ppm_lo),
+            binlog_int(ppm_co2));
+    co2_topic.publish((float) ppm_co2);
 }
 
 void MHZ19B::write_frame(const uint8_t *frame)
 {
-    ESP_LOGI(TAG, "write_frame, %02x %02x %02x %02x %02x %02x %02x %02x %02x", frame[0], frame[1], frame[2], frame[3], frame[4],
+    ESP_LOGD(TAG, "write_frame, %02x %02x %02x %02x %02x %02x %02x %02x %02x", frame[0], frame[1], frame[2], frame[3], frame[4],
             frame[5], frame[6], frame[7], frame[8]);
+    BINLOG_I(TAG, "write_frame, command:%02x", binlog_int(frame[2]));
 
     int bytes_written = uart_write_bytes(uart_port, (const char*) frame, FRAME_LENGTH);
     if (bytes_written != FRAME_LENGTH) {
@@ -182,7 +189,7 @@ void MHZ19B::read()
     ESP_LOGI(TAG, "read, this:%p", this);
 
     while (true) {
-        ESP_LOGI(TAG, "read, uart_read_bytes");
+        ESP_LOGD(TAG, "read, uart_read_bytes");
         const int rx_bytes = uart_read_bytes(uart_port, rx_buffer, FRAME_LENGTH,  portMAX_DELAY);
         if (rx_bytes == -1) {
             ESP_LOGE(TAG, "read, error");
@@ -211,7 +218,7 @@ void MHZ19B::write()
 
     while (true) {
         command_read_co2_concentration();
-        vTaskDelay(measurement_period_ms / portTICK_PERIOD_MS);
+        clock_delay(CLOCK_MS(measurement_period_ms));
     };
 }
 
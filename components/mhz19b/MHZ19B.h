@@ -6,7 +6,7 @@
 #include "hal/gpio_types.h"
 #include "hal/uart_types.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
 
 /**
  * MHZ19B CO2 concentration module.
@@ -26,7 +26,7 @@ public:
      * @param co2_topic CO2 concentration topic [ppm].
      * @param measurement_period_ms measurement period [ms].
      */
-    void setup(uart_port_t uart_port, gpio_num_t rx_pin, gpio_num_t tx_pin, const char *co2_topic, uint32_t measurement_period_ms);
+    void setup(uart_port_t uart_port, gpio_num_t rx_pin, gpio_num_t tx_pin, pubsub::Topic<float> co2_topic, uint32_t measurement_period_ms);
 
     /** Minimum measurement period [ms]. */
     static constexpr int MINIMUM_MEASUREMENT_PERIOD_MS = 120000;
@@ -39,7 +39,7 @@ private:
     /**
      * CO2 concentration topic [ppm].
      */
-    const char *co2_topic = 0;
+    pubsub::Topic<float> co2_topic;
 
     /**
      * Measurement period [ms].
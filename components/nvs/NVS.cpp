@@ -1,15 +1,137 @@
 // The author disclaims copyright to this source code.
 
+#include "stdlib.h"
 #include "string.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
 #include "nvs_flash.h"
 
+#include "clock.h"
+
 #include "NVS.h"
 
 static const char *TAG = "NVS";
 
+/*
+ * Value operations, instantiated per stored value type.
+ * The blob layout per topic type is unchanged: INT int64_t, DOUBLE double, FLOAT float, BOOLEAN bool.
+ */
+
+struct nvs_value_ops_t
+{
+    /**
+     * read stored value into message and publish it, migrate set if it needs to be stored again,
+     * without stored value the last published value (a default) or 0
+     */
+    esp_err_t (*read)(nvs_handle_t handle, const char *key, pubsub_message_t *message, bool *migrate);
+    esp_err_t (*write)(nvs_handle_t handle, const char *key, const pubsub_message_t *message);
+    /** copy value of message into last, true if changed */
+    bool (*update)(pubsub_message_t *last, const pubsub_message_t *message);
+};
+
+static void log_value(const char *function_name, const char *key, int64_t value)
+{
+    ESP_LOGI(TAG, "%s, key:%s, value:%lld", function_name, key, value);
+}
+
+static void log_value(const char *function_name, const char *key, double value)
+{
+    ESP_LOGI(TAG, "%s, key:%s, value:%lf", function_name, key, value);
+}
+
+static void log_value(const char *function_name, const char *key, float value)
+{
+    ESP_LOGI(TAG, "%s, key:%s, value:%f", function_name, key, value);
+}
+
+static void log_value(const char *function_name, const char *key, bool value)
+{
+    ESP_LOGI(TAG, "%s, key:%s, value:%s", function_name, key, value ? "true" : "false");
+}
+
+template<typename T>
+static esp_err_t read_value(nvs_handle_t handle, const char *key, pubsub_message_t *message, bool *migrate)
+{
+    T value = T();
+    pubsub::TopicType<T>::last(message->handle, &value);
+    size_t size = sizeof(T);
+    esp_err_t err = nvs_get_blob(handle, key, &value, &size);
+    log_value("read_nvs", key, value);
+    pubsub::TopicType<T>::set(*message, value);
+    pubsub::TopicType<T>::publish(message->handle, value);
+    return err;
+}
+
+template<>
+esp_err_t read_value<float>(nvs_handle_t handle, const char *key, pubsub_message_t *message, bool *migrate)
+{
+    // room for a double stored by previous versions
+    union
+    {
+        float float_val;
+        double double_val;
+    } value;
+    value.float_val = 0.0f;
+    pubsub_last_float_h(message->handle, &value.float_val);
+    size_t size = sizeof(value);
+    esp_err_t err = nvs_get_blob(handle, key, &value, &size);
+    if (err == ESP_OK && size == sizeof(double)) {
+        // migrate, store as float on next write
+        ESP_LOGW(TAG, "read_nvs, key:%s, migrate double to float", key);
+        value.float_val = (float) value.double_val;
+        *migrate = true;
+    }
+    log_value("read_nvs", key, value.float_val);
+    message->float_val = value.float_val;
+    pubsub_publish_float_h(message->handle, value.float_val);
+    return err;
+}
+
+template<typename T>
+static esp_err_t write_value(nvs_handle_t handle, const char *key, const pubsub_message_t *message)
+{
+    T value = pubsub::TopicType<T>::get(*message);
+    log_value("write_nvs", key, value);
+    return nvs_set_blob(handle, key, &value, sizeof(T));
+}
+
+template<typename T>
+static bool update_value(pubsub_message_t *last, const pubsub_message_t *message)
+{
+    T value = pubsub::TopicType<T>::get(*message);
+    // avoid ringing, mark only changes
+    if (pubsub::TopicType<T>::get(*last) == value) {
+        return false;
+    }
+    pubsub::TopicType<T>::set(*last, value);
+    return true;
+}
+
+template<typename T>
+static const nvs_value_ops_t* value_ops_of()
+{
+    static const nvs_value_ops_t ops = { &read_value<T>, &write_value<T>, &update_value<T> };
+    return &ops;
+}
+
+/**
+ * @return value operations of topic type, 0 if not supported
+ */
+static const nvs_value_ops_t* value_ops_of(pubsub_type_t type)
+{
+    if (type == PUBSUB_TYPE_INT) {
+        return value_ops_of<int64_t>();
+    } else if (type == PUBSUB_TYPE_DOUBLE) {
+        return value_ops_of<double>();
+    } else if (type == PUBSUB_TYPE_FLOAT) {
+        return value_ops_of<float>();
+    } else if (type == PUBSUB_TYPE_BOOLEAN) {
+        return value_ops_of<bool>();
+    }
+    return 0;
+}
+
 NVS::NVS()
 {
 }
@@ -27,7 +149,11 @@ bool NVS::init_topics(const char *topic_list[], const size_t number_of_topics)
     // maintain a fixed last message for each topic
     // no need for dynamic allocation bookkeeping later
     messages = (pubsub_message_t**) (malloc(sizeof(pubsub_message_t*) * number_of_topics));
+    value_ops = (const nvs_value_ops_t**) (malloc(sizeof(nvs_value_ops_t*) * number_of_topics));
     changed = (bool*) (malloc(sizeof(bool) * number_of_topics));
+    for (int handle = 0; handle < PUBSUB_MAX_TOPICS; handle++) {
+        message_index[handle] = -1;
+    }
     for (int topic_index = 0; topic_index < number_of_topics; topic_index++) {
         const char *topic_name = topic_list[topic_index];
         pubsub_type_t topic_type = pubsub_get_type(topic_name);
@@ -35,8 +161,25 @@ bool NVS::init_topics(const char *topic_list[], const size_t number_of_topics)
         pubsub_message_t *message = (pubsub_message_t*) (malloc(sizeof(pubsub_message_t)));
         message->topic = topic_name;
         message->type = topic_type;
+        message->int_val = 0;
         messages[topic_index] = message;
         changed[topic_index] = false;
+        value_ops[topic_index] = value_ops_of(topic_type);
+        if (value_ops[topic_index] == 0) {
+            ESP_LOGE(TAG, "init_topics, unsupported topic:%s, type:%d", topic_name, topic_type);
+        }
+        size_t length = strlen(topic_name);
+        if (length <= key_offset || length - key_offset >= NVS_KEY_NAME_MAX_SIZE) {
+            ESP_LOGE(TAG, "init_topics, no valid key for topic:%s, key offset:%d", topic_name, key_offset);
+            value_ops[topic_index] = 0;
+        }
+        pubsub_topic_t handle = pubsub_find_topic(topic_name);
+        message->handle = handle;
+        if (handle == PUBSUB_TOPIC_INVALID) {
+            ESP_LOGE(TAG, "init_topics, unknown topic:%s", topic_name);
+        } else {
+            message_index[handle] = topic_index;
+        }
     }
     number_of_messages = number_of_topics;
     return true;
@@ -89,14 +232,17 @@ bool NVS::subscribe_topics()
     for (int topic_index = 0; topic_index < number_of_messages; topic_index++) {
         const pubsub_message_t *message = messages[topic_index];
         ESP_LOGI(TAG, "subscribe_topics, topic:%s", message->topic);
-        pubsub_add_subscription(this->queue, message->topic, false);
+        // only the last value matters
+        pubsub_add_subscription_policy(this->queue, message->topic, false, PUBSUB_DELIVERY_COALESCE, 0,
+                PUBSUB_PRIORITY_NORMAL);
     }
     return true;
 }
 
-void NVS::setup(const char *ns, const char *topic_list[], const size_t number_of_topics, const uint32_t hold_off_period_ms)
+void NVS::setup(const char *ns, const char *topic_list[], const size_t number_of_topics, const uint32_t hold_off_period_ms,
+        const size_t key_offset)
 {
-    ESP_LOGI(TAG, "setup, namespace:%s, topics:%p[%d]", ns, topic_list, number_of_topics);
+    ESP_LOGI(TAG, "setup, namespace:%s, topics:%p[%d], key offset:%d", ns, topic_list, number_of_topics, key_offset);
 
     if (ns == 0) {
         ESP_LOGE(TAG, "setup, requires namespace (FATAL)");
@@ -108,7 +254,8 @@ void NVS::setup(const char *ns, const char *topic_list[], const size_t number_of
         ESP_LOGE(TAG, "setup, requires hold off period ms (FATAL)");
         return;
     }
-    this->hold_off_period_ticks = hold_off_period_ms / portTICK_PERIOD_MS;
+    this->hold_off_period = CLOCK_MS(hold_off_period_ms);
+    this->key_offset = key_offset;
 
     if (!init_topics(topic_list, number_of_topics)) {
         ESP_LOGE(TAG, "setup, requires topics (FATAL)");
@@ -138,34 +285,15 @@ void NVS::read_nvs()
 {
     for (int topic_index = 0; topic_index < number_of_messages; topic_index++) {
         pubsub_message_t *message = messages[topic_index];
-        esp_err_t err = ESP_ERR_NVS_BASE;
-        if (message->type == PUBSUB_TYPE_INT) {
-            int64_t value = 0;
-            size_t size = sizeof(int64_t);
-            err = nvs_get_blob(handle, message->topic, &value, &size);
-            ESP_LOGI(TAG, "read_nvs, key:%s, value:%lld", message->topic, value);
-            message->int_val = value;
-            pubsub_publish_int(message->topic, value);
-        } else if (message->type == PUBSUB_TYPE_DOUBLE) {
-            double value = 0.0;
-            size_t size = sizeof(double);
-            err = nvs_get_blob(handle, message->topic, &value, &size);
-            ESP_LOGI(TAG, "read_nvs, key:%s, value:%lf", message->topic, value);
-            message->double_val = value;
-            pubsub_publish_double(message->topic, value);
-        } else if (message->type == PUBSUB_TYPE_BOOLEAN) {
-            bool value = false;
-            size_t size = sizeof(bool);
-            err = nvs_get_blob(handle, message->topic, &value, &size);
-            ESP_LOGI(TAG, "read_nvs, key:%s, value:%s", message->topic, value ? "true" : "false");
-            message->boolean_val = value;
-            pubsub_publish_bool(message->topic, value);
-        } else {
-            ESP_LOGE(TAG, "read_nvs, unsupported message type:%d", message->type);
+        const nvs_value_ops_t *ops = value_ops[topic_index];
+        if (ops == 0) {
+            continue;
         }
+        bool migrate = false;
+        esp_err_t err = ops->read(handle, message->topic + key_offset, message, &migrate);
         if (err == ESP_OK) {
-            // read successful, no need to store value
-            changed[topic_index] = false;
+            // read successful, no need to store value unless migrated
+            changed[topic_index] = migrate;
         } else {
             ESP_LOGW(TAG, "read_nvs, failed (%s)", esp_err_to_name(err));
             // read failed, need to store value
@@ -178,40 +306,16 @@ void NVS::run()
 {
     pubsub_message_t message;
     while (true) {
-        if (xQueueReceive(queue, &message, hold_off_period_ticks)) {
+        BaseType_t received = pubsub_receive(queue, &message, clock_wait_begin(hold_off_period));
+        clock_wait_end();
+        if (received) {
             ESP_LOGI(TAG, "run, update topic:%s", message.topic);
-            bool found = false;
-            for (int i = 0; i < number_of_messages; i++) {
-                if (strcmp(messages[i]->topic, message.topic) == 0) {
-                    found = true;
-                    pubsub_message_t *last = messages[i];
-                    last->type = message.type;
-                    if (last->type == PUBSUB_TYPE_INT) {
-                        // avoid ringing, mark only changes
-                        if (last->int_val != message.int_val) {
-                            changed[i] = true;
-                            last->int_val = message.int_val;
-                        }
-                    } else if (last->type == PUBSUB_TYPE_DOUBLE) {
-                        // avoid ringing, mark only changes
-                        if (last->double_val != message.double_val) {
-                            changed[i] = true;
-                            last->double_val = message.double_val;
-                        }
-                    } else if (last->type == PUBSUB_TYPE_BOOLEAN) {
-                        // avoid ringing, mark only changes
-                        if (last->boolean_val != message.boolean_val) {
-                            changed[i] = true;
-                            last->boolean_val = message.boolean_val;
-                        }
-                    } else {
-                        ESP_LOGE(TAG, "run, unsupported message type:%d", last->type);
-                    }
-                    // only expect one
-                    break;
+            int16_t index = message.handle < PUBSUB_MAX_TOPICS ? message_index[message.handle] : -1;
+            if (index >= 0 && value_ops[index] != 0) {
+                if (value_ops[index]->update(messages[index], &message)) {
+                    changed[index] = true;
                 }
-            }
-            if (!found) {
+            } else {
                 ESP_LOGE(TAG, "run, unknown topic:%s", message.topic);
             }
         } else {
@@ -227,20 +331,7 @@ void NVS::write_nvs()
         ESP_LOGI(TAG, "write_nvs, change detected");
         for (int i = 0; i < number_of_messages; i++) {
             if (changed[i]) {
-                pubsub_message_t *message = messages[i];
-                esp_err_t err = ESP_ERR_NVS_BASE;
-                if (message->type == PUBSUB_TYPE_INT) {
-                    ESP_LOGI(TAG, "write_nvs, key:%s, value:%lld", message->topic, message->int_val);
-                    err = nvs_set_blob(handle, message->topic, &message->int_val, sizeof(int64_t));
-                } else if (message->type == PUBSUB_TYPE_DOUBLE) {
-                    ESP_LOGI(TAG, "write_nvs, key:%s, value:%lf", message->topic, message->double_val);
-                    err = nvs_set_blob(handle, message->topic, &message->double_val, sizeof(double));
-                } else if (message->type == PUBSUB_TYPE_BOOLEAN) {
-                    ESP_LOGI(TAG, "write_nvs, key:%s, value:%s", message->topic, message->boolean_val ? "true" : "false");
-                    err = nvs_set_blob(handle, message->topic, &message->int_val, sizeof(bool));
-                } else {
-                    ESP_LOGE(TAG, "write_nvs, unsupported message type:%d", message->type);
-                }
+                esp_err_t err = value_ops[i]->write(handle, messages[i]->topic + key_offset, messages[i]);
                 if (err != ESP_OK) {
                     ESP_LOGE(TAG, "write_nvs, failed (%s)", esp_err_to_name(err));
                 }
@@ -9,7 +9,10 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
-#include "pubsub.h"
+#include "pubsub.hpp"
+
+/** Value operations per topic type (NVS.cpp) */
+struct nvs_value_ops_t;
 
 /**
  * Non-Volatile-Storage
@@ -34,25 +37,37 @@ public:
      * @param topic_list list of topics
      * @param number_of_topics number of topics
      * @param hold_off_period_ms hold of period in ms
+     * @param key_offset leading topic name characters left out of the key, e.g. a zone prefix
+     *        (keys are at most NVS_KEY_NAME_MAX_SIZE - 1 characters)
      */
-    void setup(const char *ns, const char *topic_list[], const size_t number_of_topics, const uint32_t hold_off_period_ms);
+    void setup(const char *ns, const char *topic_list[], const size_t number_of_topics, const uint32_t hold_off_period_ms,
+            const size_t key_offset = 0);
 
 private:
     /** NVS namespace to group the key-value pairs */
     const char *ns = 0;
-    /** Hold off period in timer ticks */
-    uint32_t hold_off_period_ticks = 0;
+    /** Hold off period [us] */
+    int64_t hold_off_period = 0;
+    /** Topic name characters left out of the key */
+    size_t key_offset = 0;
     /** One queue receiving messages for all monitored topics */
     QueueHandle_t queue = 0;
     /**
      * List of messages (values in nvs) that are monitored
      */
     pubsub_message_t **messages = 0;
+    /**
+     * List of value operations, resolved once from the topic type.
+     * (matches the number and order of the messages)
+     */
+    const nvs_value_ops_t **value_ops = 0;
     /**
      * List of message changed flags.
      * (matches the number and order of the messages)
      */
     bool *changed = 0;
+    /** Message index per topic handle, -1 if not monitored */
+    int16_t message_index[PUBSUB_MAX_TOPICS];
     /** The number of messages monitored */
     uint16_t number_of_messages = 0;
 
@@ -1,278 +1,1690 @@
 // The author disclaims copyright to this source code.
 
+#include <math.h>
 #include <string.h>
-#include <sys/queue.h>
+#include <stdatomic.h>
 
 #include "esp_log.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "binlog.h"
+#include "clock.h"
 
 #include "pubsub.h"
+#include "pubsub_index.h"
+#include "pubsub_trace.h"
+
+/** Name index size, twice the capacity keeps probe sequences short */
+#define PUBSUB_INDEX_SIZE (2 * PUBSUB_MAX_TOPICS)
 
 static const char *tag = "pubsub";
 
-/** Subscriber list element. */
+/*
+ * Concurrency
+ *
+ * Registration and subscription changes are serialized by pubsub_mutex.
+ * Publish and last value reads never take the mutex:
+ * - subscriber lists are read inside a read section (pubsub_read_lock/unlock),
+ *   a removed subscriber is freed only after all read sections that could
+ *   still see it have ended (pubsub_synchronize, two epoch reader counters),
+ * - last values are protected by a per topic sequence lock,
+ *   the writer side is a short critical section, readers retry on change.
+ *
+ * Delivery
+ *
+ * Each queue subscription has a delivery policy for a full queue
+ * (pubsub_delivery_t) and counts delivered, dropped and coalesced messages
+ * and the queue high water mark, topics sum the counts of their subscribers.
+ * Subscriber lists are ordered by priority (pubsub_priority_t), publish
+ * delivers to actuators before a display queue can block it.
+ *
+ * Filter
+ *
+ * A topic registered with a filter (pubsub_filter_t) forwards a publish only
+ * when the value left the deadband around the last forwarded value and the
+ * minimum interval passed. The decision is taken with the last value store,
+ * the last value always follows the publishes. A change held back by the
+ * minimum interval is pending, pubsub_forward_pending forwards the last value
+ * once the interval passed.
+ *
+ * Trace
+ *
+ * With CONFIG_PUBSUB_TRACE publish, delivery and receive events are recorded
+ * in a ring (pubsub_trace.c) for end to end latency analysis.
+ *
+ * Batch
+ *
+ * pubsub_batch_commit stores the last values of all topics in a batch inside one
+ * critical section guarded by a global sequence (pubsub_snapshot_begin/retry),
+ * then delivers them. Queue subscribers get one message per topic,
+ * a latest value subscriber is notified once per batch.
+ *
+ * Patterns
+ *
+ * A pattern subscription ("temp.*", "*.pv") is expanded into ordinary
+ * subscribers of all matching topics when added, and of each matching topic
+ * registered later. Publish never matches patterns.
+ *
+ * Memory
+ *
+ * Topics, subscribers, patterns and latest value subscribers come from static pools,
+ * topic names are interned in a static arena (see Kconfig for capacities).
+ * No heap is used, pubsub_get_capacity reports usage.
+ */
+
+/** Latest value subscriber. */
+struct pubsub_latest_s
+{
+    /** change bit per subscribed topic, set by publish, cleared by pubsub_latest_changes */
+    atomic_uint changes;
+    /** time of oldest pending change [us] */
+    _Atomic int64_t since;
+    /** number of change bits in use */
+    uint8_t count;
+    /** task to notify on change, NULL to poll */
+    TaskHandle_t task;
+    uint32_t notify_bits;
+    /** priority of its subscriptions */
+    pubsub_priority_t priority;
+    /** pool element in use */
+    bool used;
+};
+
+/** Pattern subscription, either to a queue or a latest value subscriber. */
+typedef struct
+{
+    /** pattern (interned), NULL if pool element not in use */
+    const char *pattern;
+    QueueHandle_t queue;
+    pubsub_latest_t *latest;
+    uint32_t change_bit;
+    bool hot;
+} pubsub_pattern_t;
+
+/** Subscriber list element, either a queue or a latest value subscriber. */
 typedef struct pubsub_subscriber_s
 {
     QueueHandle_t queue;
-    LIST_ENTRY(pubsub_subscriber_s)
-    pointers;
+    pubsub_latest_t *latest;
+    uint32_t change_bit;
+    /** pattern that created this subscriber, NULL if subscribed by name */
+    pubsub_pattern_t *pattern;
+    /** queue receives pubsub_compact_t instead of pubsub_message_t */
+    bool compact;
+    /** queue full policy */
+    pubsub_delivery_t delivery;
+    /** wait for queue space (PUBSUB_DELIVERY_BLOCK) */
+    TickType_t timeout;
+    /** delivery order in topic list, higher first */
+    pubsub_priority_t priority;
+    /** message queued and not yet received (PUBSUB_DELIVERY_COALESCE) */
+    atomic_bool pending;
+    atomic_uint delivered;
+    atomic_uint dropped;
+    atomic_uint coalesced;
+    atomic_uint high_water;
+    /** next in topic list, or next free in pool */
+    _Atomic(struct pubsub_subscriber_s*) next;
 } pubsub_subscriber_t;
 
-/** Topic list element. */
-typedef struct pubsub_topic_detail_s
+/** Last known value */
+typedef union
+{
+    int64_t int_val;
+    double double_val;
+    float float_val;
+    bool boolean_val;
+} pubsub_value_t;
+
+/** Topic registry element. */
+typedef struct
 {
-    char *topic;
+    /** topic name (interned), NULL if element not in use */
+    _Atomic(const char*) topic;
     pubsub_type_t type;
     bool always;
-    // last known value
-    union
-    {
-        int64_t int_val;
-        double double_val;
-        bool boolean_val;
-    };
-    LIST_HEAD(pubsub_subscriber_list, pubsub_subscriber_s)
-    subscribers;
-    LIST_ENTRY(pubsub_topic_detail_s)
-    pointers;
+    /** last value sequence lock, odd while writing */
+    atomic_uint sequence;
+    /** last known value */
+    pubsub_value_t value;
+    /** publish filter */
+    pubsub_filter_t filter;
+    /** value and time [us] of the last forwarded publish, written inside pubsub_spinlock */
+    pubsub_value_t forwarded;
+    int64_t forwarded_time;
+    /** change held back by min_interval_ms, written inside pubsub_spinlock */
+    bool pending;
+    _Atomic(pubsub_subscriber_t*) subscribers;
+    /** delivery counts, sum of all (former) subscribers */
+    atomic_uint delivered;
+    atomic_uint dropped;
+    atomic_uint coalesced;
+    atomic_uint suppressed;
 } pubsub_topic_detail_t;
 
-static LIST_HEAD(pubsub_topic_subscribers_list, pubsub_topic_detail_s)
-pubsub_topic_subscribers;
+/** forwarded_time before the first forwarded publish */
+#define PUBSUB_NEVER INT64_MIN
+
+_Static_assert(sizeof(pubsub_compact_t) == 8, "compact message is 8 bytes");
+
+/** Topic registry, the topic handle is the index */
+static pubsub_topic_detail_t pubsub_topics[PUBSUB_MAX_TOPICS];
+
+/** Topic name to handle */
+static pubsub_index_t pubsub_topic_index;
+static pubsub_index_entry_t pubsub_topic_index_entries[PUBSUB_INDEX_SIZE];
+
+/** Subscriber pool */
+static pubsub_subscriber_t pubsub_subscribers[PUBSUB_MAX_SUBSCRIBERS];
+static pubsub_subscriber_t *pubsub_free_subscribers;
+static uint16_t pubsub_subscribers_used;
+
+/** Pattern pool */
+static pubsub_pattern_t pubsub_patterns[PUBSUB_MAX_PATTERNS];
+
+/** Latest value subscriber pool */
+static pubsub_latest_t pubsub_latests[PUBSUB_MAX_LATEST];
+
+/** Interned topic names, consecutive zero terminated strings */
+static char pubsub_names[PUBSUB_NAME_ARENA_SIZE];
+static uint16_t pubsub_names_used;
+
+/** Serializes registry and subscription changes */
+static SemaphoreHandle_t pubsub_mutex;
+/** Last value writer critical section */
+static portMUX_TYPE pubsub_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/** Batch sequence lock, odd while a batch stores its last values */
+static atomic_uint pubsub_batch_sequence;
+
+/** Number of topics with a pending change, written inside pubsub_spinlock */
+static atomic_uint pubsub_pending_count;
+
+/** Current read epoch (0 or 1) */
+static atomic_uint pubsub_epoch;
+/** Number of active read sections per epoch */
+static atomic_uint pubsub_readers[2];
 
 /** Initialize once. */
 void pubsub_initialize()
 {
-    LIST_INIT(&pubsub_topic_subscribers);
+    memset(pubsub_topics, 0, sizeof(pubsub_topics));
+    memset(pubsub_latests, 0, sizeof(pubsub_latests));
+    memset(pubsub_patterns, 0, sizeof(pubsub_patterns));
+    pubsub_free_subscribers = NULL;
+    for (int index = PUBSUB_MAX_SUBSCRIBERS - 1; index >= 0; index--) {
+        atomic_init(&pubsub_subscribers[index].next, pubsub_free_subscribers);
+        pubsub_free_subscribers = &pubsub_subscribers[index];
+    }
+    pubsub_subscribers_used = 0;
+    pubsub_names_used = 0;
+    pubsub_index_initialize(&pubsub_topic_index, pubsub_topic_index_entries, PUBSUB_INDEX_SIZE);
+    atomic_store(&pubsub_epoch, 0);
+    atomic_store(&pubsub_batch_sequence, 0);
+    atomic_store(&pubsub_readers[0], 0);
+    atomic_store(&pubsub_readers[1], 0);
+    pubsub_trace_initialize();
+    pubsub_mutex = xSemaphoreCreateMutex();
+    if (pubsub_mutex == NULL) {
+        ESP_LOGE(tag, "pubsub_initialize, failed to create mutex (FATAL)");
+    }
+}
+
+static void pubsub_lock()
+{
+    xSemaphoreTake(pubsub_mutex, portMAX_DELAY);
+}
+
+static void pubsub_unlock()
+{
+    xSemaphoreGive(pubsub_mutex);
+}
+
+/**
+ * Begin read section.
+ * @return epoch to pass to pubsub_read_unlock.
+ */
+static unsigned int pubsub_read_lock()
+{
+    while (true) {
+        unsigned int epoch = atomic_load(&pubsub_epoch);
+        atomic_fetch_add(&pubsub_readers[epoch], 1);
+        // counted after a flip, a later pubsub_synchronize would not wait for this section
+        if (atomic_load(&pubsub_epoch) == epoch) {
+            return epoch;
+        }
+        atomic_fetch_sub(&pubsub_readers[epoch], 1);
+    }
+}
+
+static void pubsub_read_unlock(unsigned int epoch)
+{
+    atomic_fetch_sub(&pubsub_readers[epoch], 1);
+}
+
+/**
+ * Wait until all read sections that started before this call have ended.
+ * Elements unlinked before this call can be freed afterwards.
+ * Only called with pubsub_mutex taken.
+ */
+static void pubsub_synchronize()
+{
+    unsigned int epoch = atomic_load(&pubsub_epoch);
+    atomic_store(&pubsub_epoch, epoch ^ 1);
+    while (atomic_load(&pubsub_readers[epoch]) != 0) {
+        vTaskDelay(1);
+    }
+}
+
+static void pubsub_value_write(pubsub_topic_detail_t *topic_detail, const pubsub_value_t *value)
+{
+    unsigned int sequence = atomic_load_explicit(&topic_detail->sequence, memory_order_relaxed);
+    atomic_store_explicit(&topic_detail->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    topic_detail->value = *value;
+    atomic_store_explicit(&topic_detail->sequence, sequence + 2, memory_order_release);
+}
+
+static void pubsub_value_read(pubsub_topic_detail_t *topic_detail, pubsub_value_t *value)
+{
+    unsigned int before;
+    unsigned int after;
+    do {
+        before = atomic_load_explicit(&topic_detail->sequence, memory_order_acquire);
+        *value = topic_detail->value;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&topic_detail->sequence, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+static pubsub_topic_detail_t* pubsub_get_topic_detail(pubsub_topic_t topic)
+{
+    if (topic >= PUBSUB_MAX_TOPICS) {
+        return NULL;
+    }
+    pubsub_topic_detail_t *topic_detail = &pubsub_topics[topic];
+    if (atomic_load(&topic_detail->topic) == NULL) {
+        return NULL;
+    }
+    return topic_detail;
+}
+
+static pubsub_topic_t pubsub_get_topic(const pubsub_topic_detail_t *topic_detail)
+{
+    return (pubsub_topic_t) (topic_detail - pubsub_topics);
+}
+
+static pubsub_topic_t pubsub_find_topic_unlocked(const char *topic_name)
+{
+    ESP_LOGV(tag, "pubsub_find_topic, topic:%s", topic_name);
+    if (topic_name == NULL) {
+        return PUBSUB_TOPIC_INVALID;
+    }
+    uint16_t value = pubsub_index_find(&pubsub_topic_index, topic_name);
+    if (value == PUBSUB_INDEX_NONE) {
+        ESP_LOGV(tag, "pubsub_find_topic, found:none");
+        return PUBSUB_TOPIC_INVALID;
+    }
+    ESP_LOGV(tag, "pubsub_find_topic, found:%d", value);
+    return value;
+}
+
+pubsub_topic_t pubsub_find_topic(const char *topic_name)
+{
+    unsigned int epoch = pubsub_read_lock();
+    pubsub_topic_t topic = pubsub_find_topic_unlocked(topic_name);
+    pubsub_read_unlock(epoch);
+    return topic;
 }
 
 static pubsub_topic_detail_t* pubsub_find_topic_detail(const char *topic_name)
 {
-    ESP_LOGV(tag, "pubsub_find_topic_detail, topic:%s", topic_name);
-    pubsub_topic_detail_t *candidate;
-    LIST_FOREACH(candidate, &pubsub_topic_subscribers, pointers)
-    {
-        if (strcmp(candidate->topic, topic_name) == 0) {
-            // found
-            ESP_LOGV(tag, "pubsub_find_topic_detail, found:%p", candidate);
-            return candidate;
+    return pubsub_get_topic_detail(pubsub_find_topic_unlocked(topic_name));
+}
+
+/**
+ * Topic name, interned, remains valid after unregistering.
+ */
+const char* pubsub_topic_name(pubsub_topic_t topic)
+{
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    if (topic_detail == NULL) {
+        return NULL;
+    }
+    return topic_detail->topic;
+}
+
+bool pubsub_published_h(pubsub_topic_t topic)
+{
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    // the last value sequence moves on each write
+    return topic_detail != NULL && atomic_load(&topic_detail->sequence) != 0;
+}
+
+/**
+ * Intern topic name, equal names share storage.
+ * Names are never released, a topic registered again reuses its name.
+ * Only called with pubsub_mutex taken.
+ * @return interned name, NULL if arena full.
+ */
+static const char* pubsub_intern_name(const char *topic_name)
+{
+    uint16_t position = 0;
+    while (position < pubsub_names_used) {
+        const char *name = &pubsub_names[position];
+        if (strcmp(name, topic_name) == 0) {
+            return name;
         }
+        position += strlen(name) + 1;
     }
-    ESP_LOGV(tag, "pubsub_find_topic_detail, found:none");
-    return NULL;
+    size_t size = strlen(topic_name) + 1;
+    if (pubsub_names_used + size > PUBSUB_NAME_ARENA_SIZE) {
+        ESP_LOGE(tag, "pubsub_intern_name, arena full topic:%s", topic_name);
+        return NULL;
+    }
+    char *name = &pubsub_names[pubsub_names_used];
+    memcpy(name, topic_name, size);
+    pubsub_names_used += size;
+    return name;
 }
 
+/**
+ * Take subscriber from pool.
+ * Only called with pubsub_mutex taken.
+ * @return subscriber, NULL if pool empty.
+ */
 static pubsub_subscriber_t* pubsub_create_subscriber(QueueHandle_t subscriber_queue)
 {
     ESP_LOGV(tag, "pubsub_create_subscriber, queue:%p", subscriber_queue);
 
-    pubsub_subscriber_t *subscriber = (pubsub_subscriber_t*) malloc(sizeof(pubsub_subscriber_t));
+    pubsub_subscriber_t *subscriber = pubsub_free_subscribers;
+    if (subscriber == NULL) {
+        ESP_LOGE(tag, "pubsub_create_subscriber, pool empty");
+        return NULL;
+    }
+    pubsub_free_subscribers = atomic_load(&subscriber->next);
+    pubsub_subscribers_used++;
     subscriber->queue = subscriber_queue;
+    subscriber->latest = NULL;
+    subscriber->change_bit = 0;
+    subscriber->pattern = NULL;
+    subscriber->compact = false;
+    subscriber->delivery = PUBSUB_DELIVERY_DROP_NEWEST;
+    subscriber->timeout = 0;
+    subscriber->priority = PUBSUB_PRIORITY_NORMAL;
+    atomic_init(&subscriber->pending, false);
+    atomic_init(&subscriber->delivered, 0);
+    atomic_init(&subscriber->dropped, 0);
+    atomic_init(&subscriber->coalesced, 0);
+    atomic_init(&subscriber->high_water, 0);
+    atomic_init(&subscriber->next, NULL);
     return subscriber;
 }
 
 /**
- * Add topic name to list.
- * @return the topic.
+ * Return subscriber to pool, after it is unlinked and pubsub_synchronize.
+ * Only called with pubsub_mutex taken.
+ */
+static void pubsub_delete_subscriber(pubsub_subscriber_t *subscriber)
+{
+    atomic_store(&subscriber->next, pubsub_free_subscribers);
+    pubsub_free_subscribers = subscriber;
+    pubsub_subscribers_used--;
+}
+
+/**
+ * Link subscriber to topic, visible to publishers when linked.
+ * Inserted before the first subscriber of the same or lower priority,
+ * publishers traversing the list see it either complete or not at all.
+ */
+static void pubsub_link_subscriber(pubsub_topic_detail_t *topic_detail, pubsub_subscriber_t *subscriber)
+{
+    _Atomic(pubsub_subscriber_t*) *link = &topic_detail->subscribers;
+    pubsub_subscriber_t *candidate;
+    while ((candidate = atomic_load(link)) != NULL && candidate->priority > subscriber->priority) {
+        link = &candidate->next;
+    }
+    atomic_store(&subscriber->next, candidate);
+    atomic_store(link, subscriber);
+}
+
+/**
+ * Add topic name to registry.
+ * @return the topic, NULL if registry full.
  */
-static pubsub_topic_detail_t* pubsub_add_topic_detail(const char *topic_name, pubsub_type_t type, const bool always)
+static pubsub_topic_detail_t* pubsub_add_topic_detail(const char *topic_name, pubsub_type_t type, const bool always,
+        const pubsub_filter_t *filter)
 {
     ESP_LOGV(tag, "pubsub_add_topic_detail, topic:%s", topic_name);
-    pubsub_topic_detail_t *topic_detail = (pubsub_topic_detail_t*) malloc(sizeof(pubsub_topic_detail_t));
-    topic_detail->topic = strdup(topic_name);
+    pubsub_topic_detail_t *topic_detail = NULL;
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        if (atomic_load(&pubsub_topics[index].topic) == NULL) {
+            topic_detail = &pubsub_topics[index];
+            break;
+        }
+    }
+    if (topic_detail == NULL) {
+        ESP_LOGE(tag, "pubsub_add_topic_detail, registry full topic:%s", topic_name);
+        return NULL;
+    }
+    const char *name = pubsub_intern_name(topic_name);
+    if (name == NULL) {
+        return NULL;
+    }
     topic_detail->type = type;
     topic_detail->always = always;
-    if (type == PUBSUB_TYPE_INT) {
-        topic_detail->int_val = 0;
-    } else if (type == PUBSUB_TYPE_DOUBLE) {
-        topic_detail->double_val = 0;
-    } else if (type == PUBSUB_TYPE_BOOLEAN) {
-        topic_detail->boolean_val = false;
-    } else {
+    atomic_store(&topic_detail->sequence, 0);
+    // zero, false and 0.0 in every type, publish compares all value bits
+    topic_detail->value.int_val = 0;
+    topic_detail->filter = *filter;
+    topic_detail->forwarded.int_val = 0;
+    topic_detail->forwarded_time = PUBSUB_NEVER;
+    topic_detail->pending = false;
+    if (type != PUBSUB_TYPE_INT && type != PUBSUB_TYPE_DOUBLE && type != PUBSUB_TYPE_FLOAT && type != PUBSUB_TYPE_BOOLEAN) {
         ESP_LOGE(tag, "pubsub_add_topic_detail, invalid type:%d", type);
     }
-    LIST_INSERT_HEAD(&pubsub_topic_subscribers, topic_detail, pointers);
-    LIST_INIT(&(topic_detail->subscribers));
+    atomic_store(&topic_detail->subscribers, NULL);
+    atomic_store(&topic_detail->delivered, 0);
+    atomic_store(&topic_detail->dropped, 0);
+    atomic_store(&topic_detail->coalesced, 0);
+    atomic_store(&topic_detail->suppressed, 0);
+    // visible to publishers when complete
+    atomic_store(&topic_detail->topic, name);
+    pubsub_index_insert(&pubsub_topic_index, name, pubsub_get_topic(topic_detail));
     ESP_LOGV(tag, "pubsub_add_topic_detail, subscribers:%p", topic_detail);
     return topic_detail;
 }
 
-static void pubsub_publish_one(QueueHandle_t queue, pubsub_message_t *message)
+/**
+ * Convert message to compact message, int saturates to 32 bit, double rounds to float.
+ */
+static void pubsub_compact_from_message(pubsub_compact_t *compact, const pubsub_message_t *message)
+{
+    compact->handle = message->handle;
+    compact->type = message->type;
+    compact->reserved = 0;
+    if (message->type == PUBSUB_TYPE_INT) {
+        int64_t value = message->int_val;
+        compact->int_val = value > INT32_MAX ? INT32_MAX : (value < INT32_MIN ? INT32_MIN : (int32_t) value);
+    } else if (message->type == PUBSUB_TYPE_DOUBLE) {
+        compact->float_val = (float) message->double_val;
+    } else if (message->type == PUBSUB_TYPE_FLOAT) {
+        compact->float_val = message->float_val;
+    } else {
+        compact->int_val = message->boolean_val;
+    }
+}
+
+/**
+ * Find queue subscriber of topic, inside read section or with pubsub_mutex taken.
+ * @return subscriber, NULL if not subscribed.
+ */
+static pubsub_subscriber_t* pubsub_find_subscriber(pubsub_topic_detail_t *topic_detail, QueueHandle_t queue)
+{
+    pubsub_subscriber_t *subscriber = atomic_load(&topic_detail->subscribers);
+    while (subscriber != NULL) {
+        if (subscriber->latest == NULL && subscriber->queue == queue) {
+            return subscriber;
+        }
+        subscriber = atomic_load(&subscriber->next);
+    }
+    return NULL;
+}
+
+/**
+ * Message removed from a full queue to make room (PUBSUB_DELIVERY_DROP_OLDEST).
+ * The queue may be shared: count the drop against the subscriber of the evicted topic
+ * and allow its next message if it coalesces.
+ * Inside read section or with pubsub_mutex taken.
+ */
+static void pubsub_evicted(QueueHandle_t queue, pubsub_topic_t topic)
+{
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    if (topic_detail == NULL) {
+        return;
+    }
+    pubsub_subscriber_t *subscriber = pubsub_find_subscriber(topic_detail, queue);
+    if (subscriber != NULL) {
+        if (subscriber->delivery == PUBSUB_DELIVERY_COALESCE) {
+            atomic_store(&subscriber->pending, false);
+        }
+        atomic_fetch_add(&subscriber->dropped, 1);
+    }
+    atomic_fetch_add(&topic_detail->dropped, 1);
+    pubsub_trace(PUBSUB_TRACE_DROP, topic, queue);
+}
+
+/**
+ * Send message to queue subscriber, apply delivery policy and count.
+ * @param initial last known value sent on subscribe with pubsub_mutex taken, never waits for queue space.
+ */
+static void pubsub_publish_one(pubsub_topic_detail_t *topic_detail, pubsub_subscriber_t *subscriber, pubsub_message_t *message,
+        bool initial)
+{
+    QueueHandle_t queue = subscriber->queue;
+    ESP_LOGD(tag, "pubsub_publish_one, queue:%p", queue);
+    pubsub_delivery_t delivery = subscriber->delivery;
+    if (delivery == PUBSUB_DELIVERY_COALESCE && atomic_exchange(&subscriber->pending, true)) {
+        // already queued, pubsub_receive delivers the last value
+        atomic_fetch_add(&subscriber->coalesced, 1);
+        atomic_fetch_add(&topic_detail->coalesced, 1);
+        return;
+    }
+    const void *item = message;
+    pubsub_compact_t compact;
+    if (subscriber->compact) {
+        pubsub_compact_from_message(&compact, message);
+        item = &compact;
+    }
+    TickType_t timeout = delivery == PUBSUB_DELIVERY_BLOCK && !initial ? subscriber->timeout : 0;
+    // before sending, a higher priority receiver runs before the send returns
+    pubsub_trace(PUBSUB_TRACE_DELIVER, message->handle, queue);
+    BaseType_t result = xQueueSendToBack(queue, item, timeout);
+    if (result != pdTRUE && delivery == PUBSUB_DELIVERY_DROP_OLDEST) {
+        // make room, the oldest message is the one dropped (fits either item size)
+        union
+        {
+            pubsub_message_t message;
+            pubsub_compact_t compact;
+        } oldest;
+        if (xQueueReceive(queue, &oldest, 0) == pdTRUE) {
+            pubsub_evicted(queue, subscriber->compact ? oldest.compact.handle : oldest.message.handle);
+        }
+        result = xQueueSendToBack(queue, item, 0);
+    }
+    if (result != pdTRUE) {
+        if (delivery == PUBSUB_DELIVERY_COALESCE) {
+            atomic_store(&subscriber->pending, false);
+        }
+        atomic_fetch_add(&subscriber->dropped, 1);
+        atomic_fetch_add(&topic_detail->dropped, 1);
+        pubsub_trace(PUBSUB_TRACE_DROP, message->handle, queue);
+        ESP_LOGW(tag, "pubsub_publish_one, dropped topic:%s, queue:%p", message->topic, queue);
+    } else {
+        atomic_fetch_add(&subscriber->delivered, 1);
+        atomic_fetch_add(&topic_detail->delivered, 1);
+        unsigned int waiting = uxQueueMessagesWaiting(queue);
+        unsigned int high_water = atomic_load(&subscriber->high_water);
+        while (waiting > high_water && !atomic_compare_exchange_weak(&subscriber->high_water, &high_water, waiting)) {
+        }
+        ESP_LOGV(tag, "pubsub_publish_one, ok topic:%s", message->topic);
+    }
+}
+
+/**
+ * Send last known value of topic to queue subscriber.
+ * Only called with pubsub_mutex taken.
+ */
+static void pubsub_publish_current(pubsub_topic_detail_t *topic_detail, pubsub_subscriber_t *subscriber)
+{
+    pubsub_message_t message;
+    pubsub_value_t value;
+    pubsub_value_read(topic_detail, &value);
+    message.topic = topic_detail->topic;
+    message.handle = pubsub_get_topic(topic_detail);
+    message.type = topic_detail->type;
+    // all value bits, whatever the type
+    message.int_val = value.int_val;
+    pubsub_publish_one(topic_detail, subscriber, &message, true);
+}
+
+/**
+ * Add subscription to topic name, queue full drops the new message.
+ */
+void pubsub_add_subscription(QueueHandle_t subscriber_queue, const char *topic_name, bool hot)
+{
+    pubsub_add_subscription_policy(subscriber_queue, topic_name, hot, PUBSUB_DELIVERY_DROP_NEWEST, 0, PUBSUB_PRIORITY_NORMAL);
+}
+
+/**
+ * Add queue subscription to topic name.
+ */
+static void pubsub_subscribe_queue(QueueHandle_t subscriber_queue, const char *topic_name, bool hot, pubsub_delivery_t delivery,
+        TickType_t timeout, pubsub_priority_t priority, bool compact)
+{
+    ESP_LOGI(tag, "pubsub_add_subscription, topic:%s, queue:%p, delivery:%d, priority:%d, compact:%d", topic_name,
+            subscriber_queue, delivery, priority, compact);
+    if (delivery == PUBSUB_DELIVERY_BLOCK && timeout > PUBSUB_BLOCK_TIMEOUT_MAX) {
+        ESP_LOGW(tag, "pubsub_add_subscription, timeout:%u capped to:%u, topic:%s", (unsigned) timeout,
+                (unsigned) PUBSUB_BLOCK_TIMEOUT_MAX, topic_name);
+        timeout = PUBSUB_BLOCK_TIMEOUT_MAX;
+    }
+
+    pubsub_lock();
+    // find existing topic by name
+    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
+    if (topic_detail == NULL) {
+        pubsub_unlock();
+        ESP_LOGE(tag, "pubsub_add_subscription, unknown topic:%s", topic_name);
+        return;
+    }
+    // add subscriber to topic
+    pubsub_subscriber_t *subscriber = pubsub_create_subscriber(subscriber_queue);
+    if (subscriber == NULL) {
+        pubsub_unlock();
+        return;
+    }
+    subscriber->compact = compact;
+    subscriber->delivery = delivery;
+    subscriber->timeout = timeout;
+    subscriber->priority = priority;
+    pubsub_link_subscriber(topic_detail, subscriber);
+    // publish last known value if hot
+    if (hot) {
+        pubsub_publish_current(topic_detail, subscriber);
+    }
+    pubsub_unlock();
+}
+
+/**
+ * Add subscription to topic name with delivery policy and priority.
+ * @param timeout wait for queue space (PUBSUB_DELIVERY_BLOCK only), at most PUBSUB_BLOCK_TIMEOUT_MAX.
+ */
+void pubsub_add_subscription_policy(QueueHandle_t subscriber_queue, const char *topic_name, bool hot, pubsub_delivery_t delivery,
+        TickType_t timeout, pubsub_priority_t priority)
+{
+    pubsub_subscribe_queue(subscriber_queue, topic_name, hot, delivery, timeout, priority, false);
+}
+
+/**
+ * Add subscription to topic name, the queue receives pubsub_compact_t.
+ * For topics with values that fit 32 bit, doubles are rounded to float.
+ * @param timeout wait for queue space (PUBSUB_DELIVERY_BLOCK only), at most PUBSUB_BLOCK_TIMEOUT_MAX.
+ */
+void pubsub_add_compact_subscription(QueueHandle_t subscriber_queue, const char *topic_name, bool hot, pubsub_delivery_t delivery,
+        TickType_t timeout, pubsub_priority_t priority)
+{
+    pubsub_subscribe_queue(subscriber_queue, topic_name, hot, delivery, timeout, priority, true);
+}
+
+/**
+ * Coalesced message received, allow the next one and read the last value.
+ * @return true if value read (subscription coalesces).
+ */
+static bool pubsub_received(QueueHandle_t queue, pubsub_topic_t topic, pubsub_value_t *value)
+{
+    bool coalesced = false;
+    unsigned int epoch = pubsub_read_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    if (topic_detail != NULL) {
+        pubsub_subscriber_t *subscriber = pubsub_find_subscriber(topic_detail, queue);
+        if (subscriber != NULL && subscriber->delivery == PUBSUB_DELIVERY_COALESCE) {
+            // clear before reading, a later publish queues again
+            atomic_store(&subscriber->pending, false);
+            pubsub_value_read(topic_detail, value);
+            coalesced = true;
+        }
+    }
+    pubsub_read_unlock(epoch);
+    return coalesced;
+}
+
+/**
+ * Receive message from subscriber queue.
+ * Required for PUBSUB_DELIVERY_COALESCE subscriptions: allows the next message
+ * to be queued and replaces the value with the last published value.
+ * @return pdTRUE if message received.
+ */
+BaseType_t pubsub_receive(QueueHandle_t queue, pubsub_message_t *message, TickType_t timeout)
+{
+    BaseType_t result = xQueueReceive(queue, message, timeout);
+    pubsub_value_t value;
+    if (result == pdTRUE && pubsub_received(queue, message->handle, &value)) {
+        message->int_val = value.int_val;
+    }
+    if (result == pdTRUE) {
+        pubsub_trace(PUBSUB_TRACE_RECEIVE, message->handle, queue);
+    }
+    return result;
+}
+
+/**
+ * Receive compact message from subscriber queue, see pubsub_receive.
+ * @return pdTRUE if message received.
+ */
+BaseType_t pubsub_receive_compact(QueueHandle_t queue, pubsub_compact_t *compact, TickType_t timeout)
+{
+    BaseType_t result = xQueueReceive(queue, compact, timeout);
+    pubsub_value_t value;
+    if (result == pdTRUE && pubsub_received(queue, compact->handle, &value)) {
+        pubsub_message_t message;
+        message.handle = compact->handle;
+        message.type = compact->type;
+        message.int_val = value.int_val;
+        pubsub_compact_from_message(compact, &message);
+    }
+    if (result == pdTRUE) {
+        pubsub_trace(PUBSUB_TRACE_RECEIVE, compact->handle, queue);
+    }
+    return result;
+}
+
+/**
+ * Remove subscription to topic
+ */
+void pubsub_remove_subscription(QueueHandle_t subscriber_queue, const char *topic_name)
+{
+    ESP_LOGI(tag, "pubsub_remove_subscription, topic:%s, queue:%p", topic_name, subscriber_queue);
+    pubsub_lock();
+    // find existing topic by name
+    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
+    if (topic_detail != NULL) {
+        // remove subscriber from topic
+        _Atomic(pubsub_subscriber_t*) *link = &topic_detail->subscribers;
+        pubsub_subscriber_t *candidate;
+        while ((candidate = atomic_load(link)) != NULL) {
+            if (candidate->latest == NULL && candidate->pattern == NULL && candidate->queue == subscriber_queue) {
+                ESP_LOGD(tag, "pubsub_remove_subscription, topic:%s, queue:%p found", topic_name, subscriber_queue);
+                // unlink, publishers still traversing it continue at next
+                atomic_store(link, atomic_load(&candidate->next));
+                pubsub_synchronize();
+                pubsub_delete_subscriber(candidate);
+                break;
+            }
+            link = &candidate->next;
+        }
+    }
+    pubsub_unlock();
+}
+
+/**
+ * Create latest value subscriber.
+ * @param task to notify on change (eSetBits notify_bits), NULL to poll pubsub_latest_changes.
+ * @return latest value subscriber, NULL if pool empty.
+ */
+pubsub_latest_t* pubsub_latest_create(TaskHandle_t task, uint32_t notify_bits)
+{
+    pubsub_latest_t *latest = NULL;
+    pubsub_lock();
+    for (int index = 0; index < PUBSUB_MAX_LATEST; index++) {
+        if (!pubsub_latests[index].used) {
+            latest = &pubsub_latests[index];
+            latest->used = true;
+            break;
+        }
+    }
+    pubsub_unlock();
+    if (latest == NULL) {
+        ESP_LOGE(tag, "pubsub_latest_create, pool empty");
+        return NULL;
+    }
+    atomic_init(&latest->changes, 0);
+    atomic_init(&latest->since, 0);
+    latest->count = 0;
+    latest->task = task;
+    latest->notify_bits = notify_bits;
+    latest->priority = PUBSUB_PRIORITY_NORMAL;
+    return latest;
+}
+
+/**
+ * Set priority of the subscriptions added after this call.
+ */
+void pubsub_latest_set_priority(pubsub_latest_t *latest, pubsub_priority_t priority)
+{
+    if (latest != NULL) {
+        latest->priority = priority;
+    }
+}
+
+/**
+ * Set change bit without notifying the task.
+ */
+static void pubsub_mark_latest(pubsub_latest_t *latest, uint32_t change_bit)
+{
+    if (atomic_fetch_or(&latest->changes, change_bit) == 0) {
+        atomic_store(&latest->since, clock_now());
+    }
+}
+
+static void pubsub_notify_latest(pubsub_latest_t *latest)
+{
+    if (latest->task != NULL) {
+        xTaskNotify(latest->task, latest->notify_bits, eSetBits);
+    }
+}
+
+static void pubsub_publish_latest(pubsub_latest_t *latest, uint32_t change_bit)
+{
+    pubsub_mark_latest(latest, change_bit);
+    pubsub_notify_latest(latest);
+}
+
+/**
+ * Add latest value subscription to topic.
+ * The change bit is set (and task notified) initially, the first pass reads the current value.
+ * @return change bit of topic, 0 on failure.
+ */
+uint32_t pubsub_add_latest_subscription(pubsub_latest_t *latest, pubsub_topic_t topic)
+{
+    if (latest == NULL) {
+        return 0;
+    }
+    pubsub_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    if (topic_detail == NULL) {
+        pubsub_unlock();
+        ESP_LOGE(tag, "pubsub_add_latest_subscription, unknown topic:%d", topic);
+        return 0;
+    }
+    if (latest->count >= 32) {
+        pubsub_unlock();
+        ESP_LOGE(tag, "pubsub_add_latest_subscription, too many topics:%s", topic_detail->topic);
+        return 0;
+    }
+    ESP_LOGI(tag, "pubsub_add_latest_subscription, topic:%s, latest:%p", topic_detail->topic, latest);
+    pubsub_subscriber_t *subscriber = pubsub_create_subscriber(NULL);
+    if (subscriber == NULL) {
+        pubsub_unlock();
+        return 0;
+    }
+    subscriber->latest = latest;
+    subscriber->change_bit = 1u << latest->count++;
+    subscriber->priority = latest->priority;
+    pubsub_link_subscriber(topic_detail, subscriber);
+    pubsub_publish_latest(latest, subscriber->change_bit);
+    pubsub_unlock();
+    return subscriber->change_bit;
+}
+
+/**
+ * Match topic name against pattern, segments separated by '.'.
+ * '*' matches one segment, a trailing '*' matches one or more segments.
+ */
+static bool pubsub_pattern_match(const char *pattern, const char *name)
+{
+    while (true) {
+        if (pattern[0] == '*' && pattern[1] == '\0') {
+            // trailing wildcard, rest of name
+            return *name != '\0';
+        } else if (pattern[0] == '*' && pattern[1] == '.') {
+            // skip one non empty segment
+            if (*name == '\0' || *name == '.') {
+                return false;
+            }
+            while (*name != '\0' && *name != '.') {
+                name++;
+            }
+            if (*name == '\0') {
+                return false;
+            }
+            pattern += 2;
+            name++;
+        } else {
+            // literal segment
+            while (*pattern != '\0' && *pattern != '.') {
+                if (*pattern++ != *name++) {
+                    return false;
+                }
+            }
+            if (*pattern != *name) {
+                return false;
+            }
+            if (*pattern == '\0') {
+                return true;
+            }
+            pattern++;
+            name++;
+        }
+    }
+}
+
+/**
+ * Subscribe pattern to one topic.
+ * Only called with pubsub_mutex taken.
+ * @param initial true when the topic existed before the pattern (hot publish applies).
+ * @return false if subscriber pool empty.
+ */
+static bool pubsub_subscribe_pattern(pubsub_pattern_t *pattern, pubsub_topic_detail_t *topic_detail, bool initial)
+{
+    pubsub_subscriber_t *subscriber = pubsub_create_subscriber(pattern->queue);
+    if (subscriber == NULL) {
+        ESP_LOGE(tag, "pubsub_subscribe_pattern, not subscribed topic:%s, pattern:%s", topic_detail->topic,
+                pattern->pattern);
+        return false;
+    }
+    subscriber->latest = pattern->latest;
+    subscriber->change_bit = pattern->change_bit;
+    subscriber->pattern = pattern;
+    if (pattern->latest != NULL) {
+        subscriber->priority = pattern->latest->priority;
+    }
+    pubsub_link_subscriber(topic_detail, subscriber);
+    if (pattern->latest != NULL) {
+        pubsub_publish_latest(pattern->latest, pattern->change_bit);
+    } else if (pattern->hot && initial) {
+        pubsub_publish_current(topic_detail, subscriber);
+    }
+    return true;
+}
+
+/**
+ * Subscribe all matching patterns to a new topic.
+ * Only called with pubsub_mutex taken.
+ */
+static void pubsub_match_patterns(pubsub_topic_detail_t *topic_detail)
+{
+    for (int index = 0; index < PUBSUB_MAX_PATTERNS; index++) {
+        pubsub_pattern_t *pattern = &pubsub_patterns[index];
+        if (pattern->pattern != NULL && pubsub_pattern_match(pattern->pattern, topic_detail->topic)) {
+            ESP_LOGD(tag, "pubsub_match_patterns, topic:%s, pattern:%s", topic_detail->topic, pattern->pattern);
+            pubsub_subscribe_pattern(pattern, topic_detail, false);
+        }
+    }
+}
+
+static void pubsub_delete_pattern(pubsub_pattern_t *pattern);
+
+/**
+ * Take pattern from pool and subscribe it to all matching topics.
+ * Only called with pubsub_mutex taken.
+ * @return pattern, NULL if pool, name arena or subscriber pool full (nothing subscribed).
+ */
+static pubsub_pattern_t* pubsub_create_pattern(const char *pattern_name, QueueHandle_t queue, pubsub_latest_t *latest,
+        uint32_t change_bit, bool hot)
+{
+    pubsub_pattern_t *pattern = NULL;
+    for (int index = 0; index < PUBSUB_MAX_PATTERNS; index++) {
+        if (pubsub_patterns[index].pattern == NULL) {
+            pattern = &pubsub_patterns[index];
+            break;
+        }
+    }
+    if (pattern == NULL) {
+        ESP_LOGE(tag, "pubsub_create_pattern, pool empty pattern:%s", pattern_name);
+        return NULL;
+    }
+    const char *name = pubsub_intern_name(pattern_name);
+    if (name == NULL) {
+        return NULL;
+    }
+    pattern->pattern = name;
+    pattern->queue = queue;
+    pattern->latest = latest;
+    pattern->change_bit = change_bit;
+    pattern->hot = hot;
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        pubsub_topic_detail_t *topic_detail = &pubsub_topics[index];
+        const char *topic_name = atomic_load(&topic_detail->topic);
+        if (topic_name != NULL && pubsub_pattern_match(name, topic_name)
+                && !pubsub_subscribe_pattern(pattern, topic_detail, true)) {
+            pubsub_delete_pattern(pattern);
+            return NULL;
+        }
+    }
+    return pattern;
+}
+
+/**
+ * Unsubscribe pattern from all topics and return it to pool.
+ * Only called with pubsub_mutex taken.
+ */
+static void pubsub_delete_pattern(pubsub_pattern_t *pattern)
+{
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        _Atomic(pubsub_subscriber_t*) *link = &pubsub_topics[index].subscribers;
+        pubsub_subscriber_t *candidate;
+        while ((candidate = atomic_load(link)) != NULL) {
+            if (candidate->pattern == pattern) {
+                // unlink, publishers still traversing it continue at next
+                atomic_store(link, atomic_load(&candidate->next));
+                pubsub_synchronize();
+                pubsub_delete_subscriber(candidate);
+            } else {
+                link = &candidate->next;
+            }
+        }
+    }
+    pattern->pattern = NULL;
+}
+
+/**
+ * Add subscription to all topics matching pattern, including topics registered later.
+ * Segments are separated by '.', '*' matches one segment, a trailing '*' one or more ("temp.*", "*.pv").
+ * @param hot send last known value of the topics existing now.
+ * @return true if successful.
+ */
+bool pubsub_add_pattern_subscription(QueueHandle_t subscriber_queue, const char *pattern, bool hot)
+{
+    ESP_LOGI(tag, "pubsub_add_pattern_subscription, pattern:%s, queue:%p", pattern, subscriber_queue);
+    pubsub_lock();
+    bool success = pubsub_create_pattern(pattern, subscriber_queue, NULL, 0, hot) != NULL;
+    pubsub_unlock();
+    return success;
+}
+
+/**
+ * Remove pattern subscription, subscriptions by topic name are not affected.
+ */
+void pubsub_remove_pattern_subscription(QueueHandle_t subscriber_queue, const char *pattern)
+{
+    ESP_LOGI(tag, "pubsub_remove_pattern_subscription, pattern:%s, queue:%p", pattern, subscriber_queue);
+    pubsub_lock();
+    for (int index = 0; index < PUBSUB_MAX_PATTERNS; index++) {
+        pubsub_pattern_t *candidate = &pubsub_patterns[index];
+        if (candidate->pattern != NULL && candidate->latest == NULL && candidate->queue == subscriber_queue
+                && strcmp(candidate->pattern, pattern) == 0) {
+            pubsub_delete_pattern(candidate);
+            break;
+        }
+    }
+    pubsub_unlock();
+}
+
+/**
+ * Add latest value subscription to all topics matching pattern, including topics registered later.
+ * All matching topics share one change bit.
+ * @return change bit of pattern, 0 on failure.
+ */
+uint32_t pubsub_add_latest_pattern(pubsub_latest_t *latest, const char *pattern)
+{
+    if (latest == NULL) {
+        return 0;
+    }
+    ESP_LOGI(tag, "pubsub_add_latest_pattern, pattern:%s, latest:%p", pattern, latest);
+    pubsub_lock();
+    if (latest->count >= 32) {
+        pubsub_unlock();
+        ESP_LOGE(tag, "pubsub_add_latest_pattern, too many topics:%s", pattern);
+        return 0;
+    }
+    uint32_t change_bit = 1u << latest->count;
+    if (pubsub_create_pattern(pattern, NULL, latest, change_bit, false) == NULL) {
+        pubsub_unlock();
+        return 0;
+    }
+    latest->count++;
+    pubsub_unlock();
+    return change_bit;
+}
+
+/**
+ * Take changes since previous call.
+ * @return change bits of topics published since previous call.
+ */
+uint32_t pubsub_latest_changes(pubsub_latest_t *latest)
+{
+    uint32_t changes = atomic_exchange(&latest->changes, 0);
+    atomic_store(&latest->since, 0);
+    if (changes != 0) {
+        pubsub_trace(PUBSUB_TRACE_LATEST, PUBSUB_TOPIC_INVALID, latest);
+    }
+    return changes;
+}
+
+/**
+ * Time of oldest pending change, without taking the changes.
+ * @return clock_now time [us], 0 if no changes pending or time not yet known.
+ */
+int64_t pubsub_latest_since(pubsub_latest_t *latest)
+{
+    if (atomic_load(&latest->changes) == 0) {
+        return 0;
+    }
+    return atomic_load(&latest->since);
+}
+
+/**
+ * Remove all subscriptions of latest value subscriber and delete it.
+ */
+void pubsub_latest_delete(pubsub_latest_t *latest)
+{
+    ESP_LOGI(tag, "pubsub_latest_delete, latest:%p", latest);
+    pubsub_lock();
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        _Atomic(pubsub_subscriber_t*) *link = &pubsub_topics[index].subscribers;
+        pubsub_subscriber_t *candidate;
+        while ((candidate = atomic_load(link)) != NULL) {
+            if (candidate->latest == latest) {
+                // unlink, publishers still traversing it continue at next
+                atomic_store(link, atomic_load(&candidate->next));
+                pubsub_synchronize();
+                pubsub_delete_subscriber(candidate);
+            } else {
+                link = &candidate->next;
+            }
+        }
+    }
+    for (int index = 0; index < PUBSUB_MAX_PATTERNS; index++) {
+        if (pubsub_patterns[index].pattern != NULL && pubsub_patterns[index].latest == latest) {
+            pubsub_patterns[index].pattern = NULL;
+        }
+    }
+    latest->used = false;
+    pubsub_unlock();
+}
+
+/**
+ * Register topic with publish filter, NULL forwards every change.
+ * @return handle of new or existing topic, PUBSUB_TOPIC_INVALID on mismatch or if registry full.
+ */
+pubsub_topic_t pubsub_register_topic_filter(const char *topic_name, const pubsub_type_t type, const bool always,
+        const pubsub_filter_t *filter)
+{
+    static const pubsub_filter_t no_filter = { 0 };
+    if (filter == NULL) {
+        filter = &no_filter;
+    }
+    pubsub_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
+    if (topic_detail == NULL) {
+        topic_detail = pubsub_add_topic_detail(topic_name, type, always, filter);
+        if (topic_detail == NULL) {
+            pubsub_unlock();
+            return PUBSUB_TOPIC_INVALID;
+        }
+        ESP_LOGI(tag, "pubsub_register_topic, new topic:%s, topic:%p", topic_name, topic_detail);
+        pubsub_match_patterns(topic_detail);
+    } else {
+        if (topic_detail->type != type) {
+            ESP_LOGE(tag, "pubsub_register_topic, existing topic:%s, topic:%p, type:%d, mismatch new type:%d", topic_name,
+                    topic_detail, topic_detail->type, type);
+            pubsub_unlock();
+            return PUBSUB_TOPIC_INVALID;
+        } else if (topic_detail->always != always) {
+            ESP_LOGE(tag, "pubsub_register_topic, existing topic:%s, topic:%p, always:%d, mismatch new always:%d", topic_name,
+                    topic_detail, topic_detail->always, always);
+            pubsub_unlock();
+            return PUBSUB_TOPIC_INVALID;
+        } else if (memcmp(&topic_detail->filter, filter, sizeof(pubsub_filter_t)) != 0) {
+            ESP_LOGE(tag, "pubsub_register_topic, existing topic:%s, topic:%p, filter mismatch", topic_name, topic_detail);
+            pubsub_unlock();
+            return PUBSUB_TOPIC_INVALID;
+        } else {
+            ESP_LOGI(tag, "pubsub_register_topic, existing topic:%s, topic:%p", topic_name, topic_detail);
+        }
+    }
+    pubsub_unlock();
+    return pubsub_get_topic(topic_detail);
+}
+
+pubsub_topic_t pubsub_register_topic_handle(const char *topic_name, const pubsub_type_t type, const bool always)
+{
+    return pubsub_register_topic_filter(topic_name, type, always, NULL);
+}
+
+bool pubsub_register_topic(const char *topic_name, const pubsub_type_t type, const bool always)
+{
+    // success only when new
+    if (pubsub_find_topic(topic_name) != PUBSUB_TOPIC_INVALID) {
+        pubsub_register_topic_handle(topic_name, type, always);
+        return false;
+    }
+    return pubsub_register_topic_handle(topic_name, type, always) != PUBSUB_TOPIC_INVALID;
+}
+
+/**
+ * Mark topic change pending, called inside pubsub_spinlock critical section.
+ */
+static void pubsub_set_pending(pubsub_topic_detail_t *topic_detail, bool pending)
+{
+    if (topic_detail->pending != pending) {
+        topic_detail->pending = pending;
+        if (pending) {
+            atomic_fetch_add(&pubsub_pending_count, 1);
+        } else {
+            atomic_fetch_sub(&pubsub_pending_count, 1);
+        }
+    }
+}
+
+bool pubsub_unregister_topic(const char *topic_name)
+{
+    bool success = false;
+    ESP_LOGI(tag, "pubsub_unregister_topic, topic:%s", topic_name);
+    pubsub_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
+    if (topic_detail != NULL) {
+        ESP_LOGD(tag, "pubsub_unregister_topic, topic:%p", topic_detail);
+        // unlink topic and subscribers, publishers still using them finish first
+        const char *name = atomic_exchange(&topic_detail->topic, NULL);
+        pubsub_index_remove(&pubsub_topic_index, name);
+        pubsub_subscriber_t *subscriber = atomic_exchange(&topic_detail->subscribers, NULL);
+        pubsub_synchronize();
+        portENTER_CRITICAL(&pubsub_spinlock);
+        pubsub_set_pending(topic_detail, false);
+        portEXIT_CRITICAL(&pubsub_spinlock);
+        while (subscriber != NULL) {
+            ESP_LOGD(tag, "pubsub_unregister_topic, queue:%p", subscriber->queue);
+            pubsub_subscriber_t *next = atomic_load(&subscriber->next);
+            pubsub_delete_subscriber(subscriber);
+            subscriber = next;
+        }
+        success = true;
+    }
+    pubsub_unlock();
+    return success;
+}
+
+pubsub_type_t pubsub_get_type(const char *topic_name)
+{
+    pubsub_type_t topic_type = PUBSUB_TYPE_UNKNOWN;
+    unsigned int epoch = pubsub_read_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
+    if (topic_detail != NULL) {
+        topic_type = topic_detail->type;
+    }
+    pubsub_read_unlock(epoch);
+    return topic_type;
+}
+
+/**
+ * Log forwarded publish, binary log keeps formatting off the publishing task.
+ * Topic names are interned, valid until drained.
+ */
+static void pubsub_log_publish(const pubsub_topic_detail_t *topic_detail, const pubsub_message_t *message)
+{
+    binlog_arg_t name = binlog_string(topic_detail->topic);
+    if (topic_detail->type == PUBSUB_TYPE_INT) {
+        BINLOG_I(tag, "pubsub_publish, %s=%lld", name, binlog_int(message->int_val));
+    } else if (topic_detail->type == PUBSUB_TYPE_BOOLEAN) {
+        BINLOG_I(tag, "pubsub_publish, %s=%s", name, binlog_string(message->boolean_val ? "true" : "false"));
+    } else if (topic_detail->type == PUBSUB_TYPE_FLOAT) {
+        BINLOG_I(tag, "pubsub_publish, %s=%f", name, binlog_double(message->float_val));
+    } else {
+        BINLOG_I(tag, "pubsub_publish, %s=%lf", name, binlog_double(message->double_val));
+    }
+}
+
+/**
+ * Check message type against topic, fill in topic name and handle.
+ * @return true if message can be published to topic.
+ */
+static bool pubsub_prepare_message(pubsub_topic_detail_t *topic_detail, pubsub_message_t *message)
+{
+    if (topic_detail->type != message->type) {
+        ESP_LOGE(tag, "pubsub_publish, type mismatch topic:%s, type:%d, message type:%d", topic_detail->topic, topic_detail->type,
+                message->type);
+        return false;
+    }
+    message->topic = topic_detail->topic;
+    message->handle = pubsub_get_topic(topic_detail);
+    return true;
+}
+
+/**
+ * @return true if value is outside the deadband around the last forwarded value.
+ */
+static bool pubsub_outside_deadband(const pubsub_topic_detail_t *topic_detail, const pubsub_value_t *value)
+{
+    // all value bits compared (unused bits are zero)
+    if (topic_detail->forwarded.int_val == value->int_val) {
+        return false;
+    }
+    float deadband = topic_detail->filter.deadband;
+    if (deadband == 0 || topic_detail->type == PUBSUB_TYPE_BOOLEAN) {
+        return true;
+    }
+    double forwarded;
+    double difference;
+    if (topic_detail->type == PUBSUB_TYPE_INT) {
+        forwarded = topic_detail->forwarded.int_val;
+        difference = value->int_val - topic_detail->forwarded.int_val;
+    } else if (topic_detail->type == PUBSUB_TYPE_FLOAT) {
+        forwarded = topic_detail->forwarded.float_val;
+        difference = value->float_val - forwarded;
+    } else {
+        forwarded = topic_detail->forwarded.double_val;
+        difference = value->double_val - forwarded;
+    }
+    double threshold = topic_detail->filter.relative ? deadband * fabs(forwarded) : deadband;
+    // NaN is outside any deadband
+    return !(fabs(difference) <= threshold);
+}
+
+/**
+ * Store last value, called inside pubsub_spinlock critical section.
+ * @param now publish time [us]
+ * @return true if the publish is forwarded to subscribers.
+ */
+static bool pubsub_store_value(pubsub_topic_detail_t *topic_detail, const pubsub_message_t *message, int64_t now)
+{
+    pubsub_value_t value;
+    value.int_val = message->int_val;
+    pubsub_value_write(topic_detail, &value);
+    bool changed = topic_detail->always || pubsub_outside_deadband(topic_detail, &value);
+    bool forward = changed;
+    if (forward && topic_detail->filter.min_interval_ms != 0 && topic_detail->forwarded_time != PUBSUB_NEVER) {
+        forward = now - topic_detail->forwarded_time >= (int64_t) topic_detail->filter.min_interval_ms * 1000;
+    }
+    if (forward) {
+        topic_detail->forwarded = value;
+        topic_detail->forwarded_time = now;
+    } else if (topic_detail->forwarded.int_val != value.int_val) {
+        // changed, not forwarded
+        atomic_fetch_add(&topic_detail->suppressed, 1);
+    }
+    // held back by the minimum interval, back within the deadband clears it
+    pubsub_set_pending(topic_detail, changed && !forward);
+    return forward;
+}
+
+/**
+ * Inform all subscribers of topic, called inside read section.
+ * Latest value subscribers are notified unless notify is NULL,
+ * then their pool index is marked in notify for the caller to notify once.
+ */
+static void pubsub_deliver(pubsub_topic_detail_t *topic_detail, pubsub_message_t *message, bool *notify)
+{
+    pubsub_trace(PUBSUB_TRACE_PUBLISH, message->handle, NULL);
+    pubsub_subscriber_t *subscriber = atomic_load(&topic_detail->subscribers);
+    while (subscriber != NULL) {
+        if (subscriber->latest == NULL) {
+            pubsub_publish_one(topic_detail, subscriber, message, false);
+        } else {
+            pubsub_trace(PUBSUB_TRACE_DELIVER, message->handle, subscriber->latest);
+            if (notify == NULL) {
+                pubsub_publish_latest(subscriber->latest, subscriber->change_bit);
+            } else {
+                pubsub_mark_latest(subscriber->latest, subscriber->change_bit);
+                notify[subscriber->latest - pubsub_latests] = true;
+            }
+        }
+        subscriber = atomic_load(&subscriber->next);
+    }
+}
+
+/**
+ * Publish to topic, called inside read section.
+ */
+static void pubsub_publish_detail(pubsub_topic_detail_t *topic_detail, pubsub_message_t *message)
+{
+    if (!pubsub_prepare_message(topic_detail, message)) {
+        return;
+    }
+    // store last value, check if forwarded
+    int64_t now = clock_now();
+    portENTER_CRITICAL(&pubsub_spinlock);
+    bool forward = pubsub_store_value(topic_detail, message, now);
+    portEXIT_CRITICAL(&pubsub_spinlock);
+    // publish always or if changed, subject to filter
+    if (forward) {
+        pubsub_log_publish(topic_detail, message);
+        pubsub_deliver(topic_detail, message, NULL);
+    }
+}
+
+int64_t pubsub_forward_pending(int64_t now)
+{
+    if (atomic_load(&pubsub_pending_count) == 0) {
+        return 0;
+    }
+    int64_t next = 0;
+    unsigned int epoch = pubsub_read_lock();
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        pubsub_topic_detail_t *topic_detail = &pubsub_topics[index];
+        if (atomic_load(&topic_detail->topic) == NULL) {
+            continue;
+        }
+        bool forward = false;
+        pubsub_message_t message;
+        portENTER_CRITICAL(&pubsub_spinlock);
+        if (topic_detail->pending) {
+            int64_t due = topic_detail->forwarded_time + (int64_t) topic_detail->filter.min_interval_ms * 1000;
+            if (now >= due) {
+                topic_detail->forwarded = topic_detail->value;
+                topic_detail->forwarded_time = now;
+                pubsub_set_pending(topic_detail, false);
+                message.int_val = topic_detail->value.int_val;
+                forward = true;
+            } else if (next == 0 || due < next) {
+                next = due;
+            }
+        }
+        portEXIT_CRITICAL(&pubsub_spinlock);
+        if (forward) {
+            message.type = topic_detail->type;
+            message.topic = topic_detail->topic;
+            message.handle = pubsub_get_topic(topic_detail);
+            pubsub_log_publish(topic_detail, &message);
+            pubsub_deliver(topic_detail, &message, NULL);
+        }
+    }
+    pubsub_read_unlock(epoch);
+    return next;
+}
+
+/**
+ * Publish message with a value without unused bits.
+ */
+static void pubsub_publish_value_h(pubsub_topic_t topic, pubsub_message_t *message)
+{
+    unsigned int epoch = pubsub_read_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    if (topic_detail == NULL) {
+        pubsub_read_unlock(epoch);
+        ESP_LOGE(tag, "pubsub_publish_h, unknown topic:%d", topic);
+        return;
+    }
+    pubsub_publish_detail(topic_detail, message);
+    pubsub_read_unlock(epoch);
+}
+
+/**
+ * Copy message with unused value bits cleared, the typed publish functions clear them already.
+ * @return false if type unknown.
+ */
+static bool pubsub_normalize_message(pubsub_message_t *normalized, const pubsub_message_t *message)
+{
+    *normalized = *message;
+    normalized->int_val = 0;
+    if (message->type == PUBSUB_TYPE_INT) {
+        normalized->int_val = message->int_val;
+    } else if (message->type == PUBSUB_TYPE_BOOLEAN) {
+        normalized->boolean_val = message->boolean_val;
+    } else if (message->type == PUBSUB_TYPE_DOUBLE) {
+        normalized->double_val = message->double_val;
+    } else if (message->type == PUBSUB_TYPE_FLOAT) {
+        normalized->float_val = message->float_val;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void pubsub_publish_h(pubsub_topic_t topic, pubsub_message_t *message)
+{
+    pubsub_message_t normalized;
+    if (!pubsub_normalize_message(&normalized, message)) {
+        ESP_LOGE(tag, "pubsub_publish_h, unknown type:%d, topic:%d", message->type, topic);
+        return;
+    }
+    pubsub_publish_value_h(topic, &normalized);
+    *message = normalized;
+}
+
+void pubsub_publish_bool_h(pubsub_topic_t topic, bool value)
+{
+    ESP_LOGD(tag, "pubsub_publish_bool_h, topic:%d, value:%s", topic, value ? "true" : "false");
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_BOOLEAN;
+    message.int_val = 0;
+    message.boolean_val = value;
+    pubsub_publish_value_h(topic, &message);
+}
+
+void pubsub_publish_int_h(pubsub_topic_t topic, int64_t value)
+{
+    ESP_LOGD(tag, "pubsub_publish_int_h, topic:%d, value:%lld", topic, value);
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_INT;
+    message.int_val = value;
+    pubsub_publish_value_h(topic, &message);
+}
+
+void pubsub_publish_double_h(pubsub_topic_t topic, double value)
+{
+    ESP_LOGD(tag, "pubsub_publish_double_h, topic:%d, value:%lf", topic, value);
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_DOUBLE;
+    message.int_val = 0;
+    message.double_val = value;
+    pubsub_publish_value_h(topic, &message);
+}
+
+void pubsub_publish_float_h(pubsub_topic_t topic, float value)
+{
+    ESP_LOGD(tag, "pubsub_publish_float_h, topic:%d, value:%f", topic, value);
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_FLOAT;
+    message.int_val = 0;
+    message.float_val = value;
+    pubsub_publish_value_h(topic, &message);
+}
+
+/*
+ * Batch publish.
+ * Correlated values (one sensor sample) are staged and committed together:
+ * all last values are stored before any subscriber is informed,
+ * readers using pubsub_snapshot_begin/retry never see part of a batch,
+ * and each latest value subscriber is notified once per batch.
+ */
+
+void pubsub_batch_begin(pubsub_batch_t *batch)
+{
+    batch->count = 0;
+}
+
+bool pubsub_batch_add(pubsub_batch_t *batch, pubsub_topic_t topic, const pubsub_message_t *message)
+{
+    if (batch->count >= PUBSUB_MAX_BATCH) {
+        ESP_LOGE(tag, "pubsub_batch_add, batch full, topic:%d", topic);
+        return false;
+    }
+    pubsub_message_t *staged = &batch->messages[batch->count];
+    if (!pubsub_normalize_message(staged, message)) {
+        ESP_LOGE(tag, "pubsub_batch_add, unknown type:%d, topic:%d", message->type, topic);
+        return false;
+    }
+    staged->handle = topic;
+    batch->count++;
+    return true;
+}
+
+bool pubsub_batch_bool(pubsub_batch_t *batch, pubsub_topic_t topic, bool value)
+{
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_BOOLEAN;
+    message.boolean_val = value;
+    return pubsub_batch_add(batch, topic, &message);
+}
+
+bool pubsub_batch_int(pubsub_batch_t *batch, pubsub_topic_t topic, int64_t value)
+{
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_INT;
+    message.int_val = value;
+    return pubsub_batch_add(batch, topic, &message);
+}
+
+bool pubsub_batch_double(pubsub_batch_t *batch, pubsub_topic_t topic, double value)
 {
-    ESP_LOGD(tag, "pubsub_publish_one, queue:%p", queue);
-    BaseType_t result = xQueueSendToBack(queue, message, 0);
-    if (result != pdTRUE) {
-        // todo handle errors
-        ESP_LOGE(tag, "pubsub_publish_one, error topic:%s, queue:%p", message->topic, queue);
-    } else {
-        ESP_LOGV(tag, "pubsub_publish_one, ok topic:%s", message->topic);
-    }
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_DOUBLE;
+    message.double_val = value;
+    return pubsub_batch_add(batch, topic, &message);
 }
-/**
- * Add subscription to topic name.
- */
-void pubsub_add_subscription(QueueHandle_t subscriber_queue, const char *topic_name, bool hot)
+
+bool pubsub_batch_float(pubsub_batch_t *batch, pubsub_topic_t topic, float value)
 {
-    ESP_LOGI(tag, "pubsub_add_subscription, topic:%s, queue:%p", topic_name, subscriber_queue);
+    pubsub_message_t message;
+    message.type = PUBSUB_TYPE_FLOAT;
+    message.float_val = value;
+    return pubsub_batch_add(batch, topic, &message);
+}
 
-    // find existing topic by name
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        ESP_LOGE(tag, "pubsub_add_subscription, unknown topic:%s", topic_name);
-        return;
+void pubsub_batch_commit(pubsub_batch_t *batch)
+{
+    pubsub_topic_detail_t *topic_details[PUBSUB_MAX_BATCH];
+    bool forward[PUBSUB_MAX_BATCH];
+    bool notify[PUBSUB_MAX_LATEST] = { false };
+    unsigned int epoch = pubsub_read_lock();
+    // resolve all, a bad entry is skipped
+    for (int index = 0; index < batch->count; index++) {
+        pubsub_message_t *message = &batch->messages[index];
+        topic_details[index] = pubsub_get_topic_detail(message->handle);
+        if (topic_details[index] == NULL) {
+            ESP_LOGE(tag, "pubsub_batch_commit, unknown topic:%d", message->handle);
+        } else if (!pubsub_prepare_message(topic_details[index], message)) {
+            topic_details[index] = NULL;
+        }
     }
-    // add subscriber to topic
-    pubsub_subscriber_t *subscriber = pubsub_create_subscriber(subscriber_queue);
-    LIST_INSERT_HEAD(&(topic_detail->subscribers), subscriber, pointers);
-    // publish last known value if hot
-    if (hot) {
-        pubsub_message_t message;
-        message.topic = topic_detail->topic;
-        message.type = topic_detail->type;
-        pubsub_type_t type = topic_detail->type;
-        if (type == PUBSUB_TYPE_INT) {
-            message.int_val = topic_detail->int_val;
-        } else if (type == PUBSUB_TYPE_DOUBLE) {
-            message.double_val = topic_detail->double_val;
-        } else if (type == PUBSUB_TYPE_BOOLEAN) {
-            message.boolean_val = topic_detail->boolean_val;
-        } else {
-            ESP_LOGE(tag, "pubsub_add_subscription, invalid type:%d", type);
+    // store all last values in one batch sequence
+    int64_t now = clock_now();
+    portENTER_CRITICAL(&pubsub_spinlock);
+    unsigned int sequence = atomic_load_explicit(&pubsub_batch_sequence, memory_order_relaxed);
+    atomic_store_explicit(&pubsub_batch_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int index = 0; index < batch->count; index++) {
+        if (topic_details[index] != NULL) {
+            forward[index] = pubsub_store_value(topic_details[index], &batch->messages[index], now);
         }
-        pubsub_publish_one(subscriber->queue, &message);
     }
-}
-
-/**
- * Remove subscription to topic
- */
-void pubsub_remove_subscription(QueueHandle_t subscriber_queue, const char *topic_name)
-{
-    ESP_LOGI(tag, "pubsub_remove_subscription, topic:%s, queue:%p", topic_name, subscriber_queue);
-    // find existing topic by name
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail != NULL) {
-        // remove subscriber from topic
-        pubsub_subscriber_t *candidate;
-        LIST_FOREACH(candidate, &(topic_detail->subscribers), pointers)
-        {
-            if (candidate->queue == subscriber_queue) {
-                ESP_LOGD(tag, "pubsub_remove_subscription, topic:%s, queue:%p found", topic_name, subscriber_queue);
-                LIST_REMOVE(candidate, pointers);
-                free(candidate);
-                break;
-            }
+    atomic_store_explicit(&pubsub_batch_sequence, sequence + 2, memory_order_release);
+    portEXIT_CRITICAL(&pubsub_spinlock);
+    // inform subscribers, queue subscribers per topic, latest value subscribers once
+    for (int index = 0; index < batch->count; index++) {
+        pubsub_topic_detail_t *topic_detail = topic_details[index];
+        if (topic_detail != NULL && forward[index]) {
+            pubsub_log_publish(topic_detail, &batch->messages[index]);
+            pubsub_deliver(topic_detail, &batch->messages[index], notify);
         }
     }
-}
-
-bool pubsub_register_topic(const char *topic_name, const pubsub_type_t type, const bool always)
-{
-    bool success = false;
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        topic_detail = pubsub_add_topic_detail(topic_name, type, always);
-        ESP_LOGI(tag, "pubsub_register_topic, new topic:%s, topic:%p", topic_name, topic_detail);
-
-        success = true;
-    } else {
-        if (topic_detail->type != type) {
-            ESP_LOGE(tag, "pubsub_register_topic, existing topic:%s, topic:%p, type:%d, mismatch new type:%d", topic_name,
-                    topic_detail, topic_detail->type, type);
-        } else if (topic_detail->always != always) {
-            ESP_LOGE(tag, "pubsub_register_topic, existing topic:%s, topic:%p, always:%d, mismatch new always:%d", topic_name,
-                    topic_detail, topic_detail->always, always);
-        } else {
-            ESP_LOGI(tag, "pubsub_register_topic, existing topic:%s, topic:%p", topic_name, topic_detail);
+    // by priority, as the subscriber lists
+    for (int priority = PUBSUB_PRIORITY_HIGH; priority >= PUBSUB_PRIORITY_LOW; priority--) {
+        for (int index = 0; index < PUBSUB_MAX_LATEST; index++) {
+            if (notify[index] && pubsub_latests[index].priority == priority) {
+                pubsub_notify_latest(&pubsub_latests[index]);
+            }
         }
     }
-    return success;
+    pubsub_read_unlock(epoch);
+    batch->count = 0;
 }
 
-bool pubsub_unregister_topic(const char *topic_name)
+/**
+ * Begin reading last values of several topics.
+ * @return sequence to pass to pubsub_snapshot_retry.
+ */
+unsigned int pubsub_snapshot_begin()
 {
-    bool success = false;
-    ESP_LOGI(tag, "pubsub_unregister_topic, topic:%s", topic_name);
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail != NULL) {
-        ESP_LOGD(tag, "pubsub_unregister_topic, topic:%p", topic_detail);
-        pubsub_subscriber_t *subscriber;
-        pubsub_subscriber_t *subscriber_safe;
-        LIST_FOREACH_SAFE(subscriber, &(topic_detail->subscribers), pointers, subscriber_safe)
-        {
-            ESP_LOGD(tag, "pubsub_unregister_topic, queue:%p", subscriber->queue);
-            LIST_REMOVE(subscriber, pointers);
-            free(subscriber);
-        }
-        LIST_REMOVE(topic_detail, pointers);
-        success = true;
-    }
-    return success;
+    unsigned int sequence;
+    do {
+        // odd while a batch stores its values, a few stores only
+        sequence = atomic_load_explicit(&pubsub_batch_sequence, memory_order_acquire);
+    } while (sequence & 1);
+    return sequence;
 }
 
-pubsub_type_t pubsub_get_type(const char *topic_name)
+/**
+ * @return true if a batch was committed since pubsub_snapshot_begin, read again.
+ */
+bool pubsub_snapshot_retry(unsigned int sequence)
 {
-    pubsub_type_t topic_type = PUBSUB_TYPE_UNKNOWN;
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail != NULL) {
-        topic_type = topic_detail->type;
-    }
-    return topic_type;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&pubsub_batch_sequence, memory_order_relaxed) != sequence;
 }
 
+/*
+ * Topic name compatibility layer.
+ * Resolves the name once and continues with the handle.
+ */
+
 void pubsub_publish(const char *topic_name, pubsub_message_t *message)
 {
     if (topic_name == NULL) {
         ESP_LOGE(tag, "pubsub_publish, topic required");
         return;
     }
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        return;
-    }
-    if (topic_detail->type != message->type) {
-        ESP_LOGE(tag, "pubsub_publish, type mismatch topic:%s, type:%d, message type:%d", topic_detail->topic, topic_detail->type,
-                message->type);
-        return;
-    }
-    // check if value changed
-    // store last value
-    bool value_changed;
-    if (topic_detail->type == PUBSUB_TYPE_INT) {
-        value_changed = topic_detail->int_val != message->int_val;
-        topic_detail->int_val = message->int_val;
-        if (topic_detail->always || value_changed) {
-            ESP_LOGI(tag, "pubsub_publish, %s=%lld", topic_detail->topic, message->int_val);
-        }
-    } else if (topic_detail->type == PUBSUB_TYPE_BOOLEAN) {
-        value_changed = topic_detail->boolean_val != message->boolean_val;
-        topic_detail->boolean_val = message->boolean_val;
-        if (topic_detail->always || value_changed) {
-            ESP_LOGI(tag, "pubsub_publish, %s=%s", topic_detail->topic, message->boolean_val ? "true" : "false");
-        }
-    } else if (topic_detail->type == PUBSUB_TYPE_DOUBLE) {
-        value_changed = topic_detail->double_val != message->double_val;
-        topic_detail->double_val = message->double_val;
-        if (topic_detail->always || value_changed) {
-            ESP_LOGI(tag, "pubsub_publish, %s=%lf", topic_detail->topic, message->double_val);
-        }
-    } else {
-        value_changed = false;
-        ESP_LOGE(tag, "pubsub_publish, unknown type topic:%s", topic_detail->topic);
+    pubsub_topic_t topic = pubsub_find_topic(topic_name);
+    if (topic == PUBSUB_TOPIC_INVALID) {
         return;
     }
-    // publish always or if changed
-    if (topic_detail->always || value_changed) {
-        // inform all subscribers
-        pubsub_subscriber_t *subscriber;
-        LIST_FOREACH(subscriber, &(topic_detail->subscribers), pointers)
-        {
-            pubsub_publish_one(subscriber->queue, message);
-        }
-    }
+    pubsub_publish_h(topic, message);
 }
 
 void pubsub_publish_bool(const char *topic_name, bool value)
@@ -281,25 +1693,11 @@ void pubsub_publish_bool(const char *topic_name, bool value)
         ESP_LOGE(tag, "pubsub_publish_bool, topic required");
         return;
     }
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        return;
-    }
-    const char *str_value = value ? "true" : "false";
-    ESP_LOGD(tag, "pubsub_publish_bool, topic:%p, value:%s", topic_name, str_value);
-    if (topic_name == NULL) {
-        ESP_LOGE(tag, "pubsub_publish_bool, topic required");
-        return;
-    }
-    if (topic_detail->type != PUBSUB_TYPE_BOOLEAN) {
-        ESP_LOGE(tag, "pubsub_publish_bool, type mismatch topic:%s", topic_detail->topic);
+    pubsub_topic_t topic = pubsub_find_topic(topic_name);
+    if (topic == PUBSUB_TOPIC_INVALID) {
         return;
     }
-    pubsub_message_t message;
-    message.topic = topic_detail->topic;
-    message.type = PUBSUB_TYPE_BOOLEAN;
-    message.boolean_val = value;
-    pubsub_publish(topic_name, &message);
+    pubsub_publish_bool_h(topic, value);
 }
 
 void pubsub_publish_int(const char *topic_name, int64_t value)
@@ -308,24 +1706,11 @@ void pubsub_publish_int(const char *topic_name, int64_t value)
         ESP_LOGE(tag, "pubsub_publish_int, topic required");
         return;
     }
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        return;
-    }
-    ESP_LOGD(tag, "pubsub_publish_int, topic:%p, value:%lld", topic_name, value);
-    if (topic_name == NULL) {
-        ESP_LOGE(tag, "pubsub_publish_int, topic required");
-        return;
-    }
-    if (topic_detail->type != PUBSUB_TYPE_INT) {
-        ESP_LOGE(tag, "pubsub_publish_int, type mismatch topic:%s", topic_detail->topic);
+    pubsub_topic_t topic = pubsub_find_topic(topic_name);
+    if (topic == PUBSUB_TOPIC_INVALID) {
         return;
     }
-    pubsub_message_t message;
-    message.topic = topic_detail->topic;
-    message.type = PUBSUB_TYPE_INT;
-    message.int_val = value;
-    pubsub_publish(topic_name, &message);
+    pubsub_publish_int_h(topic, value);
 }
 
 void pubsub_publish_double(const char *topic_name, double value)
@@ -334,71 +1719,241 @@ void pubsub_publish_double(const char *topic_name, double value)
         ESP_LOGE(tag, "pubsub_publish_double, topic required");
         return;
     }
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
+    pubsub_topic_t topic = pubsub_find_topic(topic_name);
+    if (topic == PUBSUB_TOPIC_INVALID) {
         return;
     }
-    ESP_LOGD(tag, "pubsub_publish_double, topic:%p, value:%lf", topic_name, value);
+    pubsub_publish_double_h(topic, value);
+}
+
+void pubsub_publish_float(const char *topic_name, float value)
+{
     if (topic_name == NULL) {
-        ESP_LOGE(tag, "pubsub_publish_double topic required");
+        ESP_LOGE(tag, "pubsub_publish_float, topic required");
         return;
     }
-    if (topic_detail->type != PUBSUB_TYPE_DOUBLE) {
-        ESP_LOGE(tag, "pubsub_publish_double, type mismatch topic:%s", topic_detail->topic);
+    pubsub_topic_t topic = pubsub_find_topic(topic_name);
+    if (topic == PUBSUB_TOPIC_INVALID) {
         return;
     }
-    pubsub_message_t message;
-    message.topic = topic_detail->topic;
-    message.type = PUBSUB_TYPE_DOUBLE;
-    message.double_val = value;
-    pubsub_publish(topic_name, &message);
+    pubsub_publish_float_h(topic, value);
 }
 
 uint16_t pubsub_topic_count()
 {
     uint16_t count = 0;
-    pubsub_topic_detail_t *topic_detail;
-    LIST_FOREACH(topic_detail, &pubsub_topic_subscribers, pointers)
-    {
-        ESP_LOGD(tag, "pubsub_topic_count, topic:%s", topic_detail->topic);
-        count++;
+    pubsub_lock();
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        pubsub_topic_detail_t *topic_detail = &pubsub_topics[index];
+        if (topic_detail->topic != NULL) {
+            ESP_LOGD(tag, "pubsub_topic_count, topic:%s", topic_detail->topic);
+            count++;
+        }
     }
+    pubsub_unlock();
     ESP_LOGI(tag, "pubsub_topic_count, count:%d", count);
     return count;
 }
 
+/**
+ * @return true if queue is subscribed before subscriber (in topic and list order).
+ * Only called with pubsub_mutex taken.
+ */
+static bool pubsub_queue_counted(QueueHandle_t queue, const pubsub_subscriber_t *until)
+{
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        pubsub_subscriber_t *subscriber = atomic_load(&pubsub_topics[index].subscribers);
+        while (subscriber != NULL) {
+            if (subscriber == until) {
+                return false;
+            }
+            if (subscriber->latest == NULL && subscriber->queue == queue) {
+                return true;
+            }
+            subscriber = atomic_load(&subscriber->next);
+        }
+    }
+    return false;
+}
+
+/**
+ * Sum storage of all subscriber queues, each queue counted once.
+ * Only called with pubsub_mutex taken.
+ */
+static void pubsub_queue_ram(pubsub_capacity_t *capacity)
+{
+    capacity->queue_bytes = 0;
+    capacity->queue_bytes_full = 0;
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        pubsub_subscriber_t *subscriber = atomic_load(&pubsub_topics[index].subscribers);
+        while (subscriber != NULL) {
+            if (subscriber->latest == NULL && !pubsub_queue_counted(subscriber->queue, subscriber)) {
+                uint32_t length = uxQueueMessagesWaiting(subscriber->queue) + uxQueueSpacesAvailable(subscriber->queue);
+                capacity->queue_bytes += length * (subscriber->compact ? sizeof(pubsub_compact_t) : sizeof(pubsub_message_t));
+                capacity->queue_bytes_full += length * sizeof(pubsub_message_t);
+            }
+            subscriber = atomic_load(&subscriber->next);
+        }
+    }
+}
+
+/**
+ * Report pool and arena usage.
+ */
+void pubsub_get_capacity(pubsub_capacity_t *capacity)
+{
+    pubsub_lock();
+    capacity->topics_used = 0;
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        if (pubsub_topics[index].topic != NULL) {
+            capacity->topics_used++;
+        }
+    }
+    capacity->topics_max = PUBSUB_MAX_TOPICS;
+    capacity->subscribers_used = pubsub_subscribers_used;
+    capacity->subscribers_max = PUBSUB_MAX_SUBSCRIBERS;
+    capacity->latest_used = 0;
+    for (int index = 0; index < PUBSUB_MAX_LATEST; index++) {
+        if (pubsub_latests[index].used) {
+            capacity->latest_used++;
+        }
+    }
+    capacity->latest_max = PUBSUB_MAX_LATEST;
+    capacity->patterns_used = 0;
+    for (int index = 0; index < PUBSUB_MAX_PATTERNS; index++) {
+        if (pubsub_patterns[index].pattern != NULL) {
+            capacity->patterns_used++;
+        }
+    }
+    capacity->patterns_max = PUBSUB_MAX_PATTERNS;
+    pubsub_queue_ram(capacity);
+    capacity->names_used = pubsub_names_used;
+    capacity->names_max = PUBSUB_NAME_ARENA_SIZE;
+    capacity->topic_bytes = sizeof(pubsub_topic_detail_t) + sizeof(pubsub_index_entry_t) * PUBSUB_INDEX_SIZE / PUBSUB_MAX_TOPICS;
+    capacity->subscriber_bytes = sizeof(pubsub_subscriber_t);
+    pubsub_unlock();
+}
+
+/**
+ * Delivery counts of topic, summed over all queue subscribers since registration.
+ * high_water is the maximum of the current subscribers.
+ * @return true if successful, false if unknown topic.
+ */
+bool pubsub_get_topic_stats(pubsub_topic_t topic, pubsub_delivery_stats_t *stats)
+{
+    bool success = false;
+    pubsub_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    if (topic_detail != NULL) {
+        stats->delivered = atomic_load(&topic_detail->delivered);
+        stats->dropped = atomic_load(&topic_detail->dropped);
+        stats->coalesced = atomic_load(&topic_detail->coalesced);
+        stats->suppressed = atomic_load(&topic_detail->suppressed);
+        stats->high_water = 0;
+        pubsub_subscriber_t *subscriber = atomic_load(&topic_detail->subscribers);
+        while (subscriber != NULL) {
+            unsigned int high_water = atomic_load(&subscriber->high_water);
+            if (high_water > stats->high_water) {
+                stats->high_water = high_water;
+            }
+            subscriber = atomic_load(&subscriber->next);
+        }
+        success = true;
+    }
+    pubsub_unlock();
+    return success;
+}
+
+/**
+ * Delivery counts of queue subscription to topic.
+ * @return true if successful, false if not subscribed.
+ */
+bool pubsub_get_subscription_stats(QueueHandle_t subscriber_queue, pubsub_topic_t topic, pubsub_delivery_stats_t *stats)
+{
+    bool success = false;
+    pubsub_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
+    pubsub_subscriber_t *subscriber = topic_detail != NULL ? pubsub_find_subscriber(topic_detail, subscriber_queue) : NULL;
+    if (subscriber != NULL) {
+        stats->delivered = atomic_load(&subscriber->delivered);
+        stats->dropped = atomic_load(&subscriber->dropped);
+        stats->coalesced = atomic_load(&subscriber->coalesced);
+        stats->high_water = atomic_load(&subscriber->high_water);
+        stats->suppressed = 0;
+        success = true;
+    }
+    pubsub_unlock();
+    return success;
+}
+
+/**
+ * Log delivery counts of all queue subscriptions, helps sizing queues.
+ */
+void pubsub_log_stats()
+{
+    pubsub_lock();
+    for (int index = 0; index < PUBSUB_MAX_TOPICS; index++) {
+        pubsub_topic_detail_t *topic_detail = &pubsub_topics[index];
+        if (topic_detail->topic == NULL) {
+            continue;
+        }
+        unsigned int suppressed = atomic_load(&topic_detail->suppressed);
+        if (suppressed != 0) {
+            ESP_LOGI(tag, "pubsub_log_stats, topic:%s, suppressed:%u", topic_detail->topic, suppressed);
+        }
+        pubsub_subscriber_t *subscriber = atomic_load(&topic_detail->subscribers);
+        while (subscriber != NULL) {
+            if (subscriber->latest == NULL) {
+                ESP_LOGI(tag, "pubsub_log_stats, topic:%s, queue:%p, delivered:%u, dropped:%u, coalesced:%u, high water:%u/%u",
+                        topic_detail->topic, subscriber->queue, atomic_load(&subscriber->delivered),
+                        atomic_load(&subscriber->dropped), atomic_load(&subscriber->coalesced),
+                        atomic_load(&subscriber->high_water),
+                        uxQueueMessagesWaiting(subscriber->queue) + uxQueueSpacesAvailable(subscriber->queue));
+            }
+            subscriber = atomic_load(&subscriber->next);
+        }
+    }
+    pubsub_unlock();
+}
+
 uint16_t pubsub_subscriber_count(const char *topic_name)
 {
     uint16_t count = 0;
+    pubsub_lock();
     pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    pubsub_subscriber_t *subscriber;
     if (topic_detail != NULL) {
-        LIST_FOREACH(subscriber, &(topic_detail->subscribers), pointers)
-        {
+        pubsub_subscriber_t *subscriber = atomic_load(&topic_detail->subscribers);
+        while (subscriber != NULL) {
             ESP_LOGD(tag, "pubsub_subscriber_count, queue:%p", subscriber->queue);
             count++;
+            subscriber = atomic_load(&subscriber->next);
         }
     }
+    pubsub_unlock();
     ESP_LOGI(tag, "pubsub_subscriber_count, topic:%s, count:%d", topic_name, count);
-    return 0;
+    return count;
 }
 
 /**
- * get last published value for topic
+ * Get last published value for topic, lock free.
  * @return true if successful, false on failure.
  */
-bool pubsub_last_bool(const char *topic_name, bool *value)
+static bool pubsub_last_value(const char *function_name, pubsub_topic_t topic, pubsub_type_t type, pubsub_value_t *value)
 {
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
+    unsigned int epoch = pubsub_read_lock();
+    pubsub_topic_detail_t *topic_detail = pubsub_get_topic_detail(topic);
     if (topic_detail == NULL) {
-        ESP_LOGE(tag, "pubsub_last_bool, missing topic");
+        pubsub_read_unlock(epoch);
+        ESP_LOGE(tag, "%s, missing topic", function_name);
         return false;
     }
-    if (topic_detail->type != PUBSUB_TYPE_BOOLEAN) {
-        ESP_LOGE(tag, "pubsub_last_bool, topic:%s, incorrect type:%d", topic_detail->topic, topic_detail->type);
+    if (topic_detail->type != type) {
+        ESP_LOGE(tag, "%s, topic:%s, incorrect type:%d", function_name, topic_detail->topic, topic_detail->type);
+        pubsub_read_unlock(epoch);
         return false;
     }
-    *value = topic_detail->boolean_val;
+    pubsub_value_read(topic_detail, value);
+    pubsub_read_unlock(epoch);
     return true;
 }
 
@@ -406,18 +1961,27 @@ bool pubsub_last_bool(const char *topic_name, bool *value)
  * get last published value for topic
  * @return true if successful, false on failure.
  */
-bool pubsub_last_int(const char *topic_name, int64_t *value)
+bool pubsub_last_bool(const char *topic_name, bool *value)
 {
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        ESP_LOGE(tag, "pubsub_last_int, missing topic");
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_bool", pubsub_find_topic(topic_name), PUBSUB_TYPE_BOOLEAN, &last)) {
         return false;
     }
-    if (topic_detail->type != PUBSUB_TYPE_INT) {
-        ESP_LOGE(tag, "pubsub_last_int, topic:%s, incorrect type:%d", topic_detail->topic, topic_detail->type);
+    *value = last.boolean_val;
+    return true;
+}
+
+/**
+ * get last published value for topic
+ * @return true if successful, false on failure.
+ */
+bool pubsub_last_int(const char *topic_name, int64_t *value)
+{
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_int", pubsub_find_topic(topic_name), PUBSUB_TYPE_INT, &last)) {
         return false;
     }
-    *value = topic_detail->int_val;
+    *value = last.int_val;
     return true;
 }
 
@@ -427,15 +1991,64 @@ bool pubsub_last_int(const char *topic_name, int64_t *value)
  */
 bool pubsub_last_double(const char *topic_name, double *value)
 {
-    pubsub_topic_detail_t *topic_detail = pubsub_find_topic_detail(topic_name);
-    if (topic_detail == NULL) {
-        ESP_LOGE(tag, "pubsub_last_double, missing topic");
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_double", pubsub_find_topic(topic_name), PUBSUB_TYPE_DOUBLE, &last)) {
         return false;
     }
-    if (topic_detail->type != PUBSUB_TYPE_DOUBLE) {
-        ESP_LOGE(tag, "pubsub_last_double, topic:%s, incorrect type:%d", topic_detail->topic, topic_detail->type);
+    *value = last.double_val;
+    return true;
+}
+
+/**
+ * get last published value for topic
+ * @return true if successful, false on failure.
+ */
+bool pubsub_last_float(const char *topic_name, float *value)
+{
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_float", pubsub_find_topic(topic_name), PUBSUB_TYPE_FLOAT, &last)) {
+        return false;
+    }
+    *value = last.float_val;
+    return true;
+}
+
+bool pubsub_last_bool_h(pubsub_topic_t topic, bool *value)
+{
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_bool_h", topic, PUBSUB_TYPE_BOOLEAN, &last)) {
+        return false;
+    }
+    *value = last.boolean_val;
+    return true;
+}
+
+bool pubsub_last_int_h(pubsub_topic_t topic, int64_t *value)
+{
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_int_h", topic, PUBSUB_TYPE_INT, &last)) {
+        return false;
+    }
+    *value = last.int_val;
+    return true;
+}
+
+bool pubsub_last_double_h(pubsub_topic_t topic, double *value)
+{
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_double_h", topic, PUBSUB_TYPE_DOUBLE, &last)) {
+        return false;
+    }
+    *value = last.double_val;
+    return true;
+}
+
+bool pubsub_last_float_h(pubsub_topic_t topic, float *value)
+{
+    pubsub_value_t last;
+    if (!pubsub_last_value("pubsub_last_float_h", topic, PUBSUB_TYPE_FLOAT, &last)) {
         return false;
     }
-    *value = topic_detail->double_val;
+    *value = last.float_val;
     return true;
 }
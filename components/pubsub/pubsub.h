@@ -10,46 +10,281 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "sdkconfig.h"
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/task.h"
+
+/** Capacity of the topic registry (see Kconfig) */
+#define PUBSUB_MAX_TOPICS CONFIG_PUBSUB_MAX_TOPICS
+/** Capacity of the subscriber pool, queue and latest value subscriptions (see Kconfig) */
+#define PUBSUB_MAX_SUBSCRIBERS CONFIG_PUBSUB_MAX_SUBSCRIBERS
+/** Capacity of the latest value subscriber pool (see Kconfig) */
+#define PUBSUB_MAX_LATEST CONFIG_PUBSUB_MAX_LATEST
+/** Capacity of the pattern subscription pool (see Kconfig) */
+#define PUBSUB_MAX_PATTERNS CONFIG_PUBSUB_MAX_PATTERNS
+/** Size of the topic name arena [bytes] (see Kconfig) */
+#define PUBSUB_NAME_ARENA_SIZE CONFIG_PUBSUB_NAME_ARENA_SIZE
+
+/**
+ * Topic handle.
+ * Resolved once from the topic name, avoids name lookup when publishing.
+ */
+typedef uint16_t pubsub_topic_t;
+
+/** Invalid topic handle */
+#define PUBSUB_TOPIC_INVALID ((pubsub_topic_t) 0xFFFF)
 
 typedef enum
 {
-    PUBSUB_TYPE_UNKNOWN = 0, PUBSUB_TYPE_INT = 1, PUBSUB_TYPE_DOUBLE = 2, PUBSUB_TYPE_BOOLEAN = 3
+    PUBSUB_TYPE_UNKNOWN = 0, PUBSUB_TYPE_INT = 1, PUBSUB_TYPE_DOUBLE = 2, PUBSUB_TYPE_BOOLEAN = 3,
+    /** single precision, hardware floating point on ESP32 */
+    PUBSUB_TYPE_FLOAT = 4
 } pubsub_type_t;
 
 typedef struct
 {
     const char *topic;
+    pubsub_topic_t handle;
     pubsub_type_t type;
     union
     {
         int64_t int_val;
         double double_val;
+        float float_val;
         bool boolean_val;
     };
 } pubsub_message_t;
 
+/**
+ * Compact message, 8 bytes instead of 24.
+ * For queues of topics with values that fit 32 bit: int saturates, double rounds to float, float is exact.
+ * Use pubsub_message_t where 64 bit values (time) are needed.
+ */
+typedef struct
+{
+    pubsub_topic_t handle;
+    /** pubsub_type_t */
+    uint8_t type;
+    uint8_t reserved;
+    union
+    {
+        int32_t int_val;
+        float float_val;
+    };
+} pubsub_compact_t;
+
+static inline int32_t pubsub_compact_int(const pubsub_compact_t *message)
+{
+    return message->int_val;
+}
+
+static inline double pubsub_compact_double(const pubsub_compact_t *message)
+{
+    return message->float_val;
+}
+
+static inline float pubsub_compact_float(const pubsub_compact_t *message)
+{
+    return message->float_val;
+}
+
+static inline bool pubsub_compact_bool(const pubsub_compact_t *message)
+{
+    return message->int_val != 0;
+}
+
+/** Queue subscription policy when the queue is full */
+typedef enum
+{
+    /** drop the new message (default) */
+    PUBSUB_DELIVERY_DROP_NEWEST = 0,
+    /** drop the oldest queued message, of any topic on a shared queue, for state topics (queue of 1 keeps the latest value) */
+    PUBSUB_DELIVERY_DROP_OLDEST = 1,
+    /** wait up to timeout for space, for commands */
+    PUBSUB_DELIVERY_BLOCK = 2,
+    /** at most one queued message per topic, receive with pubsub_receive to get the last value */
+    PUBSUB_DELIVERY_COALESCE = 3
+} pubsub_delivery_t;
+
+/**
+ * Longest wait for queue space of a PUBSUB_DELIVERY_BLOCK subscription, longer timeouts are capped.
+ * The publisher waits inside a read section, which holds off subscribe and unsubscribe.
+ */
+#define PUBSUB_BLOCK_TIMEOUT_MAX pdMS_TO_TICKS(1000)
+
+/**
+ * Subscription priority, publish delivers to higher priority subscribers first.
+ * A display queue that blocks (PUBSUB_DELIVERY_BLOCK) or a burst of display
+ * notifications does not delay actuator and interlock subscribers.
+ */
+typedef enum
+{
+    /** display, HMI binding */
+    PUBSUB_PRIORITY_LOW = 0,
+    /** default */
+    PUBSUB_PRIORITY_NORMAL = 1,
+    /** actuators and interlocks */
+    PUBSUB_PRIORITY_HIGH = 2
+} pubsub_priority_t;
+
+/** Delivery counts */
+typedef struct
+{
+    uint32_t delivered;
+    uint32_t dropped;
+    /** publishes merged into an already queued message */
+    uint32_t coalesced;
+    /** most messages waiting in the queue after a delivery */
+    uint16_t high_water;
+    /** publishes not forwarded by the topic filter (topic stats only) */
+    uint32_t suppressed;
+} pubsub_delivery_stats_t;
+
+/**
+ * Topic filter, set when registering the topic.
+ * A publish is forwarded to subscribers when the value differs from the last
+ * forwarded value by more than the deadband (or the topic is always published)
+ * and at least min_interval_ms passed since the last forwarded publish.
+ * Suppressed publishes still update the last value (pubsub_last_*), a change
+ * held back by the minimum interval is forwarded by pubsub_forward_pending.
+ */
+typedef struct
+{
+    /** absolute deadband in value units, or fraction of the last forwarded value, 0 forwards every change */
+    float deadband;
+    bool relative;
+    /** minimum time between forwarded publishes [ms], 0 no limit */
+    uint32_t min_interval_ms;
+} pubsub_filter_t;
+
+/**
+ * Latest value subscriber.
+ * Publish marks the topic changed instead of queueing a message,
+ * the subscriber reads the current value with pubsub_last_*_h.
+ * Changes of up to 32 topics are tracked in one bitmask.
+ */
+typedef struct pubsub_latest_s pubsub_latest_t;
+
+/** Maximum topic updates in one batch */
+#define PUBSUB_MAX_BATCH 8
+
+/**
+ * Topic updates published together (pubsub_batch_commit).
+ * Lives on the publisher stack, no registry resources.
+ */
+typedef struct
+{
+    uint8_t count;
+    pubsub_message_t messages[PUBSUB_MAX_BATCH];
+} pubsub_batch_t;
+
+/** Pool and arena usage */
+typedef struct
+{
+    uint16_t topics_used;
+    uint16_t topics_max;
+    uint16_t subscribers_used;
+    uint16_t subscribers_max;
+    uint16_t latest_used;
+    uint16_t latest_max;
+    uint16_t patterns_used;
+    uint16_t patterns_max;
+    uint16_t names_used;
+    uint16_t names_max;
+    /** storage of all subscriber queues [bytes] */
+    uint32_t queue_bytes;
+    /** same queues with pubsub_message_t items [bytes] */
+    uint32_t queue_bytes_full;
+    /** static memory per topic, registry element and its index entries [bytes] */
+    uint16_t topic_bytes;
+    /** static memory per subscription, pool element without queue storage [bytes] */
+    uint16_t subscriber_bytes;
+} pubsub_capacity_t;
+
 extern void pubsub_initialize();
 
 extern void pubsub_add_subscription(QueueHandle_t subscriber_queue, const char *topic_name, bool hot);
 extern void pubsub_remove_subscription(QueueHandle_t subscriber_queue, const char *topic_name);
+extern void pubsub_add_subscription_policy(QueueHandle_t subscriber_queue, const char *topic_name, bool hot,
+        pubsub_delivery_t delivery, TickType_t timeout, pubsub_priority_t priority);
+extern void pubsub_add_compact_subscription(QueueHandle_t subscriber_queue, const char *topic_name, bool hot,
+        pubsub_delivery_t delivery, TickType_t timeout, pubsub_priority_t priority);
+extern BaseType_t pubsub_receive(QueueHandle_t queue, pubsub_message_t *message, TickType_t timeout);
+extern BaseType_t pubsub_receive_compact(QueueHandle_t queue, pubsub_compact_t *message, TickType_t timeout);
+extern bool pubsub_add_pattern_subscription(QueueHandle_t subscriber_queue, const char *pattern, bool hot);
+extern void pubsub_remove_pattern_subscription(QueueHandle_t subscriber_queue, const char *pattern);
+
+extern pubsub_latest_t* pubsub_latest_create(TaskHandle_t task, uint32_t notify_bits);
+extern void pubsub_latest_set_priority(pubsub_latest_t *latest, pubsub_priority_t priority);
+extern uint32_t pubsub_add_latest_subscription(pubsub_latest_t *latest, pubsub_topic_t topic);
+extern uint32_t pubsub_add_latest_pattern(pubsub_latest_t *latest, const char *pattern);
+extern uint32_t pubsub_latest_changes(pubsub_latest_t *latest);
+extern int64_t pubsub_latest_since(pubsub_latest_t *latest);
+extern void pubsub_latest_delete(pubsub_latest_t *latest);
 
 extern bool pubsub_register_topic(const char *topic_name, const pubsub_type_t type, const bool always);
 extern bool pubsub_unregister_topic(const char *topic_name);
 extern pubsub_type_t pubsub_get_type(const char *topic_name);
 
+extern pubsub_topic_t pubsub_register_topic_handle(const char *topic_name, const pubsub_type_t type, const bool always);
+extern pubsub_topic_t pubsub_register_topic_filter(const char *topic_name, const pubsub_type_t type, const bool always,
+        const pubsub_filter_t *filter);
+extern pubsub_topic_t pubsub_find_topic(const char *topic_name);
+extern const char* pubsub_topic_name(pubsub_topic_t topic);
+/**
+ * @return true if the topic was published since it was registered,
+ * a latest value subscription marks its topic changed also without publish.
+ */
+extern bool pubsub_published_h(pubsub_topic_t topic);
+
 extern void pubsub_publish(const char *topic_name, pubsub_message_t *message);
 extern void pubsub_publish_bool(const char *topic_name, bool value);
 extern void pubsub_publish_int(const char *topic_name, int64_t value);
 extern void pubsub_publish_double(const char *topic_name, double value);
+extern void pubsub_publish_float(const char *topic_name, float value);
+
+extern void pubsub_publish_h(pubsub_topic_t topic, pubsub_message_t *message);
+extern void pubsub_publish_bool_h(pubsub_topic_t topic, bool value);
+extern void pubsub_publish_int_h(pubsub_topic_t topic, int64_t value);
+extern void pubsub_publish_double_h(pubsub_topic_t topic, double value);
+extern void pubsub_publish_float_h(pubsub_topic_t topic, float value);
+
+/**
+ * Forward the last value of topics whose change was held back by min_interval_ms
+ * once the interval passed.
+ * @param now current time [us]
+ * @return time of the next pending forward [us], 0 if none.
+ */
+extern int64_t pubsub_forward_pending(int64_t now);
+
+extern void pubsub_batch_begin(pubsub_batch_t *batch);
+extern bool pubsub_batch_add(pubsub_batch_t *batch, pubsub_topic_t topic, const pubsub_message_t *message);
+extern bool pubsub_batch_bool(pubsub_batch_t *batch, pubsub_topic_t topic, bool value);
+extern bool pubsub_batch_int(pubsub_batch_t *batch, pubsub_topic_t topic, int64_t value);
+extern bool pubsub_batch_double(pubsub_batch_t *batch, pubsub_topic_t topic, double value);
+extern bool pubsub_batch_float(pubsub_batch_t *batch, pubsub_topic_t topic, float value);
+extern void pubsub_batch_commit(pubsub_batch_t *batch);
+extern unsigned int pubsub_snapshot_begin();
+extern bool pubsub_snapshot_retry(unsigned int sequence);
 
 extern uint16_t pubsub_topic_count();
 extern uint16_t pubsub_subscriber_count(const char *topic_name);
+extern void pubsub_get_capacity(pubsub_capacity_t *capacity);
+extern bool pubsub_get_topic_stats(pubsub_topic_t topic, pubsub_delivery_stats_t *stats);
+extern bool pubsub_get_subscription_stats(QueueHandle_t subscriber_queue, pubsub_topic_t topic, pubsub_delivery_stats_t *stats);
+extern void pubsub_log_stats();
 
 extern bool pubsub_last_bool(const char *topic_name, bool *value);
 extern bool pubsub_last_int(const char *topic_name, int64_t *value);
 extern bool pubsub_last_double(const char *topic_name, double *value);
+extern bool pubsub_last_float(const char *topic_name, float *value);
+
+extern bool pubsub_last_bool_h(pubsub_topic_t topic, bool *value);
+extern bool pubsub_last_int_h(pubsub_topic_t topic, int64_t *value);
+extern bool pubsub_last_double_h(pubsub_topic_t topic, double *value);
+extern bool pubsub_last_float_h(pubsub_topic_t topic, float *value);
 
 #ifdef __cplusplus
 }
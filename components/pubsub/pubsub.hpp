@@ -0,0 +1,386 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _PUBSUB_HPP_
+#define _PUBSUB_HPP_
+
+// C++ linkage, also when included inside an extern "C" block
+extern "C++" {
+
+#include <stdint.h>
+#include <type_traits>
+
+#include "esp_log.h"
+
+#include "pubsub.h"
+
+/**
+ * Typed C++ layer over pubsub.
+ * The value type of a topic is part of its C++ type, publishing or subscribing
+ * with another type fails to compile. Dispatch on type is resolved at compile time.
+ */
+namespace pubsub
+{
+
+/** Time in seconds after epoch (time_t), carried as PUBSUB_TYPE_INT */
+struct Time
+{
+    int64_t seconds;
+};
+
+/**
+ * Value type traits, only defined for supported types.
+ * - type: pubsub type of the topic
+ * - compact: value fits pubsub_compact_t
+ * - get/set: value in a message
+ * - publish/last: typed pubsub functions
+ */
+template<typename T>
+struct TopicType;
+
+template<>
+struct TopicType<bool>
+{
+    static constexpr pubsub_type_t type = PUBSUB_TYPE_BOOLEAN;
+    static constexpr bool compact = true;
+    static bool get(const pubsub_message_t &message)
+    {
+        return message.boolean_val;
+    }
+    static bool get(const pubsub_compact_t &message)
+    {
+        return pubsub_compact_bool(&message);
+    }
+    static void set(pubsub_message_t &message, bool value)
+    {
+        message.boolean_val = value;
+    }
+    static void publish(pubsub_topic_t topic, bool value)
+    {
+        pubsub_publish_bool_h(topic, value);
+    }
+    static bool last(pubsub_topic_t topic, bool *value)
+    {
+        return pubsub_last_bool_h(topic, value);
+    }
+};
+
+template<>
+struct TopicType<int32_t>
+{
+    static constexpr pubsub_type_t type = PUBSUB_TYPE_INT;
+    static constexpr bool compact = true;
+    static int32_t get(const pubsub_message_t &message)
+    {
+        return (int32_t) message.int_val;
+    }
+    static int32_t get(const pubsub_compact_t &message)
+    {
+        return pubsub_compact_int(&message);
+    }
+    static void set(pubsub_message_t &message, int32_t value)
+    {
+        message.int_val = value;
+    }
+    static void publish(pubsub_topic_t topic, int32_t value)
+    {
+        pubsub_publish_int_h(topic, value);
+    }
+    static bool last(pubsub_topic_t topic, int32_t *value)
+    {
+        int64_t int_val;
+        bool found = pubsub_last_int_h(topic, &int_val);
+        *value = (int32_t) int_val;
+        return found;
+    }
+};
+
+/** Full width integer, for generic code that handles any INT topic (NVS) */
+template<>
+struct TopicType<int64_t>
+{
+    static constexpr pubsub_type_t type = PUBSUB_TYPE_INT;
+    static constexpr bool compact = false;
+    static int64_t get(const pubsub_message_t &message)
+    {
+        return message.int_val;
+    }
+    static void set(pubsub_message_t &message, int64_t value)
+    {
+        message.int_val = value;
+    }
+    static void publish(pubsub_topic_t topic, int64_t value)
+    {
+        pubsub_publish_int_h(topic, value);
+    }
+    static bool last(pubsub_topic_t topic, int64_t *value)
+    {
+        return pubsub_last_int_h(topic, value);
+    }
+};
+
+template<>
+struct TopicType<Time>
+{
+    static constexpr pubsub_type_t type = PUBSUB_TYPE_INT;
+    /** 64 bit, does not fit */
+    static constexpr bool compact = false;
+    static Time get(const pubsub_message_t &message)
+    {
+        return Time { message.int_val };
+    }
+    static void set(pubsub_message_t &message, Time value)
+    {
+        message.int_val = value.seconds;
+    }
+    static void publish(pubsub_topic_t topic, Time value)
+    {
+        pubsub_publish_int_h(topic, value.seconds);
+    }
+    static bool last(pubsub_topic_t topic, Time *value)
+    {
+        return pubsub_last_int_h(topic, &value->seconds);
+    }
+};
+
+template<>
+struct TopicType<float>
+{
+    static constexpr pubsub_type_t type = PUBSUB_TYPE_FLOAT;
+    static constexpr bool compact = true;
+    static float get(const pubsub_message_t &message)
+    {
+        return message.float_val;
+    }
+    static float get(const pubsub_compact_t &message)
+    {
+        return pubsub_compact_float(&message);
+    }
+    static void set(pubsub_message_t &message, float value)
+    {
+        message.float_val = value;
+    }
+    static void publish(pubsub_topic_t topic, float value)
+    {
+        pubsub_publish_float_h(topic, value);
+    }
+    static bool last(pubsub_topic_t topic, float *value)
+    {
+        return pubsub_last_float_h(topic, value);
+    }
+};
+
+template<>
+struct TopicType<double>
+{
+    static constexpr pubsub_type_t type = PUBSUB_TYPE_DOUBLE;
+    static constexpr bool compact = false;
+    static double get(const pubsub_message_t &message)
+    {
+        return message.double_val;
+    }
+    static void set(pubsub_message_t &message, double value)
+    {
+        message.double_val = value;
+    }
+    static void publish(pubsub_topic_t topic, double value)
+    {
+        pubsub_publish_double_h(topic, value);
+    }
+    static bool last(pubsub_topic_t topic, double *value)
+    {
+        return pubsub_last_double_h(topic, value);
+    }
+};
+
+/**
+ * Topic with value type T.
+ * Same size as a handle, pass by value.
+ */
+template<typename T>
+class Topic
+{
+public:
+    Topic()
+    {
+    }
+
+    /** Topic of a handle with known type (model topics: MODEL_TOPIC(id)) */
+    explicit Topic(pubsub_topic_t handle) :
+            handle(handle)
+    {
+    }
+
+    /**
+     * Topic by name, checks the registered type once.
+     * @return invalid topic if unknown or of another type
+     */
+    static Topic find(const char *name)
+    {
+        pubsub_topic_t handle = pubsub_find_topic(name);
+        if (handle != PUBSUB_TOPIC_INVALID && pubsub_get_type(name) != TopicType<T>::type) {
+            ESP_LOGE("pubsub", "Topic::find, type mismatch topic:%s", name);
+            handle = PUBSUB_TOPIC_INVALID;
+        }
+        return Topic(handle);
+    }
+
+    void publish(T value) const
+    {
+        TopicType<T>::publish(handle, value);
+    }
+
+    /** No implicit conversion, publish(1.5) on a Topic<float> does not compile */
+    template<typename V>
+    void publish(V value) const = delete;
+
+    bool last(T *value) const
+    {
+        return TopicType<T>::last(handle, value);
+    }
+
+    bool valid() const
+    {
+        return handle != PUBSUB_TOPIC_INVALID;
+    }
+
+    pubsub_topic_t get_handle() const
+    {
+        return handle;
+    }
+
+    const char* get_name() const
+    {
+        return pubsub_topic_name(handle);
+    }
+
+private:
+    pubsub_topic_t handle = PUBSUB_TOPIC_INVALID;
+};
+
+/**
+ * Topic updates published together, see pubsub_batch_commit.
+ * Stack object, one per sample.
+ */
+class Batch
+{
+public:
+    Batch()
+    {
+        pubsub_batch_begin(&batch);
+    }
+
+    /** @return false if the batch is full */
+    template<typename T>
+    bool add(Topic<T> topic, T value)
+    {
+        pubsub_message_t message;
+        message.type = TopicType<T>::type;
+        message.int_val = 0;
+        TopicType<T>::set(message, value);
+        return pubsub_batch_add(&batch, topic.get_handle(), &message);
+    }
+
+    /** No implicit conversion, like Topic::publish */
+    template<typename T, typename V>
+    bool add(Topic<T> topic, V value) = delete;
+
+    void commit()
+    {
+        pubsub_batch_commit(&batch);
+    }
+
+private:
+    pubsub_batch_t batch;
+};
+
+/*
+ * Queue access by message type, selected at compile time.
+ */
+
+inline void subscribe(QueueHandle_t queue, const char *name, bool hot, pubsub_delivery_t delivery, TickType_t timeout,
+        pubsub_priority_t priority, const pubsub_compact_t*)
+{
+    pubsub_add_compact_subscription(queue, name, hot, delivery, timeout, priority);
+}
+
+inline void subscribe(QueueHandle_t queue, const char *name, bool hot, pubsub_delivery_t delivery, TickType_t timeout,
+        pubsub_priority_t priority, const pubsub_message_t*)
+{
+    pubsub_add_subscription_policy(queue, name, hot, delivery, timeout, priority);
+}
+
+inline BaseType_t receive(QueueHandle_t queue, pubsub_compact_t *message, TickType_t timeout)
+{
+    return pubsub_receive_compact(queue, message, timeout);
+}
+
+inline BaseType_t receive(QueueHandle_t queue, pubsub_message_t *message, TickType_t timeout)
+{
+    return pubsub_receive(queue, message, timeout);
+}
+
+/**
+ * Queue subscription to one or more topics with value type T.
+ * Uses compact 8 byte messages when T fits.
+ */
+template<typename T>
+class Subscription
+{
+public:
+    typedef typename std::conditional<TopicType<T>::compact, pubsub_compact_t, pubsub_message_t>::type message_t;
+
+    /**
+     * Create the queue once before use.
+     * @param priority of all topics added, PUBSUB_PRIORITY_HIGH for actuators
+     * @return true if successful
+     */
+    bool create(UBaseType_t length, pubsub_priority_t priority = PUBSUB_PRIORITY_NORMAL)
+    {
+        queue = xQueueCreate(length, sizeof(message_t));
+        this->priority = priority;
+        return queue != 0;
+    }
+
+    void add(Topic<T> topic, bool hot, pubsub_delivery_t delivery = PUBSUB_DELIVERY_DROP_NEWEST, TickType_t timeout = 0)
+    {
+        subscribe(queue, topic.get_name(), hot, delivery, timeout, priority, (const message_t*) 0);
+    }
+
+    void remove(Topic<T> topic)
+    {
+        pubsub_remove_subscription(queue, topic.get_name());
+    }
+
+    /** Receive next value and its topic handle */
+    bool receive(pubsub_topic_t *topic, T *value, TickType_t timeout)
+    {
+        message_t message;
+        if (!pubsub::receive(queue, &message, timeout)) {
+            return false;
+        }
+        *topic = message.handle;
+        *value = TopicType<T>::get(message);
+        return true;
+    }
+
+    bool receive(T *value, TickType_t timeout)
+    {
+        pubsub_topic_t topic;
+        return receive(&topic, value, timeout);
+    }
+
+    QueueHandle_t get_queue() const
+    {
+        return queue;
+    }
+
+private:
+    QueueHandle_t queue = 0;
+    pubsub_priority_t priority = PUBSUB_PRIORITY_NORMAL;
+};
+
+} // namespace pubsub
+
+} // extern "C++"
+
+#endif /* _PUBSUB_HPP_ */
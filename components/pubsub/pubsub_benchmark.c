@@ -0,0 +1,362 @@
+// The author disclaims copyright to this source code.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "pubsub.h"
+#include "pubsub_index.h"
+#include "pubsub_benchmark.h"
+
+/** Lookups per measurement */
+#define PUBSUB_BENCHMARK_LOOKUPS 10000
+/** Topic name length, including terminator */
+#define PUBSUB_BENCHMARK_NAME_LENGTH 16
+/** Publish to receive samples */
+#define PUBSUB_BENCHMARK_SAMPLES 1000
+/** Fan-out subscriber queues, maximum */
+#define PUBSUB_BENCHMARK_MAX_FAN_OUT 32
+/** Publishes per fan-out round, queue length */
+#define PUBSUB_BENCHMARK_ROUND 8
+/** Fan-out rounds per measurement */
+#define PUBSUB_BENCHMARK_ROUNDS 128
+/** Receiver task stack */
+#define PUBSUB_BENCHMARK_STACK_SIZE 2048
+
+static const char *TAG = "pubsub_benchmark";
+
+/*
+ * Results
+ *
+ * One JSON object per line on stdout, {"benchmark":"pubsub.<name>",...},
+ * times in microseconds (_us) or nanoseconds per operation (_ns).
+ * Lines not starting with '{' are log output.
+ */
+
+/** Prevent the compiler from optimizing the lookups away */
+static volatile uint32_t pubsub_benchmark_sink;
+
+/** Receiver of the latency benchmark */
+typedef struct
+{
+    QueueHandle_t queue;
+    TaskHandle_t caller;
+    int32_t *samples;
+    int count;
+} pubsub_benchmark_receiver_t;
+
+/**
+ * Topic order as published, pseudo random but repeatable.
+ */
+static uint16_t pubsub_benchmark_next(uint32_t *state, uint16_t number_of_topics)
+{
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) % number_of_topics;
+}
+
+/**
+ * Lookup as before handles: linear scan and compare names.
+ */
+static uint16_t pubsub_benchmark_linear(char **names, uint16_t number_of_topics, const char *name)
+{
+    for (uint16_t index = 0; index < number_of_topics; index++) {
+        if (strcmp(names[index], name) == 0) {
+            return index;
+        }
+    }
+    return PUBSUB_INDEX_NONE;
+}
+
+/** Nanoseconds per operation */
+static uint32_t pubsub_benchmark_ns(int64_t us, int operations)
+{
+    return (uint32_t) (us * 1000 / operations);
+}
+
+static int pubsub_benchmark_compare(const void *a, const void *b)
+{
+    int32_t left = *(const int32_t*) a;
+    int32_t right = *(const int32_t*) b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * Receive the samples, publish time is the message value.
+ * Higher priority than the publisher, waits on the queue when the publish happens.
+ */
+static void pubsub_benchmark_receive_task(void *pvParameter)
+{
+    pubsub_benchmark_receiver_t *receiver = (pubsub_benchmark_receiver_t*) pvParameter;
+    pubsub_message_t message;
+    for (int sample = 0; sample < receiver->count; sample++) {
+        while (!pubsub_receive(receiver->queue, &message, portMAX_DELAY)) {
+        }
+        receiver->samples[sample] = (int32_t) (esp_timer_get_time() - message.int_val);
+    }
+    xTaskNotifyGive(receiver->caller);
+    vTaskDelete(NULL);
+}
+
+/**
+ * Publish the samples and wait for the receiver.
+ */
+static void pubsub_benchmark_measure_latency(const char *name, pubsub_topic_t topic, pubsub_benchmark_receiver_t *receiver)
+{
+    pubsub_add_subscription_policy(receiver->queue, name, false, PUBSUB_DELIVERY_BLOCK, PUBSUB_BLOCK_TIMEOUT_MAX,
+            PUBSUB_PRIORITY_NORMAL);
+    BaseType_t ret = xTaskCreate(&pubsub_benchmark_receive_task, "bench.receive", PUBSUB_BENCHMARK_STACK_SIZE, receiver,
+            uxTaskPriorityGet(NULL) + 1, NULL);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "pubsub_benchmark_latency, failed to create task");
+        pubsub_remove_subscription(receiver->queue, name);
+        return;
+    }
+    for (int sample = 0; sample < receiver->count; sample++) {
+        pubsub_publish_int_h(topic, esp_timer_get_time());
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    pubsub_remove_subscription(receiver->queue, name);
+
+    int32_t *samples = receiver->samples;
+    int count = receiver->count;
+    qsort(samples, count, sizeof(int32_t), pubsub_benchmark_compare);
+    printf("{\"benchmark\":\"pubsub.latency\",\"samples\":%d,\"min_us\":%d,\"p50_us\":%d,\"p90_us\":%d,"
+            "\"p99_us\":%d,\"max_us\":%d}\n", count, (int) samples[0], (int) samples[count * 50 / 100],
+            (int) samples[count * 90 / 100], (int) samples[count * 99 / 100], (int) samples[count - 1]);
+}
+
+/**
+ * Publish to receive latency percentiles, one queue subscriber.
+ */
+static void pubsub_benchmark_latency()
+{
+    const char *name = "bench.latency";
+    pubsub_topic_t topic = pubsub_register_topic_handle(name, PUBSUB_TYPE_INT, true);
+    pubsub_benchmark_receiver_t receiver;
+    receiver.queue = xQueueCreate(PUBSUB_BENCHMARK_ROUND, sizeof(pubsub_message_t));
+    receiver.caller = xTaskGetCurrentTaskHandle();
+    receiver.samples = (int32_t*) malloc(sizeof(int32_t) * PUBSUB_BENCHMARK_SAMPLES);
+    receiver.count = PUBSUB_BENCHMARK_SAMPLES;
+    if (topic != PUBSUB_TOPIC_INVALID && receiver.queue != 0 && receiver.samples != NULL) {
+        pubsub_benchmark_measure_latency(name, topic, &receiver);
+    } else {
+        ESP_LOGE(TAG, "pubsub_benchmark_latency, out of resources");
+    }
+    free(receiver.samples);
+    if (receiver.queue != 0) {
+        vQueueDelete(receiver.queue);
+    }
+    pubsub_unregister_topic(name);
+}
+
+/**
+ * Publish cost with 0 to 32 queue subscribers.
+ * Queues are emptied between rounds, outside of the measurement, so no message is dropped.
+ */
+static void pubsub_benchmark_fan_out()
+{
+    const char *name = "bench.fan_out";
+    pubsub_topic_t topic = pubsub_register_topic_handle(name, PUBSUB_TYPE_INT, true);
+    if (topic == PUBSUB_TOPIC_INVALID) {
+        ESP_LOGE(TAG, "pubsub_benchmark_fan_out, out of topics");
+        return;
+    }
+    QueueHandle_t queues[PUBSUB_BENCHMARK_MAX_FAN_OUT];
+    int subscribers = 0;
+    for (int fan_out = 0; fan_out <= PUBSUB_BENCHMARK_MAX_FAN_OUT; fan_out = fan_out == 0 ? 1 : 2 * fan_out) {
+        while (subscribers < fan_out) {
+            queues[subscribers] = xQueueCreate(PUBSUB_BENCHMARK_ROUND, sizeof(pubsub_message_t));
+            if (queues[subscribers] == 0) {
+                break;
+            }
+            pubsub_add_subscription(queues[subscribers], name, false);
+            subscribers++;
+        }
+        if (subscribers < fan_out || pubsub_subscriber_count(name) != fan_out) {
+            ESP_LOGE(TAG, "pubsub_benchmark_fan_out, out of resources, subscribers:%d", fan_out);
+            break;
+        }
+
+        int64_t total_us = 0;
+        for (int round = 0; round < PUBSUB_BENCHMARK_ROUNDS; round++) {
+            for (int index = 0; index < subscribers; index++) {
+                xQueueReset(queues[index]);
+            }
+            int64_t start = esp_timer_get_time();
+            for (int publish = 0; publish < PUBSUB_BENCHMARK_ROUND; publish++) {
+                pubsub_publish_int_h(topic, publish);
+            }
+            total_us += esp_timer_get_time() - start;
+        }
+        printf("{\"benchmark\":\"pubsub.fan_out\",\"subscribers\":%d,\"publishes\":%d,\"publish_ns\":%u}\n",
+                fan_out, PUBSUB_BENCHMARK_ROUNDS * PUBSUB_BENCHMARK_ROUND,
+                pubsub_benchmark_ns(total_us, PUBSUB_BENCHMARK_ROUNDS * PUBSUB_BENCHMARK_ROUND));
+    }
+
+    for (int index = 0; index < subscribers; index++) {
+        pubsub_remove_subscription(queues[index], name);
+        vQueueDelete(queues[index]);
+    }
+    pubsub_unregister_topic(name);
+}
+
+/**
+ * pubsub_find_topic cost with number_of_topics registered, limited by the free registry elements.
+ * @param name_limit topics at most, interned names are never released.
+ * @return false if the registry or the name limit was full.
+ */
+static bool pubsub_benchmark_registry(uint16_t number_of_topics, uint16_t name_limit)
+{
+    bool limited = number_of_topics > name_limit;
+    if (limited) {
+        ESP_LOGW(TAG, "pubsub_benchmark_registry, name arena limit, topics:%d/%d", name_limit, number_of_topics);
+        number_of_topics = name_limit;
+    }
+    if (number_of_topics == 0) {
+        return false;
+    }
+    char (*names)[PUBSUB_BENCHMARK_NAME_LENGTH] = malloc(PUBSUB_BENCHMARK_NAME_LENGTH * number_of_topics);
+    if (names == NULL) {
+        ESP_LOGE(TAG, "pubsub_benchmark_registry, out of memory, topics:%d", number_of_topics);
+        return false;
+    }
+    uint16_t registered = 0;
+    while (registered < number_of_topics) {
+        snprintf(names[registered], PUBSUB_BENCHMARK_NAME_LENGTH, "b.%03d", registered);
+        if (pubsub_register_topic_handle(names[registered], PUBSUB_TYPE_INT, false) == PUBSUB_TOPIC_INVALID) {
+            break;
+        }
+        registered++;
+    }
+
+    if (registered > 0) {
+        uint32_t state = 1;
+        uint32_t sink = 0;
+        int64_t start = esp_timer_get_time();
+        for (int lookup = 0; lookup < PUBSUB_BENCHMARK_LOOKUPS; lookup++) {
+            sink += pubsub_find_topic(names[pubsub_benchmark_next(&state, registered)]);
+        }
+        int64_t find_us = esp_timer_get_time() - start;
+        pubsub_benchmark_sink = sink;
+
+        printf("{\"benchmark\":\"pubsub.find_topic\",\"topics\":%d,\"registry\":%d,\"lookups\":%d,\"find_ns\":%u}\n",
+                registered, pubsub_topic_count(), PUBSUB_BENCHMARK_LOOKUPS,
+                pubsub_benchmark_ns(find_us, PUBSUB_BENCHMARK_LOOKUPS));
+    }
+    if (registered < number_of_topics) {
+        ESP_LOGW(TAG, "pubsub_benchmark_registry, registry full, topics:%d/%d", registered, number_of_topics);
+    }
+
+    for (uint16_t topic = 0; topic < registered; topic++) {
+        pubsub_unregister_topic(names[topic]);
+    }
+    free(names);
+    return !limited && registered == number_of_topics;
+}
+
+/**
+ * Static memory per topic and per subscription, queue storage per message.
+ */
+static void pubsub_benchmark_memory()
+{
+    pubsub_capacity_t capacity;
+    pubsub_get_capacity(&capacity);
+    printf("{\"benchmark\":\"pubsub.memory\",\"topic_bytes\":%u,\"subscriber_bytes\":%u,\"message_bytes\":%u,"
+            "\"compact_bytes\":%u,\"name_bytes\":%u,\"topics\":%u,\"queue_bytes\":%u}\n", capacity.topic_bytes,
+            capacity.subscriber_bytes, (unsigned int) sizeof(pubsub_message_t), (unsigned int) sizeof(pubsub_compact_t),
+            capacity.names_used, capacity.topics_used, capacity.queue_bytes);
+}
+
+/**
+ * Name index cost independent of the registry capacity, compared to linear scan and handle.
+ */
+static void pubsub_benchmark_index(uint16_t number_of_topics)
+{
+    char **names = (char**) malloc(sizeof(char*) * number_of_topics);
+    uint16_t *handles = (uint16_t*) malloc(sizeof(uint16_t) * number_of_topics);
+    uint16_t index_size = 2 * number_of_topics;
+    pubsub_index_entry_t *entries = (pubsub_index_entry_t*) malloc(sizeof(pubsub_index_entry_t) * index_size);
+    if (names == NULL || handles == NULL || entries == NULL) {
+        ESP_LOGE(TAG, "pubsub_benchmark_index, out of memory, topics:%d", number_of_topics);
+        free(names);
+        free(handles);
+        free(entries);
+        return;
+    }
+
+    // topic names similar to the model (common prefixes)
+    pubsub_index_t index;
+    pubsub_index_initialize(&index, entries, index_size);
+    for (uint16_t topic = 0; topic < number_of_topics; topic++) {
+        names[topic] = (char*) malloc(PUBSUB_BENCHMARK_NAME_LENGTH);
+        snprintf(names[topic], PUBSUB_BENCHMARK_NAME_LENGTH, "temp.sv.%04d", topic);
+        handles[topic] = topic;
+        pubsub_index_insert(&index, names[topic], topic);
+    }
+
+    uint32_t state = 1;
+    uint32_t sink = 0;
+    int64_t start = esp_timer_get_time();
+    for (int lookup = 0; lookup < PUBSUB_BENCHMARK_LOOKUPS; lookup++) {
+        sink += pubsub_benchmark_linear(names, number_of_topics, names[pubsub_benchmark_next(&state, number_of_topics)]);
+    }
+    int64_t linear_us = esp_timer_get_time() - start;
+
+    state = 1;
+    start = esp_timer_get_time();
+    for (int lookup = 0; lookup < PUBSUB_BENCHMARK_LOOKUPS; lookup++) {
+        sink += pubsub_index_find(&index, names[pubsub_benchmark_next(&state, number_of_topics)]);
+    }
+    int64_t index_us = esp_timer_get_time() - start;
+
+    state = 1;
+    start = esp_timer_get_time();
+    for (int lookup = 0; lookup < PUBSUB_BENCHMARK_LOOKUPS; lookup++) {
+        sink += handles[pubsub_benchmark_next(&state, number_of_topics)];
+    }
+    int64_t handle_us = esp_timer_get_time() - start;
+
+    pubsub_benchmark_sink = sink;
+
+    printf("{\"benchmark\":\"pubsub.index\",\"topics\":%d,\"lookups\":%d,\"linear_ns\":%u,\"index_ns\":%u,"
+            "\"handle_ns\":%u}\n", number_of_topics, PUBSUB_BENCHMARK_LOOKUPS,
+            pubsub_benchmark_ns(linear_us, PUBSUB_BENCHMARK_LOOKUPS), pubsub_benchmark_ns(index_us, PUBSUB_BENCHMARK_LOOKUPS),
+            pubsub_benchmark_ns(handle_us, PUBSUB_BENCHMARK_LOOKUPS));
+
+    for (uint16_t topic = 0; topic < number_of_topics; topic++) {
+        free(names[topic]);
+    }
+    free(names);
+    free(handles);
+    free(entries);
+}
+
+void pubsub_benchmark()
+{
+    ESP_LOGI(TAG, "pubsub_benchmark");
+
+    pubsub_benchmark_memory();
+    pubsub_benchmark_latency();
+    pubsub_benchmark_fan_out();
+
+    // the registry sweep ends at its capacity, the index sweep covers all counts
+    static const uint16_t topic_counts[] = { 40, 200, 1000 };
+    // names of all sweeps are "b.NNN", use at most half of the free name arena, the rest stays for later topics
+    pubsub_capacity_t capacity;
+    pubsub_get_capacity(&capacity);
+    uint16_t name_limit = (capacity.names_max - capacity.names_used) / 2 / sizeof("b.000");
+    bool registry = true;
+    for (int index = 0; index < sizeof(topic_counts) / sizeof(topic_counts[0]); index++) {
+        pubsub_benchmark_index(topic_counts[index]);
+        if (registry) {
+            registry = pubsub_benchmark_registry(topic_counts[index], name_limit);
+        }
+    }
+}
@@ -0,0 +1,25 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _PUBSUB_BENCHMARK_H_
+#define _PUBSUB_BENCHMARK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Run pubsub benchmarks, results as JSON lines on stdout:
+ * - memory: static bytes per topic and subscription, message sizes,
+ * - latency: publish to receive percentiles with one queue subscriber,
+ * - fan_out: publish cost with 0 to 32 queue subscribers,
+ * - index: name lookup by linear scan (strcmp), hash index and handle at 40, 200 and 1000 topics,
+ * - find_topic: pubsub_find_topic at the same counts, up to the free registry capacity.
+ * Registers and removes its own topics, call after pubsub_initialize.
+ */
+extern void pubsub_benchmark();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PUBSUB_BENCHMARK_H_ */
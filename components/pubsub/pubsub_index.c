@@ -0,0 +1,122 @@
+// The author disclaims copyright to this source code.
+
+#include <string.h>
+
+#include "pubsub_index.h"
+
+/** Marks a removed entry, keeps probe sequences intact. */
+static const char pubsub_index_tombstone[] = "";
+
+/**
+ * FNV-1a 32-bit.
+ */
+uint32_t pubsub_index_hash(const char *key)
+{
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t) *key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void pubsub_index_initialize(pubsub_index_t *index, pubsub_index_entry_t *entries, uint16_t size)
+{
+    memset(entries, 0, sizeof(pubsub_index_entry_t) * size);
+    index->entries = entries;
+    index->size = size;
+    index->count = 0;
+}
+
+/*
+ * Lookups may run concurrently with a single writer.
+ * The writer fills hash and value before publishing the key (release),
+ * readers load the key (acquire) before hash and value,
+ * and load the key again after the value in case the entry was removed and reused meanwhile.
+ */
+static inline const char* pubsub_index_load_key(const pubsub_index_entry_t *entry)
+{
+    return __atomic_load_n(&entry->key, __ATOMIC_ACQUIRE);
+}
+
+static inline void pubsub_index_store_key(pubsub_index_entry_t *entry, const char *key)
+{
+    __atomic_store_n(&entry->key, key, __ATOMIC_RELEASE);
+}
+
+static pubsub_index_entry_t* pubsub_index_find_entry(const pubsub_index_t *index, const char *key, const char **found_key)
+{
+    uint32_t hash = pubsub_index_hash(key);
+    uint16_t position = hash % index->size;
+    for (uint16_t probe = 0; probe < index->size; probe++) {
+        pubsub_index_entry_t *entry = &index->entries[position];
+        const char *entry_key = pubsub_index_load_key(entry);
+        if (entry_key == NULL) {
+            return NULL;
+        }
+        if (entry_key != pubsub_index_tombstone && entry->hash == hash && strcmp(entry_key, key) == 0) {
+            *found_key = entry_key;
+            return entry;
+        }
+        position = (position + 1) % index->size;
+    }
+    return NULL;
+}
+
+bool pubsub_index_insert(pubsub_index_t *index, const char *key, uint16_t value)
+{
+    // keep at least one empty entry to terminate probing
+    if (index->count + 1 >= index->size) {
+        return false;
+    }
+    const char *found_key;
+    if (pubsub_index_find_entry(index, key, &found_key) != NULL) {
+        // already present
+        return false;
+    }
+    uint32_t hash = pubsub_index_hash(key);
+    uint16_t position = hash % index->size;
+    while (true) {
+        pubsub_index_entry_t *entry = &index->entries[position];
+        const char *entry_key = pubsub_index_load_key(entry);
+        if (entry_key == NULL || entry_key == pubsub_index_tombstone) {
+            // the key seen by a reader before this value is NULL or the tombstone
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            entry->hash = hash;
+            __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+            pubsub_index_store_key(entry, key);
+            index->count++;
+            return true;
+        }
+        position = (position + 1) % index->size;
+    }
+}
+
+uint16_t pubsub_index_find(const pubsub_index_t *index, const char *key)
+{
+    while (true) {
+        const char *found_key;
+        pubsub_index_entry_t *entry = pubsub_index_find_entry(index, key, &found_key);
+        if (entry == NULL) {
+            return PUBSUB_INDEX_NONE;
+        }
+        uint16_t value = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (pubsub_index_load_key(entry) == found_key) {
+            return value;
+        }
+        // removed and reused during the lookup, the name may now be elsewhere
+    }
+}
+
+bool pubsub_index_remove(pubsub_index_t *index, const char *key)
+{
+    const char *found_key;
+    pubsub_index_entry_t *entry = pubsub_index_find_entry(index, key, &found_key);
+    if (entry == NULL) {
+        return false;
+    }
+    pubsub_index_store_key(entry, pubsub_index_tombstone);
+    index->count--;
+    return true;
+}
@@ -0,0 +1,50 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _PUBSUB_INDEX_H_
+#define _PUBSUB_INDEX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Value returned when a key is not present. */
+#define PUBSUB_INDEX_NONE ((uint16_t) 0xFFFF)
+
+/** Index entry (open addressing, linear probing). */
+typedef struct
+{
+    /** key, NULL when empty, not owned by the index */
+    const char *key;
+    /** cached key hash, avoids string compare on mismatch */
+    uint32_t hash;
+    /** value (topic handle) */
+    uint16_t value;
+} pubsub_index_entry_t;
+
+/**
+ * Hash index from name to 16-bit value.
+ * Storage is provided by the caller, no dynamic allocation.
+ * Size should be at least twice the number of keys to keep probe sequences short.
+ */
+typedef struct
+{
+    pubsub_index_entry_t *entries;
+    uint16_t size;
+    uint16_t count;
+} pubsub_index_t;
+
+extern uint32_t pubsub_index_hash(const char *key);
+
+extern void pubsub_index_initialize(pubsub_index_t *index, pubsub_index_entry_t *entries, uint16_t size);
+extern bool pubsub_index_insert(pubsub_index_t *index, const char *key, uint16_t value);
+extern uint16_t pubsub_index_find(const pubsub_index_t *index, const char *key);
+extern bool pubsub_index_remove(pubsub_index_t *index, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PUBSUB_INDEX_H_ */
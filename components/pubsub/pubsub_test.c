@@ -1,13 +1,17 @@
 // The author disclaims copyright to this source code.
 
 #include <string.h>
+#include <stdatomic.h>
 
 #include "esp_log.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/task.h"
 
+#include "clock.h"
 #include "pubsub.h"
+#include "pubsub_trace.h"
 #include "pubsub_test.h"
 
 static const char *TAG = "pubsub_test";
@@ -15,6 +19,18 @@ static const char *TAG = "pubsub_test";
 static const char *TOPIC_PUBSUB_TEST_INT = "pubsub.test.int";
 static const char *TOPIC_PUBSUB_TEST_BOOL = "pubsub.test.bool";
 static const char *TOPIC_PUBSUB_TEST_DOUBLE = "pubsub.test.double";
+static const char *TOPIC_PUBSUB_TEST_PATTERN = "pubsub.test.pattern.int";
+static const char *TOPIC_PUBSUB_TEST_FILTER = "pubsub.filter.double";
+static const char *TOPIC_PUBSUB_STRESS_VALUE = "pubsub.stress.value";
+static const char *TOPIC_PUBSUB_STRESS_CHURN = "pubsub.stress.churn";
+
+/** Iterations per stress task */
+#define PUBSUB_STRESS_ITERATIONS 2000
+/** Number of stress tasks */
+#define PUBSUB_STRESS_TASKS 5
+
+static atomic_int pubsub_stress_done;
+static atomic_int pubsub_stress_errors;
 
 bool pubsub_test()
 {
@@ -22,6 +38,9 @@ bool pubsub_test()
 
     bool success = true;
 
+    pubsub_capacity_t capacity_before;
+    pubsub_get_capacity(&capacity_before);
+
     // create topic
     pubsub_register_topic(TOPIC_PUBSUB_TEST_INT, PUBSUB_TYPE_INT, true);
     pubsub_register_topic(TOPIC_PUBSUB_TEST_BOOL, PUBSUB_TYPE_BOOLEAN, true);
@@ -69,15 +88,15 @@ bool pubsub_test()
     pubsub_add_subscription(queueInt, TOPIC_PUBSUB_TEST_INT, false);
 
     // check
-    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_BOOL) == 1) {
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_BOOL) != 1) {
         ESP_LOGE(TAG, "expect 1 subscriber");
         success = false;
     }
-    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_DOUBLE) == 1) {
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_DOUBLE) != 1) {
         ESP_LOGE(TAG, "expect 1 subscriber");
         success = false;
     }
-    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_INT) == 2) {
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_INT) != 2) {
         ESP_LOGE(TAG, "expect 2 subscribers");
         success = false;
     }
@@ -132,6 +151,38 @@ bool pubsub_test()
         success = false;
     }
 
+    // latest value subscription
+    pubsub_latest_t *latest = pubsub_latest_create(NULL, 0);
+    uint32_t int_changed = pubsub_add_latest_subscription(latest, pubsub_find_topic(TOPIC_PUBSUB_TEST_INT));
+    uint32_t double_changed = pubsub_add_latest_subscription(latest, pubsub_find_topic(TOPIC_PUBSUB_TEST_DOUBLE));
+    if (int_changed == 0 || double_changed == 0 || int_changed == double_changed) {
+        ESP_LOGE(TAG, "expect distinct change bits");
+        success = false;
+    }
+    if (pubsub_latest_changes(latest) != (int_changed | double_changed)) {
+        ESP_LOGE(TAG, "expect initial changes");
+        success = false;
+    }
+    if (pubsub_latest_changes(latest) != 0) {
+        ESP_LOGE(TAG, "expect no changes");
+        success = false;
+    }
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 12);
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 13);
+    if (pubsub_latest_changes(latest) != int_changed) {
+        ESP_LOGE(TAG, "expect int changed");
+        success = false;
+    }
+    int_value = 0;
+    pubsub_last_int_h(pubsub_find_topic(TOPIC_PUBSUB_TEST_INT), &int_value);
+    if (int_value != 13) {
+        ESP_LOGE(TAG, "expect latest value 13");
+        success = false;
+    }
+    // drain queue subscribers
+    xQueueReset(queueMixed);
+    xQueueReset(queueInt);
+
     // remove subscriptions
     pubsub_remove_subscription(queueMixed, TOPIC_PUBSUB_TEST_BOOL);
     pubsub_remove_subscription(queueMixed, TOPIC_PUBSUB_TEST_DOUBLE);
@@ -147,15 +198,277 @@ bool pubsub_test()
         ESP_LOGE(TAG, "expect 0 subscriber");
         success = false;
     }
-    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_DOUBLE) != 0) {
-        ESP_LOGE(TAG, "expect 0 subscriber");
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_DOUBLE) != 1) {
+        ESP_LOGE(TAG, "expect 1 subscriber");
         success = false;
     }
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_INT) != 1) {
+        ESP_LOGE(TAG, "expect 1 subscriber");
+        success = false;
+    }
+
+    // remove latest value subscriber
+    pubsub_latest_delete(latest);
     if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_INT) != 0) {
         ESP_LOGE(TAG, "expect 0 subscribers");
         success = false;
     }
 
+    // delivery policies
+    pubsub_topic_t int_topic = pubsub_find_topic(TOPIC_PUBSUB_TEST_INT);
+    pubsub_delivery_stats_t stats;
+    QueueHandle_t queueOldest = xQueueCreate(2, sizeof(pubsub_message_t));
+    QueueHandle_t queueCoalesce = xQueueCreate(2, sizeof(pubsub_message_t));
+    pubsub_add_subscription_policy(queueOldest, TOPIC_PUBSUB_TEST_INT, false, PUBSUB_DELIVERY_DROP_OLDEST, 0,
+            PUBSUB_PRIORITY_NORMAL);
+    pubsub_add_subscription_policy(queueCoalesce, TOPIC_PUBSUB_TEST_INT, false, PUBSUB_DELIVERY_COALESCE, 0,
+            PUBSUB_PRIORITY_NORMAL);
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 31);
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 32);
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 33);
+    if (!pubsub_receive(queueOldest, &message, 0) || message.int_val != 32) {
+        ESP_LOGE(TAG, "expect oldest dropped");
+        success = false;
+    }
+    if (!pubsub_get_subscription_stats(queueOldest, int_topic, &stats) || stats.delivered != 3 || stats.dropped != 1
+            || stats.high_water != 2) {
+        ESP_LOGE(TAG, "expect 3 delivered, 1 dropped, high water 2");
+        success = false;
+    }
+    if (!pubsub_receive(queueCoalesce, &message, 0) || message.int_val != 33 || uxQueueMessagesWaiting(queueCoalesce) != 0) {
+        ESP_LOGE(TAG, "expect one coalesced message with last value");
+        success = false;
+    }
+    if (!pubsub_get_subscription_stats(queueCoalesce, int_topic, &stats) || stats.delivered != 1 || stats.coalesced != 2) {
+        ESP_LOGE(TAG, "expect 1 delivered, 2 coalesced");
+        success = false;
+    }
+    pubsub_remove_subscription(queueOldest, TOPIC_PUBSUB_TEST_INT);
+    pubsub_remove_subscription(queueCoalesce, TOPIC_PUBSUB_TEST_INT);
+    vQueueDelete(queueOldest);
+    vQueueDelete(queueCoalesce);
+
+    // shared queue, dropping the oldest message of a coalescing subscription allows its next message
+    pubsub_topic_t bool_topic = pubsub_find_topic(TOPIC_PUBSUB_TEST_BOOL);
+    QueueHandle_t queueShared = xQueueCreate(1, sizeof(pubsub_message_t));
+    pubsub_add_subscription_policy(queueShared, TOPIC_PUBSUB_TEST_BOOL, false, PUBSUB_DELIVERY_COALESCE, 0,
+            PUBSUB_PRIORITY_NORMAL);
+    pubsub_add_subscription_policy(queueShared, TOPIC_PUBSUB_TEST_INT, false, PUBSUB_DELIVERY_DROP_OLDEST, 0,
+            PUBSUB_PRIORITY_NORMAL);
+    pubsub_publish_bool(TOPIC_PUBSUB_TEST_BOOL, 0);
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 34);
+    if (!pubsub_receive(queueShared, &message, 0) || message.handle != int_topic) {
+        ESP_LOGE(TAG, "expect coalesced message dropped");
+        success = false;
+    }
+    if (!pubsub_get_subscription_stats(queueShared, bool_topic, &stats) || stats.dropped != 1) {
+        ESP_LOGE(TAG, "expect drop counted for coalesced topic");
+        success = false;
+    }
+    if (!pubsub_get_subscription_stats(queueShared, int_topic, &stats) || stats.delivered != 1 || stats.dropped != 0) {
+        ESP_LOGE(TAG, "expect 1 delivered, 0 dropped");
+        success = false;
+    }
+    pubsub_publish_bool(TOPIC_PUBSUB_TEST_BOOL, 1);
+    if (!pubsub_receive(queueShared, &message, 0) || message.handle != bool_topic || !message.boolean_val) {
+        ESP_LOGE(TAG, "expect coalesced topic delivered again");
+        success = false;
+    }
+    pubsub_remove_subscription(queueShared, TOPIC_PUBSUB_TEST_BOOL);
+    pubsub_remove_subscription(queueShared, TOPIC_PUBSUB_TEST_INT);
+    vQueueDelete(queueShared);
+
+    // hot subscribe to a full queue sends the last value without blocking, publish blocks at most the cap
+    QueueHandle_t queueBlock = xQueueCreate(1, sizeof(pubsub_message_t));
+    xQueueSendToBack(queueBlock, &message, 0);
+    TickType_t subscribe_start = xTaskGetTickCount();
+    pubsub_add_subscription_policy(queueBlock, TOPIC_PUBSUB_TEST_INT, true, PUBSUB_DELIVERY_BLOCK, portMAX_DELAY,
+            PUBSUB_PRIORITY_NORMAL);
+    if (xTaskGetTickCount() - subscribe_start >= PUBSUB_BLOCK_TIMEOUT_MAX) {
+        ESP_LOGE(TAG, "expect hot subscribe not blocked");
+        success = false;
+    }
+    if (!pubsub_get_subscription_stats(queueBlock, int_topic, &stats) || stats.dropped != 1) {
+        ESP_LOGE(TAG, "expect initial value dropped");
+        success = false;
+    }
+    TickType_t publish_start = xTaskGetTickCount();
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_INT, 35);
+    if (xTaskGetTickCount() - publish_start > PUBSUB_BLOCK_TIMEOUT_MAX + 1) {
+        ESP_LOGE(TAG, "expect block timeout capped");
+        success = false;
+    }
+    pubsub_remove_subscription(queueBlock, TOPIC_PUBSUB_TEST_INT);
+    vQueueDelete(queueBlock);
+
+    // compact message
+    QueueHandle_t queueCompact = xQueueCreate(2, sizeof(pubsub_compact_t));
+    pubsub_add_compact_subscription(queueCompact, TOPIC_PUBSUB_TEST_DOUBLE, true, PUBSUB_DELIVERY_DROP_NEWEST, 0,
+            PUBSUB_PRIORITY_NORMAL);
+    pubsub_compact_t compact;
+    if (!pubsub_receive_compact(queueCompact, &compact, 0) || compact.type != PUBSUB_TYPE_DOUBLE
+            || pubsub_compact_double(&compact) < 0.10 || pubsub_compact_double(&compact) > 0.12) {
+        ESP_LOGE(TAG, "expect compact value 0.11");
+        success = false;
+    }
+    pubsub_capacity_t capacity_compact;
+    pubsub_get_capacity(&capacity_compact);
+    if (capacity_compact.queue_bytes_full - capacity_compact.queue_bytes != 2 * (sizeof(pubsub_message_t) - sizeof(pubsub_compact_t))) {
+        ESP_LOGE(TAG, "expect compact queue RAM");
+        success = false;
+    }
+    pubsub_remove_subscription(queueCompact, TOPIC_PUBSUB_TEST_DOUBLE);
+    vQueueDelete(queueCompact);
+
+    // pattern subscription, existing and later registered topics
+    QueueHandle_t queuePattern = xQueueCreate(10, sizeof(pubsub_message_t));
+    pubsub_add_pattern_subscription(queuePattern, "pubsub.test.*", false);
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_BOOL) != 1) {
+        ESP_LOGE(TAG, "expect 1 pattern subscriber");
+        success = false;
+    }
+    pubsub_register_topic(TOPIC_PUBSUB_TEST_PATTERN, PUBSUB_TYPE_INT, true);
+    latest = pubsub_latest_create(NULL, 0);
+    uint32_t bool_changed = pubsub_add_latest_pattern(latest, "*.test.bool");
+    pubsub_latest_changes(latest);
+    pubsub_publish_int(TOPIC_PUBSUB_TEST_PATTERN, 21);
+    pubsub_publish_bool(TOPIC_PUBSUB_TEST_BOOL, false);
+    if (uxQueueMessagesWaiting(queuePattern) != 2) {
+        ESP_LOGE(TAG, "expect 2 pattern messages");
+        success = false;
+    }
+    if (bool_changed == 0 || pubsub_latest_changes(latest) != bool_changed) {
+        ESP_LOGE(TAG, "expect pattern change bit");
+        success = false;
+    }
+    pubsub_remove_pattern_subscription(queuePattern, "pubsub.test.*");
+    pubsub_latest_delete(latest);
+    if (pubsub_subscriber_count(TOPIC_PUBSUB_TEST_BOOL) != 0 || pubsub_subscriber_count(TOPIC_PUBSUB_TEST_PATTERN) != 0) {
+        ESP_LOGE(TAG, "expect 0 pattern subscribers");
+        success = false;
+    }
+    pubsub_unregister_topic(TOPIC_PUBSUB_TEST_PATTERN);
+    vQueueDelete(queuePattern);
+
+    // batch, type mismatch skipped
+    QueueHandle_t queueBatch = xQueueCreate(4, sizeof(pubsub_message_t));
+    pubsub_add_subscription(queueBatch, TOPIC_PUBSUB_TEST_INT, false);
+    pubsub_add_subscription(queueBatch, TOPIC_PUBSUB_TEST_DOUBLE, false);
+    latest = pubsub_latest_create(NULL, 0);
+    int_changed = pubsub_add_latest_subscription(latest, int_topic);
+    double_changed = pubsub_add_latest_subscription(latest, pubsub_find_topic(TOPIC_PUBSUB_TEST_DOUBLE));
+    pubsub_latest_changes(latest);
+    pubsub_batch_t batch;
+    pubsub_batch_begin(&batch);
+    pubsub_batch_int(&batch, int_topic, 41);
+    pubsub_batch_double(&batch, pubsub_find_topic(TOPIC_PUBSUB_TEST_DOUBLE), 0.41);
+    pubsub_batch_bool(&batch, int_topic, true);
+    unsigned int sequence = pubsub_snapshot_begin();
+    pubsub_batch_commit(&batch);
+    if (!pubsub_snapshot_retry(sequence)) {
+        ESP_LOGE(TAG, "expect snapshot retry after batch");
+        success = false;
+    }
+    sequence = pubsub_snapshot_begin();
+    if (pubsub_snapshot_retry(sequence)) {
+        ESP_LOGE(TAG, "expect no snapshot retry");
+        success = false;
+    }
+    if (pubsub_latest_changes(latest) != (int_changed | double_changed)) {
+        ESP_LOGE(TAG, "expect batch changes");
+        success = false;
+    }
+    if (!pubsub_receive(queueBatch, &message, 0) || message.int_val != 41 || !pubsub_receive(queueBatch, &message, 0)
+            || message.type != PUBSUB_TYPE_DOUBLE || uxQueueMessagesWaiting(queueBatch) != 0) {
+        ESP_LOGE(TAG, "expect 2 batch messages");
+        success = false;
+    }
+    pubsub_latest_delete(latest);
+    pubsub_remove_subscription(queueBatch, TOPIC_PUBSUB_TEST_INT);
+    pubsub_remove_subscription(queueBatch, TOPIC_PUBSUB_TEST_DOUBLE);
+    vQueueDelete(queueBatch);
+
+    // filter, deadband around last forwarded value, min interval
+    pubsub_filter_t filter = { .deadband = 0.5f, .relative = false, .min_interval_ms = 0 };
+    pubsub_topic_t filter_topic = pubsub_register_topic_filter(TOPIC_PUBSUB_TEST_FILTER, PUBSUB_TYPE_DOUBLE, false, &filter);
+    QueueHandle_t queueFilter = xQueueCreate(4, sizeof(pubsub_message_t));
+    pubsub_add_subscription(queueFilter, TOPIC_PUBSUB_TEST_FILTER, false);
+    pubsub_publish_double_h(filter_topic, 1.0);
+    pubsub_publish_double_h(filter_topic, 1.2);
+    pubsub_last_double_h(filter_topic, &double_value);
+    if (double_value != 1.2) {
+        ESP_LOGE(TAG, "expect suppressed value as last value");
+        success = false;
+    }
+    pubsub_publish_double_h(filter_topic, 1.4);
+    pubsub_publish_double_h(filter_topic, 1.6);
+    if (!pubsub_receive(queueFilter, &message, 0) || message.double_val != 1.0 || !pubsub_receive(queueFilter, &message, 0)
+            || message.double_val != 1.6 || uxQueueMessagesWaiting(queueFilter) != 0) {
+        ESP_LOGE(TAG, "expect 1.0 and 1.6 forwarded");
+        success = false;
+    }
+    if (!pubsub_get_topic_stats(filter_topic, &stats) || stats.suppressed != 2) {
+        ESP_LOGE(TAG, "expect 2 suppressed");
+        success = false;
+    }
+    if (pubsub_register_topic_filter(TOPIC_PUBSUB_TEST_FILTER, PUBSUB_TYPE_DOUBLE, false, NULL) != PUBSUB_TOPIC_INVALID) {
+        ESP_LOGE(TAG, "expect filter mismatch");
+        success = false;
+    }
+    pubsub_remove_subscription(queueFilter, TOPIC_PUBSUB_TEST_FILTER);
+    pubsub_unregister_topic(TOPIC_PUBSUB_TEST_FILTER);
+    filter.deadband = 0;
+    filter.min_interval_ms = 50;
+    filter_topic = pubsub_register_topic_filter(TOPIC_PUBSUB_TEST_FILTER, PUBSUB_TYPE_DOUBLE, false, &filter);
+    pubsub_add_subscription(queueFilter, TOPIC_PUBSUB_TEST_FILTER, false);
+    pubsub_publish_double_h(filter_topic, 2.0);
+    pubsub_publish_double_h(filter_topic, 3.0);
+    if (uxQueueMessagesWaiting(queueFilter) != 1 || pubsub_forward_pending(clock_now()) == 0
+            || uxQueueMessagesWaiting(queueFilter) != 1) {
+        ESP_LOGE(TAG, "expect 1 message and 3.0 pending in min interval");
+        success = false;
+    }
+    // held back change forwarded once the interval passed
+    clock_delay(filter.min_interval_ms * 1000);
+    if (pubsub_forward_pending(clock_now()) != 0 || !pubsub_receive(queueFilter, &message, 0) || message.double_val != 2.0
+            || !pubsub_receive(queueFilter, &message, 0) || message.double_val != 3.0) {
+        ESP_LOGE(TAG, "expect 3.0 forwarded after min interval");
+        success = false;
+    }
+    pubsub_remove_subscription(queueFilter, TOPIC_PUBSUB_TEST_FILTER);
+    pubsub_unregister_topic(TOPIC_PUBSUB_TEST_FILTER);
+    vQueueDelete(queueFilter);
+
+#ifdef CONFIG_PUBSUB_TRACE
+    // trace, publish, deliver to queue, receive, mark in order
+    pubsub_topic_t trace_topic = pubsub_find_topic(TOPIC_PUBSUB_TEST_INT);
+    QueueHandle_t queueTrace = xQueueCreate(1, sizeof(pubsub_message_t));
+    pubsub_add_subscription(queueTrace, TOPIC_PUBSUB_TEST_INT, false);
+    unsigned int trace_head = pubsub_trace_head();
+    pubsub_publish_int_h(trace_topic, 71);
+    pubsub_receive(queueTrace, &message, 0);
+    pubsub_trace_mark("pubsub.test");
+    const pubsub_trace_event_t trace_events[] = { PUBSUB_TRACE_PUBLISH, PUBSUB_TRACE_DELIVER, PUBSUB_TRACE_RECEIVE,
+            PUBSUB_TRACE_MARK };
+    if (pubsub_trace_head() - trace_head != 4) {
+        ESP_LOGE(TAG, "expect 4 trace records");
+        success = false;
+    }
+    for (int index = 0; index < 4; index++) {
+        pubsub_trace_record_t record;
+        if (!pubsub_trace_get(trace_head + index, &record) || record.event != trace_events[index]
+                || record.task != xTaskGetCurrentTaskHandle()) {
+            ESP_LOGE(TAG, "expect trace event:%d", trace_events[index]);
+            success = false;
+        } else if (index < 3 && (record.topic != trace_topic || (index > 0 && record.target != queueTrace))) {
+            ESP_LOGE(TAG, "expect trace topic and queue, event:%d", trace_events[index]);
+            success = false;
+        }
+    }
+    pubsub_remove_subscription(queueTrace, TOPIC_PUBSUB_TEST_INT);
+    vQueueDelete(queueTrace);
+#endif
+
     // unregister topic
     pubsub_unregister_topic(TOPIC_PUBSUB_TEST_BOOL);
     pubsub_unregister_topic(TOPIC_PUBSUB_TEST_DOUBLE);
@@ -179,8 +492,135 @@ bool pubsub_test()
         success = false;
     }
 
+    // pools returned, names kept for reuse
+    pubsub_capacity_t capacity;
+    pubsub_get_capacity(&capacity);
+    if (capacity.subscribers_used != capacity_before.subscribers_used || capacity.latest_used != capacity_before.latest_used
+            || capacity.patterns_used != capacity_before.patterns_used) {
+        ESP_LOGE(TAG, "expect subscribers returned to pool");
+        success = false;
+    }
+    uint16_t names_used = capacity.names_used;
+    pubsub_register_topic(TOPIC_PUBSUB_TEST_INT, PUBSUB_TYPE_INT, true);
+    pubsub_unregister_topic(TOPIC_PUBSUB_TEST_INT);
+    pubsub_get_capacity(&capacity);
+    if (capacity.names_used != names_used) {
+        ESP_LOGE(TAG, "expect name reused");
+        success = false;
+    }
+
     vQueueDelete(queueMixed);
     vQueueDelete(queueInt);
 
     return success;
 }
+
+/**
+ * Value with equal high and low word, a torn read breaks the pattern.
+ */
+static int64_t pubsub_stress_value(uint32_t counter)
+{
+    return (int64_t) (((uint64_t) counter << 32) | counter);
+}
+
+static bool pubsub_stress_valid(int64_t value)
+{
+    return (uint32_t) ((uint64_t) value >> 32) == (uint32_t) value;
+}
+
+static void pubsub_stress_publisher(void *parameter)
+{
+    uint32_t offset = (uint32_t) (uintptr_t) parameter;
+    pubsub_topic_t topic = pubsub_find_topic(TOPIC_PUBSUB_STRESS_VALUE);
+    for (uint32_t counter = 0; counter < PUBSUB_STRESS_ITERATIONS; counter++) {
+        pubsub_publish_int_h(topic, pubsub_stress_value(counter * 2 + offset));
+        // topic may or may not exist
+        pubsub_publish_bool(TOPIC_PUBSUB_STRESS_CHURN, counter & 1);
+        if ((counter & 0x3F) == 0) {
+            vTaskDelay(1);
+        }
+    }
+    atomic_fetch_add(&pubsub_stress_done, 1);
+    vTaskDelete(NULL);
+}
+
+static void pubsub_stress_reader(void *parameter)
+{
+    for (uint32_t counter = 0; counter < PUBSUB_STRESS_ITERATIONS; counter++) {
+        int64_t value;
+        if (!pubsub_last_int(TOPIC_PUBSUB_STRESS_VALUE, &value) || !pubsub_stress_valid(value)) {
+            atomic_fetch_add(&pubsub_stress_errors, 1);
+        }
+        if ((counter & 0x3F) == 0) {
+            vTaskDelay(1);
+        }
+    }
+    atomic_fetch_add(&pubsub_stress_done, 1);
+    vTaskDelete(NULL);
+}
+
+static void pubsub_stress_subscriber(void *parameter)
+{
+    QueueHandle_t queue = xQueueCreate(PUBSUB_STRESS_TASKS, sizeof(pubsub_message_t));
+    pubsub_message_t message;
+    for (uint32_t counter = 0; counter < PUBSUB_STRESS_ITERATIONS / 10; counter++) {
+        pubsub_add_subscription(queue, TOPIC_PUBSUB_STRESS_VALUE, true);
+        while (xQueueReceive(queue, &message, 0) == pdTRUE) {
+            if (message.type != PUBSUB_TYPE_INT || !pubsub_stress_valid(message.int_val)) {
+                atomic_fetch_add(&pubsub_stress_errors, 1);
+            }
+        }
+        pubsub_remove_subscription(queue, TOPIC_PUBSUB_STRESS_VALUE);
+        vTaskDelay(1);
+    }
+    vQueueDelete(queue);
+    atomic_fetch_add(&pubsub_stress_done, 1);
+    vTaskDelete(NULL);
+}
+
+static void pubsub_stress_registrar(void *parameter)
+{
+    QueueHandle_t queue = xQueueCreate(1, sizeof(pubsub_message_t));
+    for (uint32_t counter = 0; counter < PUBSUB_STRESS_ITERATIONS / 10; counter++) {
+        pubsub_register_topic(TOPIC_PUBSUB_STRESS_CHURN, PUBSUB_TYPE_BOOLEAN, true);
+        pubsub_add_subscription(queue, TOPIC_PUBSUB_STRESS_CHURN, false);
+        vTaskDelay(1);
+        pubsub_unregister_topic(TOPIC_PUBSUB_STRESS_CHURN);
+        xQueueReset(queue);
+    }
+    vQueueDelete(queue);
+    atomic_fetch_add(&pubsub_stress_done, 1);
+    vTaskDelete(NULL);
+}
+
+bool pubsub_stress_test()
+{
+    ESP_LOGI(TAG, "pubsub_stress_test");
+
+    atomic_store(&pubsub_stress_done, 0);
+    atomic_store(&pubsub_stress_errors, 0);
+    pubsub_register_topic(TOPIC_PUBSUB_STRESS_VALUE, PUBSUB_TYPE_INT, true);
+
+    xTaskCreate(pubsub_stress_publisher, "stress_pub0", 2048, (void*) 0, 1, NULL);
+    xTaskCreate(pubsub_stress_publisher, "stress_pub1", 2048, (void*) 1, 1, NULL);
+    xTaskCreate(pubsub_stress_reader, "stress_read", 2048, NULL, 1, NULL);
+    xTaskCreate(pubsub_stress_subscriber, "stress_sub", 2048, NULL, 1, NULL);
+    xTaskCreate(pubsub_stress_registrar, "stress_reg", 2048, NULL, 1, NULL);
+
+    while (atomic_load(&pubsub_stress_done) < PUBSUB_STRESS_TASKS) {
+        vTaskDelay(10);
+    }
+
+    bool success = true;
+    int errors = atomic_load(&pubsub_stress_errors);
+    if (errors != 0) {
+        ESP_LOGE(TAG, "expect no torn values, errors:%d", errors);
+        success = false;
+    }
+    pubsub_unregister_topic(TOPIC_PUBSUB_STRESS_VALUE);
+    if (pubsub_topic_count() != 0) {
+        ESP_LOGE(TAG, "expect 0 topics");
+        success = false;
+    }
+    return success;
+}
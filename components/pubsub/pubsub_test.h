@@ -15,6 +15,12 @@ extern "C" {
  */
 extern bool pubsub_test();
 
+/**
+ * Run concurrent publish, subscribe and register test.
+ * @return true if succesful
+ */
+extern bool pubsub_stress_test();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,142 @@
+// The author disclaims copyright to this source code.
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_PUBSUB_TRACE
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "clock.h"
+#include "pubsub.h"
+#include "pubsub_trace.h"
+
+#define PUBSUB_TRACE_RECORDS CONFIG_PUBSUB_TRACE_RECORDS
+#define PUBSUB_TRACE_MASK (PUBSUB_TRACE_RECORDS - 1)
+
+_Static_assert((PUBSUB_TRACE_RECORDS & PUBSUB_TRACE_MASK) == 0, "CONFIG_PUBSUB_TRACE_RECORDS is a power of two");
+
+static const char *tag = "pubsub_trace";
+
+/*
+ * Ring
+ *
+ * A writer takes the next position with one atomic add and overwrites the oldest record,
+ * it never waits and never drops. Each slot has a sequence lock: zero while written,
+ * position + 1 when complete. A reader copies a record and checks the sequence
+ * before and after, a record overwritten meanwhile is skipped.
+ */
+
+/** Ring slot */
+typedef struct
+{
+    atomic_uint sequence;
+    pubsub_trace_record_t record;
+} pubsub_trace_slot_t;
+
+static pubsub_trace_slot_t pubsub_trace_ring[PUBSUB_TRACE_RECORDS];
+/** next write position */
+static atomic_uint pubsub_trace_position;
+
+static const char *const pubsub_trace_events[] = { "publish", "deliver", "drop", "receive", "latest", "mark" };
+
+void pubsub_trace_initialize()
+{
+    for (int index = 0; index < PUBSUB_TRACE_RECORDS; index++) {
+        atomic_store(&pubsub_trace_ring[index].sequence, 0);
+    }
+    atomic_store(&pubsub_trace_position, 0);
+}
+
+/**
+ * Record event, lock free, also from ISR.
+ */
+void pubsub_trace(pubsub_trace_event_t event, pubsub_topic_t topic, const void *target)
+{
+    int64_t time = clock_now();
+    unsigned int position = atomic_fetch_add_explicit(&pubsub_trace_position, 1, memory_order_relaxed);
+    pubsub_trace_slot_t *slot = &pubsub_trace_ring[position & PUBSUB_TRACE_MASK];
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->record.time = time;
+    slot->record.target = target;
+    slot->record.task = xTaskGetCurrentTaskHandle();
+    slot->record.topic = topic;
+    slot->record.event = event;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+/**
+ * Record application event, e.g. the output write a chain of publishes ends in.
+ * @param label static string, printed by pubsub_trace_dump
+ */
+void pubsub_trace_mark(const char *label)
+{
+    pubsub_trace(PUBSUB_TRACE_MARK, PUBSUB_TOPIC_INVALID, label);
+}
+
+/**
+ * @return position of the next record, records before it back to
+ * head - CONFIG_PUBSUB_TRACE_RECORDS can be read.
+ */
+unsigned int pubsub_trace_head()
+{
+    return atomic_load(&pubsub_trace_position);
+}
+
+/**
+ * Copy record at position.
+ * @return false if not written yet, being written or overwritten.
+ */
+bool pubsub_trace_get(unsigned int position, pubsub_trace_record_t *record)
+{
+    pubsub_trace_slot_t *slot = &pubsub_trace_ring[position & PUBSUB_TRACE_MASK];
+    unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != position + 1) {
+        return false;
+    }
+    *record = slot->record;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence;
+}
+
+/**
+ * Print the records in the ring, oldest first, one line per record:
+ * pubsub_trace,<time us>,<event>,<topic or label>,<task>,<task name>,<target>
+ * Tasks must still exist, their names are looked up when printing.
+ */
+void pubsub_trace_dump()
+{
+    unsigned int head = pubsub_trace_head();
+    unsigned int position = head > PUBSUB_TRACE_RECORDS ? head - PUBSUB_TRACE_RECORDS : 0;
+    ESP_LOGI(tag, "pubsub_trace_dump, records:%u", head - position);
+    unsigned int skipped = 0;
+    for (; position != head; position++) {
+        pubsub_trace_record_t record;
+        if (!pubsub_trace_get(position, &record)) {
+            skipped++;
+            continue;
+        }
+        const char *name = "-";
+        if (record.event == PUBSUB_TRACE_MARK) {
+            name = (const char*) record.target;
+        } else if (record.topic != PUBSUB_TOPIC_INVALID) {
+            name = pubsub_topic_name(record.topic);
+            if (name == NULL) {
+                name = "?";
+            }
+        }
+        printf("pubsub_trace,%lld,%s,%s,%p,%s,%p\n", (long long) record.time, pubsub_trace_events[record.event], name,
+                record.task, record.task != NULL ? pcTaskGetName(record.task) : "-", record.target);
+    }
+    if (skipped != 0) {
+        ESP_LOGW(tag, "pubsub_trace_dump, overwritten while dumping:%u", skipped);
+    }
+}
+
+#endif
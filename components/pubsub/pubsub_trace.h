@@ -0,0 +1,91 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _PUBSUB_TRACE_H_
+#define _PUBSUB_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "pubsub.h"
+
+/**
+ * Message trace.
+ * With CONFIG_PUBSUB_TRACE pubsub records publish, delivery and receive events
+ * in a lock free ring that keeps the most recent CONFIG_PUBSUB_TRACE_RECORDS events.
+ * pubsub_trace_dump prints them, tools/pubsub_trace.py rebuilds the causal chains
+ * (temp.pv -> temp.hi -> heater -> mcp23s17.write) with the latency per hop.
+ * Without CONFIG_PUBSUB_TRACE the trace functions compile to nothing.
+ */
+
+/** Trace event */
+typedef enum
+{
+    /** topic published (forwarded by its filter), task is the publisher */
+    PUBSUB_TRACE_PUBLISH = 0,
+    /** message sent, target is the queue or latest value subscriber */
+    PUBSUB_TRACE_DELIVER = 1,
+    /** message sent before (deliver) was dropped, queue full */
+    PUBSUB_TRACE_DROP = 2,
+    /** message received from queue target, task is the receiver */
+    PUBSUB_TRACE_RECEIVE = 3,
+    /** changes taken from latest value subscriber target, no topic */
+    PUBSUB_TRACE_LATEST = 4,
+    /** application mark (output written), target is the label */
+    PUBSUB_TRACE_MARK = 5
+} pubsub_trace_event_t;
+
+/** Trace record */
+typedef struct
+{
+    /** clock_now time [us] */
+    int64_t time;
+    /** queue, latest value subscriber or label, see event */
+    const void *target;
+    /** task recording the event */
+    TaskHandle_t task;
+    pubsub_topic_t topic;
+    uint8_t event;
+} pubsub_trace_record_t;
+
+#ifdef CONFIG_PUBSUB_TRACE
+
+extern void pubsub_trace_initialize();
+extern void pubsub_trace(pubsub_trace_event_t event, pubsub_topic_t topic, const void *target);
+extern void pubsub_trace_mark(const char *label);
+extern unsigned int pubsub_trace_head();
+extern bool pubsub_trace_get(unsigned int position, pubsub_trace_record_t *record);
+extern void pubsub_trace_dump();
+
+#else
+
+static inline void pubsub_trace_initialize()
+{
+}
+
+static inline void pubsub_trace(pubsub_trace_event_t event, pubsub_topic_t topic, const void *target)
+{
+}
+
+static inline void pubsub_trace_mark(const char *label)
+{
+}
+
+static inline void pubsub_trace_dump()
+{
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PUBSUB_TRACE_H_ */
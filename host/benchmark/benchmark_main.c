@@ -0,0 +1,41 @@
+// The author disclaims copyright to this source code.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "binlog.h"
+#include "pubsub.h"
+#include "pubsub_benchmark.h"
+
+/** Benchmark task stack [words] */
+#define BENCHMARK_STACK_SIZE (8 * configMINIMAL_STACK_SIZE)
+
+/**
+ * Run the benchmark as a task, the scheduler does not return.
+ */
+static void benchmark_task(void *pvParameter)
+{
+    pubsub_benchmark();
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+    esp_timer_get_time();
+    // stdout is for results, only warnings and errors are logged
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    binlog_initialize();
+    pubsub_initialize();
+
+    xTaskCreate(&benchmark_task, "benchmark", BENCHMARK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+    vTaskStartScheduler();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,216 @@
+// The author disclaims copyright to this source code.
+
+extern "C" {
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "binlog.h"
+#include "clock.h"
+#include "pubsub.h"
+
+#include "model.h"
+#include "ctrl.h"
+#include "NVS.h"
+
+/**
+ * Whole system scenario: a 24 h day/night cycle with NVS write coalescing.
+ *
+ * The ctrl task, one NVS task per zone and an RTC task publishing the current time as the DS3234 does
+ * run unmodified and wait on the simulated clock, clock_run_until jumps from wait end to wait end.
+ * The day takes milliseconds, results do not depend on the host.
+ */
+
+/** Scenario task stack [words] */
+#define SCENARIO_STACK_SIZE (8 * configMINIMAL_STACK_SIZE)
+
+#define SCENARIO_MINUTE 60
+#define SCENARIO_HOUR (60 * SCENARIO_MINUTE)
+/** simulated clock at the start, as after boot [us] */
+#define SCENARIO_CLOCK_START CLOCK_MS(1000)
+/** current time at the start, 2026-01-01 00:00 UTC [s] */
+#define SCENARIO_TIME_START 1767225600
+/** RTC publish period, the circadian stage needs minutes [ms] */
+#define SCENARIO_RTC_PERIOD_MS (60 * 1000)
+/** as main.cpp [ms] */
+#define SCENARIO_NVS_HOLD_OFF_MS (60 * 1000)
+/** Real time for started tasks to reach their first wait on the clock, without preemption */
+#define SCENARIO_START_SETTLE pdMS_TO_TICKS(20)
+
+static NVS scenario_nvs[MODEL_ZONE_COUNT];
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+/**
+ * @return simulated clock at seconds after the start [us].
+ */
+static int64_t scenario_at(int64_t seconds)
+{
+    return SCENARIO_CLOCK_START + seconds * 1000000;
+}
+
+static bool scenario_light()
+{
+    bool light = false;
+    MODEL_LAST_BOOL(LIGHT, &light);
+    return light;
+}
+
+static void scenario_rtc_task(void *pvParameter)
+{
+    while (true) {
+        int64_t seconds = (clock_now() - SCENARIO_CLOCK_START) / 1000000;
+        MODEL_PUBLISH_INT(CURRENT_TIME, SCENARIO_TIME_START + seconds);
+        clock_delay(CLOCK_MS(SCENARIO_RTC_PERIOD_MS));
+    }
+}
+
+/**
+ * Persistent topics per zone, as nvs_setup in main.cpp.
+ */
+static void scenario_nvs_setup()
+{
+    static const char *nvs_settings[MODEL_ZONE_COUNT][MODEL_TOPIC_COUNT];
+    static char nvs_namespaces[MODEL_ZONE_COUNT][NVS_KEY_NAME_MAX_SIZE];
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        const pubsub_topic_t *topics = model_zone(zone);
+        size_t count = 0;
+        size_t key_offset = 0;
+        for (int id = 0; id < MODEL_TOPIC_COUNT; id++) {
+            uint8_t flags = model_topics[id].flags;
+            if ((flags & MODEL_FLAG_PERSIST) && (zone == 0 || (flags & MODEL_FLAG_ZONE))) {
+                const char *name = pubsub_topic_name(topics[id]);
+                key_offset = strlen(name) - strlen(model_topics[id].name);
+                nvs_settings[zone][count++] = name;
+            }
+        }
+        snprintf(nvs_namespaces[zone], sizeof(nvs_namespaces[zone]), "zone%d", zone + 1);
+        scenario_nvs[zone].setup(nvs_namespaces[zone], nvs_settings[zone], count, SCENARIO_NVS_HOLD_OFF_MS, key_offset);
+    }
+}
+
+/**
+ * Startup as app_main, first measurements of the sensors,
+ * then day 6:00-22:00 and automatic control set on the display.
+ */
+static void scenario_setup()
+{
+    model_initialize();
+    ctrl_initialize();
+    scenario_nvs_setup();
+    xTaskCreate(&scenario_rtc_task, "rtc", SCENARIO_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 293.15f);
+    MODEL_PUBLISH_FLOAT(HUM_PV, 70.0f);
+    MODEL_PUBLISH_FLOAT(CO2_PV, 500.0f);
+    MODEL_PUBLISH_INT(BEGIN_OF_DAY, 6 * SCENARIO_HOUR);
+    MODEL_PUBLISH_INT(BEGIN_OF_NIGHT, 22 * SCENARIO_HOUR);
+    MODEL_PUBLISH_INT(CONTROL_MODE, MODEL_CONTROL_MODE_AUTO);
+    vTaskDelay(SCENARIO_START_SETTLE);
+}
+
+/** Empty NVS: all settings stored once per zone after the hold off period, nothing after that */
+static void test_scenario_startup()
+{
+    clock_run_until(scenario_at(SCENARIO_NVS_HOLD_OFF_MS / 1000 - 1));
+    TEST_ASSERT_EQUAL_UINT32(0, esp_shim_nvs_commits());
+    clock_run_until(scenario_at(SCENARIO_NVS_HOLD_OFF_MS / 1000 + 1));
+    TEST_ASSERT_EQUAL_UINT32(MODEL_ZONE_COUNT, esp_shim_nvs_commits());
+    TEST_ASSERT_EQUAL_UINT32(MODEL_ZONE_COUNT, esp_shim_nvs_writes("day"));
+    uint32_t writes = esp_shim_nvs_writes(NULL);
+
+    clock_run_until(scenario_at(SCENARIO_HOUR));
+    TEST_ASSERT_EQUAL_UINT32(MODEL_ZONE_COUNT, esp_shim_nvs_commits());
+    TEST_ASSERT_EQUAL_UINT32(writes, esp_shim_nvs_writes(NULL));
+    TEST_ASSERT_FALSE(scenario_light());
+}
+
+static void test_scenario_morning()
+{
+    clock_run_until(scenario_at(6 * SCENARIO_HOUR - SCENARIO_MINUTE));
+    TEST_ASSERT_FALSE(scenario_light());
+    clock_run_until(scenario_at(6 * SCENARIO_HOUR + SCENARIO_MINUTE));
+    TEST_ASSERT_TRUE(scenario_light());
+}
+
+/** A setpoint adjusted in 10 steps on the display: one write, one commit after the last step */
+static void test_scenario_coalescing()
+{
+    clock_run_until(scenario_at(12 * SCENARIO_HOUR));
+    uint32_t writes = esp_shim_nvs_writes("temp.sv.day");
+    uint32_t commits = esp_shim_nvs_commits();
+    for (int step = 1; step <= 10; step++) {
+        MODEL_PUBLISH_FLOAT(TEMP_SV_DAY, 298.15f + step * 0.1f);
+        clock_run_until(scenario_at(12 * SCENARIO_HOUR + step * 5));
+    }
+    TEST_ASSERT_EQUAL_UINT32(commits, esp_shim_nvs_commits());
+    clock_run_until(scenario_at(12 * SCENARIO_HOUR + 50 + SCENARIO_NVS_HOLD_OFF_MS / 1000 + 1));
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, esp_shim_nvs_writes("temp.sv.day"));
+    TEST_ASSERT_EQUAL_UINT32(commits + 1, esp_shim_nvs_commits());
+}
+
+static void test_scenario_evening()
+{
+    clock_run_until(scenario_at(22 * SCENARIO_HOUR - SCENARIO_MINUTE));
+    TEST_ASSERT_TRUE(scenario_light());
+    clock_run_until(scenario_at(22 * SCENARIO_HOUR + SCENARIO_MINUTE));
+    TEST_ASSERT_FALSE(scenario_light());
+}
+
+/** Light switched on and off once in 24 h */
+static void test_scenario_day()
+{
+    clock_run_until(scenario_at(24 * SCENARIO_HOUR));
+    ctrl_switch_stats_t switches;
+    ctrl_get_switch_stats(0, &switches);
+    TEST_ASSERT_EQUAL_UINT32(2, switches.output_switches[CTRL_OUTPUT_LIGHT]);
+    // the heater scheduler does not touch the manual heater setpoint
+    TEST_ASSERT_EQUAL_UINT32(MODEL_ZONE_COUNT, esp_shim_nvs_writes("heater.sv"));
+}
+
+/**
+ * Run the scenario as a task, the scheduler does not return.
+ * Lowest priority, tasks woken by the clock run before it continues.
+ */
+static void scenario_task(void *pvParameter)
+{
+    UNITY_BEGIN();
+    scenario_setup();
+    RUN_TEST(test_scenario_startup);
+    RUN_TEST(test_scenario_morning);
+    RUN_TEST(test_scenario_coalescing);
+    RUN_TEST(test_scenario_evening);
+    RUN_TEST(test_scenario_day);
+    exit(UNITY_END());
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", getenv("TEST_LOG_INFO") != NULL ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+    // all waits on the simulated clock, from the start
+    clock_simulate(SCENARIO_CLOCK_START);
+    binlog_initialize();
+    pubsub_initialize();
+
+    xTaskCreate(&scenario_task, "scenario", SCENARIO_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
+    vTaskStartScheduler();
+    return EXIT_FAILURE;
+}
+
+}
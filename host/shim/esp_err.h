@@ -0,0 +1,27 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_ESP_ERR_H_
+#define _SHIM_ESP_ERR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * esp_err subset.
+ */
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+extern const char *esp_err_to_name(esp_err_t code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHIM_ESP_ERR_H_ */
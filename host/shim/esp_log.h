@@ -0,0 +1,48 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_ESP_LOG_H_
+#define _SHIM_ESP_LOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+/*
+ * esp_log subset, one runtime level for all tags.
+ */
+
+typedef enum
+{
+    ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+#endif
+
+extern void esp_log_level_set(const char *tag, esp_log_level_t level);
+extern uint32_t esp_log_timestamp();
+extern void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...);
+
+#define ESP_LOG_LEVEL(level, letter, tag, format, ...) \
+    do { \
+        if (LOG_LOCAL_LEVEL >= (level)) { \
+            esp_log_write((level), (tag), letter " (%u) %s: " format "\n", esp_log_timestamp(), (tag), ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHIM_ESP_LOG_H_ */
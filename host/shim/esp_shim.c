@@ -0,0 +1,50 @@
+// The author disclaims copyright to this source code.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/** Runtime log level, all tags */
+static esp_log_level_t esp_shim_log_level = ESP_LOG_INFO;
+
+static int64_t esp_shim_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/** Start time, first call */
+static int64_t esp_shim_start;
+
+int64_t esp_timer_get_time()
+{
+    if (esp_shim_start == 0) {
+        esp_shim_start = esp_shim_now();
+    }
+    return esp_shim_now() - esp_shim_start;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    esp_shim_log_level = level;
+}
+
+uint32_t esp_log_timestamp()
+{
+    return (uint32_t) (esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > esp_shim_log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
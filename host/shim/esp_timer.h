@@ -0,0 +1,19 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_ESP_TIMER_H_
+#define _SHIM_ESP_TIMER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** Time since start [us], monotonic clock */
+extern int64_t esp_timer_get_time();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHIM_ESP_TIMER_H_ */
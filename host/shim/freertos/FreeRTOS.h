@@ -0,0 +1,25 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_FREERTOS_H_
+#define _SHIM_FREERTOS_H_
+
+/*
+ * ESP-IDF includes the kernel as freertos/FreeRTOS.h,
+ * the vanilla kernel as FreeRTOS.h (found through the kernel include path).
+ */
+#include <FreeRTOS.h>
+
+/*
+ * ESP-IDF SMP critical sections take a spinlock, the POSIX port is single core.
+ */
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+
+#undef portENTER_CRITICAL
+#undef portEXIT_CRITICAL
+#define portENTER_CRITICAL(mux) ((void) (mux), vPortEnterCritical())
+#define portEXIT_CRITICAL(mux) ((void) (mux), vPortExitCritical())
+
+#define IRAM_ATTR
+
+#endif /* _SHIM_FREERTOS_H_ */
@@ -0,0 +1,9 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_FREERTOS_QUEUE_H_
+#define _SHIM_FREERTOS_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+#include <queue.h>
+
+#endif /* _SHIM_FREERTOS_QUEUE_H_ */
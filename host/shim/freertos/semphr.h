@@ -0,0 +1,9 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_FREERTOS_SEMPHR_H_
+#define _SHIM_FREERTOS_SEMPHR_H_
+
+#include "freertos/FreeRTOS.h"
+#include <semphr.h>
+
+#endif /* _SHIM_FREERTOS_SEMPHR_H_ */
@@ -0,0 +1,42 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_NVS_H_
+#define _SHIM_NVS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/*
+ * nvs subset, blobs in RAM, lost at exit.
+ */
+
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY, NVS_READWRITE
+} nvs_open_mode_t;
+
+extern esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+extern esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+extern esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+extern esp_err_t nvs_commit(nvs_handle_t handle);
+
+/** Host only: number of nvs_set_blob calls of key in all namespaces, of all keys if NULL */
+extern uint32_t esp_shim_nvs_writes(const char *key);
+/** Host only: number of nvs_commit calls */
+extern uint32_t esp_shim_nvs_commits();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHIM_NVS_H_ */
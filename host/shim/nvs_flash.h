@@ -0,0 +1,19 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_NVS_FLASH_H_
+#define _SHIM_NVS_FLASH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nvs.h"
+
+extern esp_err_t nvs_flash_init();
+extern esp_err_t nvs_flash_erase();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHIM_NVS_FLASH_H_ */
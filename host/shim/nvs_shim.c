@@ -0,0 +1,160 @@
+// The author disclaims copyright to this source code.
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "nvs_flash.h"
+
+/** Namespaces, handle is index + 1 */
+#define NVS_SHIM_NAMESPACES 8
+/** Blobs of all namespaces */
+#define NVS_SHIM_ENTRIES 256
+/** Largest blob [bytes] */
+#define NVS_SHIM_BLOB_SIZE 16
+
+typedef struct
+{
+    nvs_handle_t handle;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    uint8_t value[NVS_SHIM_BLOB_SIZE];
+    size_t length;
+    uint32_t writes;
+} nvs_shim_entry_t;
+
+static char nvs_shim_namespaces[NVS_SHIM_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static nvs_shim_entry_t nvs_shim_entries[NVS_SHIM_ENTRIES];
+static int nvs_shim_entry_count;
+static uint32_t nvs_shim_commits;
+static portMUX_TYPE nvs_shim_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Only called in the critical section.
+ * @return entry of key in namespace handle, NULL if not stored.
+ */
+static nvs_shim_entry_t* nvs_shim_find(nvs_handle_t handle, const char *key)
+{
+    for (int index = 0; index < nvs_shim_entry_count; index++) {
+        nvs_shim_entry_t *entry = &nvs_shim_entries[index];
+        if (entry->handle == handle && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_flash_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase()
+{
+    portENTER_CRITICAL(&nvs_shim_spinlock);
+    nvs_shim_entry_count = 0;
+    portEXIT_CRITICAL(&nvs_shim_spinlock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (strlen(name) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&nvs_shim_spinlock);
+    for (int index = 0; index < NVS_SHIM_NAMESPACES; index++) {
+        if (nvs_shim_namespaces[index][0] == '\0') {
+            strcpy(nvs_shim_namespaces[index], name);
+        }
+        if (strcmp(nvs_shim_namespaces[index], name) == 0) {
+            *out_handle = index + 1;
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&nvs_shim_spinlock);
+    return err;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+    portENTER_CRITICAL(&nvs_shim_spinlock);
+    const nvs_shim_entry_t *entry = nvs_shim_find(handle, key);
+    if (entry != NULL && entry->length <= *length) {
+        memcpy(out_value, entry->value, entry->length);
+        *length = entry->length;
+        err = ESP_OK;
+    } else if (entry != NULL) {
+        err = ESP_FAIL;
+    }
+    portEXIT_CRITICAL(&nvs_shim_spinlock);
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (length > NVS_SHIM_BLOB_SIZE || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&nvs_shim_spinlock);
+    nvs_shim_entry_t *entry = nvs_shim_find(handle, key);
+    if (entry == NULL && nvs_shim_entry_count < NVS_SHIM_ENTRIES) {
+        entry = &nvs_shim_entries[nvs_shim_entry_count++];
+        entry->handle = handle;
+        strcpy(entry->key, key);
+        entry->writes = 0;
+    }
+    if (entry != NULL) {
+        memcpy(entry->value, value, length);
+        entry->length = length;
+        entry->writes++;
+    } else {
+        err = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&nvs_shim_spinlock);
+    return err;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    portENTER_CRITICAL(&nvs_shim_spinlock);
+    nvs_shim_commits++;
+    portEXIT_CRITICAL(&nvs_shim_spinlock);
+    return ESP_OK;
+}
+
+uint32_t esp_shim_nvs_writes(const char *key)
+{
+    uint32_t writes = 0;
+    portENTER_CRITICAL(&nvs_shim_spinlock);
+    for (int index = 0; index < nvs_shim_entry_count; index++) {
+        if (key == NULL || strcmp(nvs_shim_entries[index].key, key) == 0) {
+            writes += nvs_shim_entries[index].writes;
+        }
+    }
+    portEXIT_CRITICAL(&nvs_shim_spinlock);
+    return writes;
+}
+
+uint32_t esp_shim_nvs_commits()
+{
+    return nvs_shim_commits;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    default:
+        return "ESP_FAIL";
+    }
+}
@@ -0,0 +1,28 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SHIM_SDKCONFIG_H_
+#define _SHIM_SDKCONFIG_H_
+
+/*
+ * Kconfig defaults of the ESP32 build, host build only.
+ * Two ctrl zones, pubsub capacity as the Kconfig defaults follow CTRL_ZONES.
+ */
+
+#define CONFIG_PUBSUB_MAX_TOPICS 128
+#define CONFIG_PUBSUB_MAX_SUBSCRIBERS 256
+#define CONFIG_PUBSUB_MAX_LATEST 24
+#define CONFIG_PUBSUB_MAX_PATTERNS 8
+#define CONFIG_PUBSUB_NAME_ARENA_SIZE 2048
+
+#define CONFIG_CTRL_ZONES 2
+
+#define CONFIG_CLOCK_SIMULATION 1
+#define CONFIG_CLOCK_MAX_TASKS 16
+
+#define CONFIG_BINLOG_RECORDS 64
+#define CONFIG_BINLOG_DRAIN_PERIOD_MS 100
+
+/** cycles per sample in ctrl_benchmark, host clock differs */
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ 240
+
+#endif /* _SHIM_SDKCONFIG_H_ */
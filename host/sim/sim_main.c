@@ -0,0 +1,293 @@
+// The author disclaims copyright to this source code.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "binlog.h"
+#include "clock.h"
+#include "pubsub.h"
+
+#include "model.h"
+#include "ctrl.h"
+
+#include "sim_plant.h"
+
+/**
+ * Closed loop simulation of zone 1: the plant model feeds the sensor topics,
+ * the unmodified ctrl stages drive the actuator topics, on the simulated clock.
+ *
+ * The stages run stepped, without the ctrl task: each step advances the simulated clock,
+ * publishes time and measurements and runs the stages with changed inputs or passed deadlines.
+ * No real time passes, results do not depend on the host scheduler.
+ *
+ * Prints one JSON object per simulated day and a summary, see host/README.adoc.
+ */
+
+/** Simulation task stack [words] */
+#define SIM_STACK_SIZE (8 * configMINIMAL_STACK_SIZE)
+
+#define SIM_DEFAULT_DAYS 30
+#define SIM_DEFAULT_STEP_S 10
+#define SIM_SECONDS_PER_DAY (24 * 60 * 60)
+#define SIM_HOUR (60 * 60)
+#define SIM_KELVIN 273.15f
+/** simulated clock at the start, as after boot [us] */
+#define SIM_CLOCK_START CLOCK_MS(1000)
+
+/** sensor measurement periods, as main.cpp [s] */
+#define SIM_AM2301_PERIOD_S 60
+#define SIM_MHZ19B_PERIOD_S 120
+
+/** Tracking error of a quantity */
+typedef struct
+{
+    double sum_abs;
+    double sum_square;
+    double max_abs;
+    /** time above the setpoint [s] */
+    double above;
+    uint32_t samples;
+} sim_error_t;
+
+/** Energy of an actuator [J] and its on time [s] */
+typedef struct
+{
+    const char *name;
+    double power;
+    double energy;
+    double on_time;
+} sim_energy_t;
+
+static int sim_days = SIM_DEFAULT_DAYS;
+static int sim_step_s = SIM_DEFAULT_STEP_S;
+
+/** sensor noise, fixed seed for reproducible runs */
+static uint32_t sim_noise_state = 1;
+
+/**
+ * @return uniform noise in -amplitude..amplitude.
+ */
+static float sim_noise(float amplitude)
+{
+    sim_noise_state = sim_noise_state * 1664525 + 1013904223;
+    return amplitude * ((sim_noise_state >> 8) / (float) (1 << 24) * 2.0f - 1.0f);
+}
+
+/**
+ * @return value rounded to resolution, as the sensor reports it.
+ */
+static float sim_quantize(double value, float resolution)
+{
+    return roundf((float) value / resolution) * resolution;
+}
+
+static void sim_error_add(sim_error_t *error, double value, double dt)
+{
+    double abs_value = fabs(value);
+    error->sum_abs += abs_value;
+    error->sum_square += value * value;
+    if (abs_value > error->max_abs) {
+        error->max_abs = abs_value;
+    }
+    if (value > 0.0) {
+        error->above += dt;
+    }
+    error->samples++;
+}
+
+static void sim_error_print(const char *name, const sim_error_t *error, double duration)
+{
+    uint32_t samples = error->samples > 0 ? error->samples : 1;
+    printf("\"%s_mae\":%.3f,\"%s_rms\":%.3f,\"%s_max\":%.3f,\"%s_above_pct\":%.1f", name, error->sum_abs / samples,
+            name, sqrt(error->sum_square / samples), name, error->max_abs, name, 100.0 * error->above / duration);
+}
+
+static void sim_energy_print(const sim_energy_t *energy, int count)
+{
+    double total = 0.0;
+    for (int index = 0; index < count; index++) {
+        printf("\"%s_on_h\":%.2f,\"%s_kwh\":%.3f,", energy[index].name, energy[index].on_time / SIM_HOUR,
+                energy[index].name, energy[index].energy / 3.6e6);
+        total += energy[index].energy;
+    }
+    printf("\"energy_kwh\":%.3f", total / 3.6e6);
+}
+
+/**
+ * Automatic control, light 6:00-24:00, 25/20 degrees C, humidity 70/65 %, CO2 1000 ppm.
+ * Bands, minimum on and off times and heater tuning are the ctrl defaults.
+ */
+static void sim_setup()
+{
+    MODEL_PUBLISH_INT(BEGIN_OF_DAY, 6 * SIM_HOUR);
+    MODEL_PUBLISH_INT(BEGIN_OF_NIGHT, 0);
+    MODEL_PUBLISH_FLOAT(TEMP_SV_DAY, SIM_KELVIN + 25.0f);
+    MODEL_PUBLISH_FLOAT(TEMP_SV_NIGHT, SIM_KELVIN + 20.0f);
+    MODEL_PUBLISH_FLOAT(HUM_SV_DAY, 70.0f);
+    MODEL_PUBLISH_FLOAT(HUM_SV_NIGHT, 65.0f);
+    MODEL_PUBLISH_FLOAT(CO2_SV_DAY, 1000.0f);
+    MODEL_PUBLISH_FLOAT(CO2_SV_NIGHT, 1000.0f);
+    MODEL_PUBLISH_INT(CONTROL_MODE, MODEL_CONTROL_MODE_AUTO);
+}
+
+static void sim_publish_sensors(const sim_plant_t *plant, int64_t time)
+{
+    if (time % SIM_AM2301_PERIOD_S == 0) {
+        MODEL_PUBLISH_FLOAT(TEMP_PV, sim_quantize(plant->temp + sim_noise(0.1f), 0.1f));
+        MODEL_PUBLISH_FLOAT(HUM_PV, sim_quantize(sim_plant_humidity(plant) + sim_noise(0.5f), 0.1f));
+    }
+    if (time % SIM_MHZ19B_PERIOD_S == 0) {
+        MODEL_PUBLISH_FLOAT(CO2_PV, sim_quantize(plant->co2 + sim_noise(20.0f), 1.0f));
+    }
+}
+
+static void sim_read_actuators(sim_actuators_t *actuators)
+{
+    MODEL_LAST_BOOL(EXHAUST, &actuators->exhaust);
+    MODEL_LAST_BOOL(HEATER, &actuators->heater);
+    MODEL_LAST_BOOL(LIGHT, &actuators->light);
+    MODEL_LAST_BOOL(RECIRC, &actuators->recirc);
+}
+
+static void sim_print_switches()
+{
+    ctrl_switch_stats_t switches;
+    ctrl_get_switch_stats(0, &switches);
+    printf("\"exhaust_switches\":%u,\"heater_switches\":%u,\"light_switches\":%u,\"recirc_switches\":%u,"
+            "\"exhaust_demand_switches\":%u,\"heater_demand_switches\":%u,"
+            "\"temp_crossings\":%u,\"temp_indicator_switches\":%u,\"hum_crossings\":%u,\"hum_indicator_switches\":%u",
+            switches.output_switches[CTRL_OUTPUT_EXHAUST], switches.output_switches[CTRL_OUTPUT_HEATER],
+            switches.output_switches[CTRL_OUTPUT_LIGHT], switches.output_switches[CTRL_OUTPUT_RECIRC],
+            switches.demand_switches[CTRL_OUTPUT_EXHAUST], switches.demand_switches[CTRL_OUTPUT_HEATER],
+            switches.crossings[CTRL_QUANTITY_TEMP], switches.indicator_switches[CTRL_QUANTITY_TEMP],
+            switches.crossings[CTRL_QUANTITY_HUM], switches.indicator_switches[CTRL_QUANTITY_HUM]);
+}
+
+static int64_t sim_wall_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void sim_run()
+{
+    sim_plant_t plant;
+    sim_plant_initialize(&plant);
+    sim_error_t temp_error = { 0 }, hum_error = { 0 }, co2_error = { 0 };
+    sim_error_t day_temp_error = { 0 }, day_hum_error = { 0 }, day_co2_error = { 0 };
+    sim_energy_t energy[] = {
+        { .name = "exhaust", .power = SIM_PLANT_EXHAUST_POWER },
+        { .name = "heater", .power = SIM_PLANT_HEATER_POWER },
+        { .name = "light", .power = SIM_PLANT_LIGHT_POWER },
+        { .name = "recirc", .power = SIM_PLANT_RECIRC_POWER }
+    };
+    int energy_count = sizeof(energy) / sizeof(energy[0]);
+
+    int64_t duration = (int64_t) sim_days * SIM_SECONDS_PER_DAY;
+    int64_t wall_start = sim_wall_ms();
+    sim_publish_sensors(&plant, 0);
+    MODEL_PUBLISH_INT(CURRENT_TIME, 0);
+    ctrl_step();
+    for (int64_t time = sim_step_s; time <= duration; time += sim_step_s) {
+        sim_actuators_t actuators;
+        sim_read_actuators(&actuators);
+        bool on[] = { actuators.exhaust, actuators.heater, actuators.light, actuators.recirc };
+        for (int index = 0; index < energy_count; index++) {
+            if (on[index]) {
+                energy[index].energy += energy[index].power * sim_step_s;
+                energy[index].on_time += sim_step_s;
+            }
+        }
+
+        plant.growth = (double) time / duration;
+        sim_plant_step(&plant, &actuators, sim_step_s, time % SIM_SECONDS_PER_DAY);
+        clock_advance((int64_t) sim_step_s * 1000000);
+        sim_publish_sensors(&plant, time);
+        MODEL_PUBLISH_INT(CURRENT_TIME, time);
+        ctrl_step();
+
+        float temp_sv, hum_sv, co2_sv;
+        MODEL_LAST_FLOAT(TEMP_SV, &temp_sv);
+        MODEL_LAST_FLOAT(HUM_SV, &hum_sv);
+        MODEL_LAST_FLOAT(CO2_SV, &co2_sv);
+        sim_error_add(&day_temp_error, plant.temp - temp_sv, sim_step_s);
+        sim_error_add(&day_hum_error, sim_plant_humidity(&plant) - hum_sv, sim_step_s);
+        sim_error_add(&day_co2_error, plant.co2 - co2_sv, sim_step_s);
+        sim_error_add(&temp_error, plant.temp - temp_sv, sim_step_s);
+        sim_error_add(&hum_error, sim_plant_humidity(&plant) - hum_sv, sim_step_s);
+        sim_error_add(&co2_error, plant.co2 - co2_sv, sim_step_s);
+
+        if (time % SIM_SECONDS_PER_DAY == 0) {
+            printf("{\"simulation\":\"day\",\"day\":%d,", (int) (time / SIM_SECONDS_PER_DAY));
+            sim_error_print("temp", &day_temp_error, SIM_SECONDS_PER_DAY);
+            printf(",");
+            sim_error_print("hum", &day_hum_error, SIM_SECONDS_PER_DAY);
+            printf(",");
+            sim_error_print("co2", &day_co2_error, SIM_SECONDS_PER_DAY);
+            printf("}\n");
+            day_temp_error = (sim_error_t) { 0 };
+            day_hum_error = (sim_error_t) { 0 };
+            day_co2_error = (sim_error_t) { 0 };
+        }
+    }
+
+    printf("{\"simulation\":\"summary\",\"days\":%d,\"step_s\":%d,\"wall_ms\":%lld,", sim_days, sim_step_s,
+            (long long) (sim_wall_ms() - wall_start));
+    sim_error_print("temp", &temp_error, duration);
+    printf(",");
+    sim_error_print("hum", &hum_error, duration);
+    printf(",");
+    sim_error_print("co2", &co2_error, duration);
+    printf(",");
+    sim_print_switches();
+    printf(",");
+    sim_energy_print(energy, energy_count);
+    printf("}\n");
+}
+
+/**
+ * Run the simulation as a task, the scheduler does not return.
+ */
+static void sim_task(void *pvParameter)
+{
+    model_initialize();
+    ctrl_initialize_stepped();
+    sim_setup();
+    sim_run();
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        sim_days = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        sim_step_s = atoi(argv[2]);
+    }
+    if (sim_days <= 0 || sim_step_s <= 0 || SIM_AM2301_PERIOD_S % sim_step_s != 0) {
+        fprintf(stderr, "usage: host_sim [days] [step seconds, divides %d]\n", SIM_AM2301_PERIOD_S);
+        return EXIT_FAILURE;
+    }
+
+    // no real time passes, from the start
+    clock_simulate(SIM_CLOCK_START);
+    // stdout is for results, only warnings and errors are logged
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    binlog_initialize();
+    pubsub_initialize();
+
+    xTaskCreate(&sim_task, "sim", SIM_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+    vTaskStartScheduler();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+// The author disclaims copyright to this source code.
+
+#include <math.h>
+
+#include "sim_plant.h"
+
+/** tent 1.2 x 1.2 x 2 m [m3] */
+#define SIM_PLANT_VOLUME 2.9
+/** air, pots, soil and frame [J/K] */
+#define SIM_PLANT_HEAT_CAPACITY 30000.0
+/** fabric wall losses [W/K] */
+#define SIM_PLANT_LOSS 40.0
+/** air leakage through the passive intake [air changes/s], 1.5 per hour */
+#define SIM_PLANT_LEAKAGE (1.5 / 3600.0)
+/** exhaust fan flow [m3/s], 125 m3/h */
+#define SIM_PLANT_EXHAUST_FLOW (125.0 / 3600.0)
+/** volumetric heat capacity of air [J/m3K] */
+#define SIM_PLANT_AIR_HEAT 1200.0
+/** share of light power that heats the tent */
+#define SIM_PLANT_LIGHT_HEAT 0.85
+
+/** ambient air, mean temperature [K], daily swing [K], relative humidity [%], CO2 [ppm] */
+#define SIM_PLANT_AMBIENT_TEMP 292.15
+#define SIM_PLANT_AMBIENT_SWING 3.0
+#define SIM_PLANT_AMBIENT_HUMIDITY 55.0
+#define SIM_PLANT_AMBIENT_CO2 420.0
+
+/** transpiration of grown plants, dark and light [g/s] */
+#define SIM_PLANT_TRANSPIRATION_DARK (20.0 / 3600.0)
+#define SIM_PLANT_TRANSPIRATION_LIGHT (90.0 / 3600.0)
+/** CO2 uptake under light and respiration in the dark of grown plants [ppm/s] */
+#define SIM_PLANT_UPTAKE (180.0 / 3600.0)
+#define SIM_PLANT_RESPIRATION (40.0 / 3600.0)
+/** young plants transpire and exchange this share of grown plants */
+#define SIM_PLANT_SEEDLING 0.2
+
+#define SIM_PLANT_KELVIN 273.15
+#define SIM_PLANT_SECONDS_PER_DAY 86400.0
+
+/**
+ * @return saturation vapour density at temperature [g/m3], Magnus formula.
+ */
+static double sim_plant_saturation(double temp)
+{
+    double celsius = temp - SIM_PLANT_KELVIN;
+    double pressure = 611.2 * exp(17.62 * celsius / (243.12 + celsius));
+    // ideal gas, water 18.015 g/mol
+    return pressure * 18.015 / (8.314 * temp);
+}
+
+/**
+ * @return ambient temperature at time of day [K], coldest at 5:00.
+ */
+static double sim_plant_ambient(double time_of_day)
+{
+    double phase = 2.0 * M_PI * (time_of_day / SIM_PLANT_SECONDS_PER_DAY - 17.0 / 24.0);
+    return SIM_PLANT_AMBIENT_TEMP + SIM_PLANT_AMBIENT_SWING * cos(phase);
+}
+
+void sim_plant_initialize(sim_plant_t *plant)
+{
+    plant->ambient_temp = sim_plant_ambient(0.0);
+    plant->temp = plant->ambient_temp;
+    plant->vapour = sim_plant_saturation(plant->temp) * SIM_PLANT_AMBIENT_HUMIDITY / 100.0;
+    plant->co2 = SIM_PLANT_AMBIENT_CO2;
+    plant->growth = 0.0;
+}
+
+void sim_plant_step(sim_plant_t *plant, const sim_actuators_t *actuators, double dt, double time_of_day)
+{
+    plant->ambient_temp = sim_plant_ambient(time_of_day);
+    double ambient_vapour = sim_plant_saturation(plant->ambient_temp) * SIM_PLANT_AMBIENT_HUMIDITY / 100.0;
+    // air exchanged with ambient [m3/s]
+    double flow = SIM_PLANT_LEAKAGE * SIM_PLANT_VOLUME + (actuators->exhaust ? SIM_PLANT_EXHAUST_FLOW : 0.0);
+    double activity = SIM_PLANT_SEEDLING + (1.0 - SIM_PLANT_SEEDLING) * plant->growth;
+
+    double heat = (actuators->heater ? SIM_PLANT_HEATER_POWER : 0.0)
+            + (actuators->light ? SIM_PLANT_LIGHT_POWER * SIM_PLANT_LIGHT_HEAT : 0.0)
+            + (actuators->recirc ? SIM_PLANT_RECIRC_POWER : 0.0)
+            - (SIM_PLANT_LOSS + flow * SIM_PLANT_AIR_HEAT) * (plant->temp - plant->ambient_temp);
+    plant->temp += heat * dt / SIM_PLANT_HEAT_CAPACITY;
+
+    double transpiration = activity
+            * (actuators->light ? SIM_PLANT_TRANSPIRATION_LIGHT : SIM_PLANT_TRANSPIRATION_DARK);
+    double vapour = transpiration - flow * (plant->vapour - ambient_vapour);
+    plant->vapour += vapour * dt / SIM_PLANT_VOLUME;
+    // condensation on the walls above saturation
+    double saturation = sim_plant_saturation(plant->temp);
+    if (plant->vapour > saturation) {
+        plant->vapour = saturation;
+    }
+
+    double exchange = activity * (actuators->light ? -SIM_PLANT_UPTAKE : SIM_PLANT_RESPIRATION);
+    double co2 = exchange - flow / SIM_PLANT_VOLUME * (plant->co2 - SIM_PLANT_AMBIENT_CO2);
+    plant->co2 += co2 * dt;
+    if (plant->co2 < 0.0) {
+        plant->co2 = 0.0;
+    }
+}
+
+double sim_plant_humidity(const sim_plant_t *plant)
+{
+    return 100.0 * plant->vapour / sim_plant_saturation(plant->temp);
+}
@@ -0,0 +1,61 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _SIM_PLANT_H_
+#define _SIM_PLANT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/** Actuator outputs driving the plant */
+typedef struct
+{
+    bool exhaust;
+    bool heater;
+    bool light;
+    bool recirc;
+} sim_actuators_t;
+
+/**
+ * Lumped model of a grow tent, one well mixed air volume with plants.
+ * Heat: heater, light and recirculation fan against the wall losses and the exhaust air flow.
+ * Water vapour: transpiration against leakage and exhaust to ambient air.
+ * CO2: uptake under light and respiration in the dark against leakage and exhaust.
+ */
+typedef struct
+{
+    /** temperature [K] */
+    double temp;
+    /** absolute humidity [g/m3] */
+    double vapour;
+    /** CO2 concentration [ppm] */
+    double co2;
+    /** ambient temperature [K] */
+    double ambient_temp;
+    /** plant growth 0..1, scales transpiration and CO2 exchange */
+    double growth;
+} sim_plant_t;
+
+/** Electrical power of the actuators [W] */
+#define SIM_PLANT_EXHAUST_POWER 30.0
+#define SIM_PLANT_HEATER_POWER 250.0
+#define SIM_PLANT_LIGHT_POWER 240.0
+#define SIM_PLANT_RECIRC_POWER 15.0
+
+/** Start at ambient conditions. */
+void sim_plant_initialize(sim_plant_t *plant);
+/**
+ * Advance plant dt seconds with constant actuators.
+ * @param time_of_day seconds after midnight, for the ambient temperature.
+ */
+void sim_plant_step(sim_plant_t *plant, const sim_actuators_t *actuators, double dt, double time_of_day);
+/** @return relative humidity [%] */
+double sim_plant_humidity(const sim_plant_t *plant);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_PLANT_H_ */
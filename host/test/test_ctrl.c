@@ -0,0 +1,312 @@
+// The author disclaims copyright to this source code.
+
+#include <stdbool.h>
+
+#include "unity.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "pubsub.h"
+
+#include "model.h"
+#include "ctrl.h"
+
+#include "test_host.h"
+
+/** Time for the ctrl task to run all stages */
+#define TEST_CTRL_SETTLE pdMS_TO_TICKS(20)
+
+#define TEST_CTRL_HOUR (60 * 60)
+
+static void test_ctrl_settle()
+{
+    vTaskDelay(TEST_CTRL_SETTLE);
+}
+
+static bool test_ctrl_last_bool(pubsub_topic_t topic)
+{
+    bool value = false;
+    TEST_ASSERT_TRUE(pubsub_last_bool_h(topic, &value));
+    return value;
+}
+
+/**
+ * Automatic control, day 6:00-22:00, 25 and 18 degrees C, no minimum on and off time.
+ */
+static void test_ctrl_setup()
+{
+    MODEL_PUBLISH_INT(BEGIN_OF_DAY, 6 * TEST_CTRL_HOUR);
+    MODEL_PUBLISH_INT(BEGIN_OF_NIGHT, 22 * TEST_CTRL_HOUR);
+    MODEL_PUBLISH_FLOAT(TEMP_SV_DAY, 298.15f);
+    MODEL_PUBLISH_FLOAT(TEMP_SV_NIGHT, 291.15f);
+    MODEL_PUBLISH_FLOAT(HUM_SV_DAY, 80.0f);
+    MODEL_PUBLISH_FLOAT(HUM_SV_NIGHT, 80.0f);
+    MODEL_PUBLISH_FLOAT(CO2_SV_DAY, 1000.0f);
+    MODEL_PUBLISH_FLOAT(CO2_SV_NIGHT, 1000.0f);
+    MODEL_PUBLISH_FLOAT(HUM_PV, 70.0f);
+    MODEL_PUBLISH_FLOAT(CO2_PV, 500.0f);
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 293.15f);
+    MODEL_PUBLISH_INT(EXHAUST_MIN_ON, 0);
+    MODEL_PUBLISH_INT(EXHAUST_MIN_OFF, 0);
+    MODEL_PUBLISH_INT(HEATER_MIN_ON, 0);
+    MODEL_PUBLISH_INT(HEATER_MIN_OFF, 0);
+    MODEL_PUBLISH_INT(CONTROL_MODE, MODEL_CONTROL_MODE_AUTO);
+}
+
+static void test_ctrl_auto_day()
+{
+    pubsub_capacity_t before;
+    pubsub_get_capacity(&before);
+    model_initialize();
+    ctrl_initialize();
+    test_ctrl_setup();
+    MODEL_PUBLISH_INT(CURRENT_TIME, 12 * TEST_CTRL_HOUR);
+    test_ctrl_settle();
+
+    // the compile time capacity checks count what is registered and subscribed
+    pubsub_capacity_t after;
+    pubsub_get_capacity(&after);
+    TEST_ASSERT_EQUAL(MODEL_REGISTERED_TOPICS, after.topics_used - before.topics_used);
+    TEST_ASSERT_EQUAL(MODEL_REGISTERED_NAME_BYTES, after.names_used - before.names_used);
+    TEST_ASSERT_EQUAL(MODEL_ZONE_COUNT * CTRL_ZONE_SUBSCRIPTIONS, after.subscribers_used - before.subscribers_used);
+    TEST_ASSERT_EQUAL(MODEL_ZONE_COUNT * CTRL_ZONE_LATEST, after.latest_used - before.latest_used);
+
+    int64_t circadian;
+    MODEL_LAST_INT(CIRCADIAN, &circadian);
+    TEST_ASSERT_EQUAL(MODEL_CIRCADIAN_DAY, circadian);
+    float temp_sv;
+    MODEL_LAST_FLOAT(TEMP_SV, &temp_sv);
+    TEST_ASSERT_EQUAL_FLOAT(298.15f, temp_sv);
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_TEMP_LO_H));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_HEATER_H));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_LIGHT_H));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_RECIRC_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_EXHAUST_H));
+}
+
+static void test_ctrl_auto_night()
+{
+    MODEL_PUBLISH_INT(CURRENT_TIME, 23 * TEST_CTRL_HOUR);
+    test_ctrl_settle();
+
+    int64_t circadian;
+    MODEL_LAST_INT(CIRCADIAN, &circadian);
+    TEST_ASSERT_EQUAL(MODEL_CIRCADIAN_NIGHT, circadian);
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_TEMP_HI_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_LIGHT_H));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_EXHAUST_H));
+}
+
+static void test_ctrl_manual()
+{
+    MODEL_PUBLISH_INT(CONTROL_MODE, MODEL_CONTROL_MODE_MANUAL);
+    MODEL_PUBLISH_BOOL(HEATER_SV, true);
+    MODEL_PUBLISH_BOOL(LIGHT_SV, false);
+    test_ctrl_settle();
+
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_HEATER_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_LIGHT_H));
+}
+
+static void test_ctrl_off()
+{
+    MODEL_PUBLISH_INT(CONTROL_MODE, MODEL_CONTROL_MODE_OFF);
+    test_ctrl_settle();
+
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_LIGHT_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_EXHAUST_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_RECIRC_H));
+}
+
+/**
+ * Zone 2 in automatic control, zone 1 stays off.
+ * Zone 2 has no demands until the pv of all quantities is published.
+ */
+static void test_ctrl_zones()
+{
+    const pubsub_topic_t *zone = model_zone(1);
+    TEST_ASSERT_NOT_NULL(zone);
+    TEST_ASSERT_NULL(model_zone(MODEL_ZONE_COUNT));
+    TEST_ASSERT_EQUAL_STRING("zone2.temp.pv", pubsub_topic_name(zone[MODEL_TEMP_PV_ID]));
+    TEST_ASSERT_EQUAL(MODEL_CURRENT_TIME_H, zone[MODEL_CURRENT_TIME_ID]);
+
+    MODEL_ZONE_PUBLISH_INT(zone, BEGIN_OF_DAY, 6 * TEST_CTRL_HOUR);
+    MODEL_ZONE_PUBLISH_INT(zone, BEGIN_OF_NIGHT, 22 * TEST_CTRL_HOUR);
+    MODEL_ZONE_PUBLISH_FLOAT(zone, TEMP_SV_DAY, 298.15f);
+    MODEL_ZONE_PUBLISH_FLOAT(zone, TEMP_SV_NIGHT, 291.15f);
+    MODEL_ZONE_PUBLISH_INT(zone, HEATER_MIN_OFF, 0);
+    MODEL_ZONE_PUBLISH_INT(zone, CONTROL_MODE, MODEL_CONTROL_MODE_AUTO);
+    MODEL_PUBLISH_INT(CURRENT_TIME, 12 * TEST_CTRL_HOUR);
+    test_ctrl_settle();
+
+    // no pv, a pv read as 0 K would heat at full duty
+    float duty;
+    MODEL_ZONE_LAST_FLOAT(zone, HEATER_DUTY, &duty);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, duty);
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(zone[MODEL_TEMP_LO_ID]));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(zone[MODEL_HEATER_ID]));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(zone[MODEL_LIGHT_ID]));
+
+    // temperature only, indicated but still no demands
+    MODEL_ZONE_PUBLISH_FLOAT(zone, TEMP_PV, 293.15f);
+    test_ctrl_settle();
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(zone[MODEL_TEMP_LO_ID]));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(zone[MODEL_HEATER_ID]));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(zone[MODEL_LIGHT_ID]));
+
+    MODEL_ZONE_PUBLISH_FLOAT(zone, HUM_PV, 70.0f);
+    MODEL_ZONE_PUBLISH_FLOAT(zone, CO2_PV, 500.0f);
+    test_ctrl_settle();
+
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(zone[MODEL_TEMP_LO_ID]));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(zone[MODEL_HEATER_ID]));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(zone[MODEL_LIGHT_ID]));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_LIGHT_H));
+
+    // night in zone 2 only
+    MODEL_ZONE_PUBLISH_INT(zone, BEGIN_OF_NIGHT, 10 * TEST_CTRL_HOUR);
+    test_ctrl_settle();
+
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(zone[MODEL_LIGHT_ID]));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(zone[MODEL_TEMP_HI_ID]));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_TEMP_LO_H));
+}
+
+/**
+ * Temperature indicators in zone 1 with a band of 0.5 K around 25 degrees C.
+ */
+static void test_ctrl_hysteresis()
+{
+    ctrl_switch_stats_t before;
+    TEST_ASSERT_TRUE(ctrl_get_switch_stats(0, &before));
+    MODEL_PUBLISH_FLOAT(TEMP_BAND, 0.5f);
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 297.5f);
+    test_ctrl_settle();
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_TEMP_LO_H));
+
+    // lo until the setpoint
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 297.9f);
+    test_ctrl_settle();
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_TEMP_LO_H));
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 298.3f);
+    test_ctrl_settle();
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_TEMP_LO_H));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_TEMP_HI_H));
+
+    // crossing back within the band
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 298.0f);
+    test_ctrl_settle();
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_TEMP_LO_H));
+
+    ctrl_switch_stats_t after;
+    TEST_ASSERT_TRUE(ctrl_get_switch_stats(0, &after));
+    TEST_ASSERT_EQUAL_UINT32(4, after.crossings[CTRL_QUANTITY_TEMP] - before.crossings[CTRL_QUANTITY_TEMP]);
+    TEST_ASSERT_EQUAL_UINT32(1,
+            after.indicator_switches[CTRL_QUANTITY_TEMP] - before.indicator_switches[CTRL_QUANTITY_TEMP]);
+    TEST_ASSERT_FALSE(ctrl_get_switch_stats(MODEL_ZONE_COUNT, &after));
+}
+
+/**
+ * Heater in zone 1 stays on for the minimum on time of 1 s after the demand ends.
+ */
+static void test_ctrl_min_on()
+{
+    ctrl_switch_stats_t before;
+    TEST_ASSERT_TRUE(ctrl_get_switch_stats(0, &before));
+    MODEL_PUBLISH_INT(HEATER_MIN_ON, 1);
+    MODEL_PUBLISH_INT(CONTROL_MODE, MODEL_CONTROL_MODE_AUTO);
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 297.0f);
+    test_ctrl_settle();
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_HEATER_H));
+
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 299.0f);
+    test_ctrl_settle();
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_DEMAND_H));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_HEATER_H));
+
+    // deadline, without input change
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_H));
+
+    ctrl_switch_stats_t after;
+    TEST_ASSERT_TRUE(ctrl_get_switch_stats(0, &after));
+    TEST_ASSERT_EQUAL_UINT32(2,
+            after.demand_switches[CTRL_OUTPUT_HEATER] - before.demand_switches[CTRL_OUTPUT_HEATER]);
+    TEST_ASSERT_EQUAL_UINT32(2,
+            after.output_switches[CTRL_OUTPUT_HEATER] - before.output_switches[CTRL_OUTPUT_HEATER]);
+}
+
+/**
+ * Heater in zone 1 with PID and a time proportioning window of 1 s, 1 K below the setpoint.
+ */
+static void test_ctrl_pid()
+{
+    MODEL_PUBLISH_INT(HEATER_MIN_ON, 0);
+    MODEL_PUBLISH_INT(HEATER_MIN_OFF, 0);
+    MODEL_PUBLISH_INT(HEATER_TI, 0);
+    MODEL_PUBLISH_INT(HEATER_WINDOW, 1);
+    MODEL_PUBLISH_FLOAT(HEATER_KP, 0.5f);
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 297.15f);
+    test_ctrl_settle();
+
+    float duty;
+    MODEL_LAST_FLOAT(HEATER_DUTY, &duty);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, duty);
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_HEATER_H));
+
+    // off for the second half of the window, on again in the next window
+    vTaskDelay(pdMS_TO_TICKS(700));
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_H));
+    vTaskDelay(pdMS_TO_TICKS(500));
+    TEST_ASSERT_TRUE(test_ctrl_last_bool(MODEL_HEATER_H));
+
+    // on pulse shorter than the minimum on time
+    MODEL_PUBLISH_INT(HEATER_MIN_ON, 1);
+    test_ctrl_settle();
+    TEST_ASSERT_FALSE(test_ctrl_last_bool(MODEL_HEATER_DEMAND_H));
+
+    // a fast rise stops heating, the derivative fades while the measurement is held
+    MODEL_PUBLISH_INT(HEATER_TD, 1);
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 297.45f);
+    test_ctrl_settle();
+    MODEL_PUBLISH_FLOAT(TEMP_PV, 297.75f);
+    test_ctrl_settle();
+    MODEL_LAST_FLOAT(HEATER_DUTY, &duty);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, duty);
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    MODEL_LAST_FLOAT(HEATER_DUTY, &duty);
+    TEST_ASSERT_TRUE(duty > 0.0f);
+    MODEL_PUBLISH_INT(HEATER_TD, 0);
+}
+
+static void test_ctrl_stage_stats()
+{
+    TEST_ASSERT_EQUAL(7, ctrl_get_stage_count());
+    for (uint8_t index = 0; index < ctrl_get_stage_count(); index++) {
+        ctrl_stage_stats_t stats;
+        TEST_ASSERT_TRUE(ctrl_get_stage_stats(index, &stats));
+        TEST_ASSERT_GREATER_THAN_UINT32(0, stats.runs);
+    }
+    ctrl_stage_stats_t stats;
+    TEST_ASSERT_FALSE(ctrl_get_stage_stats(ctrl_get_stage_count(), &stats));
+}
+
+/**
+ * Scenarios in order, each builds on the state of the previous one.
+ */
+void test_ctrl_run()
+{
+    RUN_TEST(test_ctrl_auto_day);
+    RUN_TEST(test_ctrl_auto_night);
+    RUN_TEST(test_ctrl_manual);
+    RUN_TEST(test_ctrl_off);
+    RUN_TEST(test_ctrl_zones);
+    RUN_TEST(test_ctrl_hysteresis);
+    RUN_TEST(test_ctrl_min_on);
+    RUN_TEST(test_ctrl_pid);
+    RUN_TEST(test_ctrl_stage_stats);
+}
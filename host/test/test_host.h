@@ -0,0 +1,10 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _TEST_HOST_H_
+#define _TEST_HOST_H_
+
+/** Test groups, run from the test task */
+void test_pubsub_run();
+void test_ctrl_run();
+
+#endif /* _TEST_HOST_H_ */
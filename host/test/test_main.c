@@ -0,0 +1,51 @@
+// The author disclaims copyright to this source code.
+
+#include <stdlib.h>
+
+#include "unity.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "binlog.h"
+#include "pubsub.h"
+
+#include "test_host.h"
+
+/** Test runner stack [words] */
+#define TEST_STACK_SIZE (8 * configMINIMAL_STACK_SIZE)
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+/**
+ * Run all tests as a task, the scheduler does not return.
+ */
+static void test_task(void *pvParameter)
+{
+    UNITY_BEGIN();
+    test_pubsub_run();
+    test_ctrl_run();
+    exit(UNITY_END());
+}
+
+int main(int argc, char **argv)
+{
+    esp_timer_get_time();
+    esp_log_level_set("*", getenv("TEST_LOG_INFO") != NULL ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+    binlog_initialize();
+    pubsub_initialize();
+
+    xTaskCreate(&test_task, "test", TEST_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+    vTaskStartScheduler();
+    return EXIT_FAILURE;
+}
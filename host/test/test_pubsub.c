@@ -0,0 +1,131 @@
+// The author disclaims copyright to this source code.
+
+#include <stdatomic.h>
+
+#include "unity.h"
+
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "pubsub.h"
+#include "pubsub_test.h"
+
+#include "test_host.h"
+
+/** Display queues that block each publish */
+#define TEST_DISPLAY_QUEUES 8
+/** Display queue full wait, per queue */
+#define TEST_DISPLAY_TIMEOUT pdMS_TO_TICKS(5)
+#define TEST_PUBLISHES 10
+/** Actuator latency bound, well below one display queue timeout [us] */
+#define TEST_ACTUATOR_BOUND_US 2000
+
+static const char *TOPIC_TEST_OUT = "test.priority.out";
+
+/** Publish time of the last actuator value [us] */
+static _Atomic int64_t test_published;
+
+/** Actuator receiver */
+typedef struct
+{
+    QueueHandle_t queue;
+    /** largest publish to receive latency [us] */
+    int64_t max_latency;
+    int received;
+} test_actuator_t;
+
+static void test_pubsub_self_test()
+{
+    TEST_ASSERT_TRUE(pubsub_test());
+}
+
+static void test_pubsub_stress_test()
+{
+    TEST_ASSERT_TRUE(pubsub_stress_test());
+}
+
+/**
+ * Actuator task, above the publisher as MCP23S17 and DO, ends after all publishes.
+ */
+static void test_actuator_task(void *pvParameter)
+{
+    test_actuator_t *actuator = (test_actuator_t*) pvParameter;
+    pubsub_message_t message;
+    while (actuator->received < TEST_PUBLISHES) {
+        if (pubsub_receive(actuator->queue, &message, portMAX_DELAY)) {
+            int64_t latency = esp_timer_get_time() - atomic_load(&test_published);
+            if (latency > actuator->max_latency) {
+                actuator->max_latency = latency;
+            }
+            actuator->received++;
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * Burst of display updates: display queues are full and block each publish,
+ * the high priority actuator still receives within the bound,
+ * an actuator subscribed with low priority waits behind the display queues.
+ */
+static void test_pubsub_priority()
+{
+    pubsub_register_topic(TOPIC_TEST_OUT, PUBSUB_TYPE_BOOLEAN, true);
+
+    // subscribed first, without priorities the last subscriber is delivered first
+    test_actuator_t high = { xQueueCreate(TEST_PUBLISHES, sizeof(pubsub_message_t)), 0, 0 };
+    pubsub_add_subscription_policy(high.queue, TOPIC_TEST_OUT, false, PUBSUB_DELIVERY_DROP_NEWEST, 0, PUBSUB_PRIORITY_HIGH);
+    test_actuator_t low = { xQueueCreate(TEST_PUBLISHES, sizeof(pubsub_message_t)), 0, 0 };
+    pubsub_add_subscription_policy(low.queue, TOPIC_TEST_OUT, false, PUBSUB_DELIVERY_DROP_NEWEST, 0, PUBSUB_PRIORITY_LOW);
+
+    QueueHandle_t displays[TEST_DISPLAY_QUEUES];
+    pubsub_message_t filler = { 0 };
+    for (int index = 0; index < TEST_DISPLAY_QUEUES; index++) {
+        displays[index] = xQueueCreate(1, sizeof(pubsub_message_t));
+        xQueueSendToBack(displays[index], &filler, 0);
+        pubsub_add_subscription_policy(displays[index], TOPIC_TEST_OUT, false, PUBSUB_DELIVERY_BLOCK, TEST_DISPLAY_TIMEOUT,
+                PUBSUB_PRIORITY_LOW);
+    }
+
+    UBaseType_t priority = uxTaskPriorityGet(NULL) + 1;
+    xTaskCreate(&test_actuator_task, "actuator", configMINIMAL_STACK_SIZE * 4, &high, priority, NULL);
+    xTaskCreate(&test_actuator_task, "actuator.low", configMINIMAL_STACK_SIZE * 4, &low, priority, NULL);
+
+    int64_t start = esp_timer_get_time();
+    for (int publish = 0; publish < TEST_PUBLISHES; publish++) {
+        atomic_store(&test_published, esp_timer_get_time());
+        pubsub_publish_bool(TOPIC_TEST_OUT, publish & 1);
+        vTaskDelay(1);
+    }
+    int64_t duration = esp_timer_get_time() - start;
+    for (int wait = 0; wait < 100 && (high.received < TEST_PUBLISHES || low.received < TEST_PUBLISHES); wait++) {
+        vTaskDelay(1);
+    }
+
+    // publishes waited for the display queues (timeouts round to ticks)
+    TEST_ASSERT_GREATER_THAN_INT32(TEST_PUBLISHES * TEST_DISPLAY_QUEUES * TEST_DISPLAY_TIMEOUT * 1000 / 2, (int32_t) duration);
+    TEST_ASSERT_EQUAL(TEST_PUBLISHES, high.received);
+    TEST_ASSERT_LESS_THAN_INT32(TEST_ACTUATOR_BOUND_US, (int32_t) high.max_latency);
+    TEST_ASSERT_EQUAL(TEST_PUBLISHES, low.received);
+    TEST_ASSERT_GREATER_THAN_INT32(TEST_ACTUATOR_BOUND_US, (int32_t) low.max_latency);
+
+    pubsub_remove_subscription(high.queue, TOPIC_TEST_OUT);
+    pubsub_remove_subscription(low.queue, TOPIC_TEST_OUT);
+    vQueueDelete(high.queue);
+    vQueueDelete(low.queue);
+    for (int index = 0; index < TEST_DISPLAY_QUEUES; index++) {
+        pubsub_remove_subscription(displays[index], TOPIC_TEST_OUT);
+        vQueueDelete(displays[index]);
+    }
+    pubsub_unregister_topic(TOPIC_TEST_OUT);
+}
+
+void test_pubsub_run()
+{
+    RUN_TEST(test_pubsub_self_test);
+    RUN_TEST(test_pubsub_stress_test);
+    RUN_TEST(test_pubsub_priority);
+}
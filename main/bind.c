@@ -1,9 +1,11 @@
 // The author disclaims copyright to this source code.
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "esp_log.h"
 
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 #include "freertos/task.h"
 
 #include "pubsub.h"
@@ -16,92 +18,140 @@
 
 static const char *TAG = "bind";
 
+/** display frame, changes are applied at most once per frame */
+#define BIND_FRAME_TICKS pdMS_TO_TICKS(LV_DISP_DEF_REFR_PERIOD)
+
+/** notification bits, set by pubsub when a bound topic changes */
+#define BIND_NOTIFY_TOOLBAR (1 << 0)
+#define BIND_NOTIFY_CONTROL (1 << 1)
+#define BIND_NOTIFY_SETTINGS (1 << 2)
+
+/** latest value subscriber */
+static pubsub_latest_t *latest;
+
 /** toolbar exhaust indicator */
-static QueueHandle_t exhaust;
+static uint32_t exhaust;
 /** toolbar heater indicator */
-static QueueHandle_t heater;
+static uint32_t heater;
 /** toolbar light indicator */
-static QueueHandle_t light;
+static uint32_t light;
 /** toolbar recirculation indicator */
-static QueueHandle_t recirc;
+static uint32_t recirc;
 /** toolbar circadian indicator */
-static QueueHandle_t circadian;
+static uint32_t circadian;
 /** toolbar control mode indicator */
-static QueueHandle_t control_mode;
+static uint32_t control_mode;
 /** toolbar current time indicator */
-static QueueHandle_t current_time;
+static uint32_t current_time;
 
-static void bind_task(void *pvParameter)
+/**
+ * Apply toolbar changes, called with hmi semaphore taken.
+ */
+static void bind_apply()
 {
-    pubsub_message_t message;
-    while (true) {
-        if (xQueueReceive(exhaust, &message, 0)) {
-            hmi_set_exhaust(message.boolean_val);
-        }
-        if (xQueueReceive(heater, &message, 0)) {
-            hmi_set_heater(message.boolean_val);
-        }
-        if (xQueueReceive(light, &message, 0)) {
-            hmi_set_light(message.boolean_val);
-        }
-        if (xQueueReceive(recirc, &message, 0)) {
-            hmi_set_recirc(message.boolean_val);
-        }
-        if (xQueueReceive(circadian, &message, 0)) {
-            model_circadian_t circadian = (model_circadian_t) message.int_val;
-            hmi_set_circadian(circadian);
-        }
-        if (xQueueReceive(control_mode, &message, 0)) {
-            model_control_mode_t mode = (model_control_mode_t) message.int_val;
-            if (mode == MODEL_CONTROL_MODE_OFF) {
-                hmi_set_control_mode(HMI_CONTROL_MODE_OFF);
-            } else if (mode == MODEL_CONTROL_MODE_MANUAL) {
-                hmi_set_control_mode(HMI_CONTROL_MODE_MANUAL);
-            } else if (mode == MODEL_CONTROL_MODE_AUTO) {
-                hmi_set_control_mode(HMI_CONTROL_MODE_AUTO);
-            }
-        }
-        if (xQueueReceive(current_time, &message, 0)) {
-            hmi_set_current_time(message.int_val);
+    uint32_t changes = pubsub_latest_changes(latest);
+    bool bool_val;
+    int64_t int_val;
+    if (changes & exhaust) {
+        MODEL_LAST_BOOL(EXHAUST, &bool_val);
+        hmi_set_exhaust(bool_val);
+    }
+    if (changes & heater) {
+        MODEL_LAST_BOOL(HEATER, &bool_val);
+        hmi_set_heater(bool_val);
+    }
+    if (changes & light) {
+        MODEL_LAST_BOOL(LIGHT, &bool_val);
+        hmi_set_light(bool_val);
+    }
+    if (changes & recirc) {
+        MODEL_LAST_BOOL(RECIRC, &bool_val);
+        hmi_set_recirc(bool_val);
+    }
+    if (changes & circadian) {
+        MODEL_LAST_INT(CIRCADIAN, &int_val);
+        model_circadian_t circadian = (model_circadian_t) int_val;
+        hmi_set_circadian(circadian);
+    }
+    if (changes & control_mode) {
+        MODEL_LAST_INT(CONTROL_MODE, &int_val);
+        model_control_mode_t mode = (model_control_mode_t) int_val;
+        if (mode == MODEL_CONTROL_MODE_OFF) {
+            hmi_set_control_mode(HMI_CONTROL_MODE_OFF);
+        } else if (mode == MODEL_CONTROL_MODE_MANUAL) {
+            hmi_set_control_mode(HMI_CONTROL_MODE_MANUAL);
+        } else if (mode == MODEL_CONTROL_MODE_AUTO) {
+            hmi_set_control_mode(HMI_CONTROL_MODE_AUTO);
         }
-
-        bind_control_task();
-        bind_settings_task();
-
-        vTaskDelay(1);
-    };
+    }
+    if (changes & current_time) {
+        MODEL_LAST_INT(CURRENT_TIME, &int_val);
+        hmi_set_current_time(int_val);
+    }
 }
 
-static void bind_subscribe()
+static void bind_subscribe(TaskHandle_t task, uint32_t notify_bits)
 {
-    exhaust = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(exhaust, MODEL_EXHAUST, true);
-
-    heater = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(heater, MODEL_HEATER, true);
-
-    light = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(light, MODEL_LIGHT, true);
-
-    recirc = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(recirc, MODEL_RECIRC, true);
-
-    circadian = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(circadian, MODEL_CIRCADIAN, true);
+    latest = pubsub_latest_create(task, notify_bits);
+    // display, notified after actuators
+    pubsub_latest_set_priority(latest, PUBSUB_PRIORITY_LOW);
+
+    exhaust = pubsub_add_latest_subscription(latest, MODEL_EXHAUST_H);
+    heater = pubsub_add_latest_subscription(latest, MODEL_HEATER_H);
+    light = pubsub_add_latest_subscription(latest, MODEL_LIGHT_H);
+    recirc = pubsub_add_latest_subscription(latest, MODEL_RECIRC_H);
+    circadian = pubsub_add_latest_subscription(latest, MODEL_CIRCADIAN_H);
+    control_mode = pubsub_add_latest_subscription(latest, MODEL_CONTROL_MODE_H);
+    current_time = pubsub_add_latest_subscription(latest, MODEL_CURRENT_TIME_H);
+}
 
-    control_mode = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(control_mode, MODEL_CONTROL_MODE, true);
+static void bind_task(void *pvParameter)
+{
+    // subscribe from the task itself, pubsub notifies this task
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    bind_subscribe(task, BIND_NOTIFY_TOOLBAR);
+    bind_control_subscribe(task, BIND_NOTIFY_CONTROL);
+    bind_settings_subscribe(task, BIND_NOTIFY_SETTINGS);
 
-    current_time = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(current_time, MODEL_CURRENT_TIME, true);
+    TickType_t last_frame = xTaskGetTickCount() - BIND_FRAME_TICKS;
+    while (true) {
+        // sleep until a bound topic changed
+        uint32_t notified = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &notified, portMAX_DELAY);
+
+        // collect changes until the next frame
+        TickType_t elapsed = xTaskGetTickCount() - last_frame;
+        if (elapsed < BIND_FRAME_TICKS) {
+            vTaskDelay(BIND_FRAME_TICKS - elapsed);
+        }
+        uint32_t collected = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &collected, 0);
+        notified |= collected;
+        last_frame = xTaskGetTickCount();
+
+        // apply all changes at once
+        if (hmi_semaphore_take("bind_task")) {
+            if (notified & BIND_NOTIFY_TOOLBAR) {
+                bind_apply();
+            }
+            if (notified & BIND_NOTIFY_CONTROL) {
+                bind_control_apply();
+            }
+            if (notified & BIND_NOTIFY_SETTINGS) {
+                bind_settings_apply();
+            }
+            hmi_semaphore_give();
+        } else {
+            // retry next frame
+            xTaskNotify(task, notified, eSetBits);
+        }
+    };
 }
 
 void bind_initialize()
 {
     ESP_LOGD(TAG, "bind_initialize");
 
-    bind_subscribe();
-
     bind_control_initialize();
     bind_settings_initialize();
 
@@ -7,7 +7,9 @@
 extern "C" {
 #endif
 
-#define BIND_QUEUE_DEPTH 10
+/** pubsub capacity of bind_initialize: latest value subscribers and their subscriptions */
+#define BIND_LATEST 3
+#define BIND_SUBSCRIPTIONS 33
 
 void bind_initialize();
 
@@ -7,8 +7,15 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 void bind_control_initialize();
-void bind_control_task();
+void bind_control_subscribe(TaskHandle_t task, uint32_t notify_bits);
+/** Apply changes to the hmi, called with hmi semaphore taken. */
+void bind_control_apply();
 
 #ifdef __cplusplus
 }
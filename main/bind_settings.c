@@ -4,7 +4,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 #include "pubsub.h"
 
@@ -15,138 +14,137 @@
 
 static const char *TAG = "bind_settings";
 
+/** latest value subscriber */
+static pubsub_latest_t *latest;
+
 /** current time setting */
-static QueueHandle_t bind_current_time;
+static uint32_t bind_current_time;
 /** begin of day setting */
-static QueueHandle_t bind_begin_of_day;
+static uint32_t bind_begin_of_day;
 /** begin of night setting */
-static QueueHandle_t bind_begin_of_night;
+static uint32_t bind_begin_of_night;
 /** temperature during day setting */
-static QueueHandle_t bind_temp_day;
+static uint32_t bind_temp_day;
 /** temperature during night setting */
-static QueueHandle_t bind_temp_night;
+static uint32_t bind_temp_night;
 /** humidity during day setting */
-static QueueHandle_t bind_hum_day;
+static uint32_t bind_hum_day;
 /** humidity during night setting */
-static QueueHandle_t bind_hum_night;
+static uint32_t bind_hum_night;
 /** co2 during day setting */
-static QueueHandle_t bind_co2_day;
+static uint32_t bind_co2_day;
 /** co2 during night setting */
-static QueueHandle_t bind_co2_night;
+static uint32_t bind_co2_night;
 
-void bind_settings_task()
+void bind_settings_apply()
 {
-    pubsub_message_t message;
-    if (xQueueReceive(bind_current_time, &message, 0)) {
-        hmi_settings_set_current_time(message.int_val);
+    uint32_t changes = pubsub_latest_changes(latest);
+    int64_t int_val;
+    float float_val;
+    if (changes & bind_current_time) {
+        MODEL_LAST_INT(CURRENT_TIME, &int_val);
+        hmi_settings_set_current_time(int_val);
     }
-    if (xQueueReceive(bind_begin_of_day, &message, 0)) {
-        hmi_settings_set_begin_of_day(message.int_val);
+    if (changes & bind_begin_of_day) {
+        MODEL_LAST_INT(BEGIN_OF_DAY, &int_val);
+        hmi_settings_set_begin_of_day(int_val);
     }
-    if (xQueueReceive(bind_begin_of_night, &message, 0)) {
-        hmi_settings_set_begin_of_night(message.int_val);
+    if (changes & bind_begin_of_night) {
+        MODEL_LAST_INT(BEGIN_OF_NIGHT, &int_val);
+        hmi_settings_set_begin_of_night(int_val);
     }
-    if (xQueueReceive(bind_temp_day, &message, 0)) {
-        hmi_settings_set_temp_day(message.double_val);
+    if (changes & bind_temp_day) {
+        MODEL_LAST_FLOAT(TEMP_SV_DAY, &float_val);
+        hmi_settings_set_temp_day(float_val);
     }
-    if (xQueueReceive(bind_temp_night, &message, 0)) {
-        hmi_settings_set_temp_night(message.double_val);
+    if (changes & bind_temp_night) {
+        MODEL_LAST_FLOAT(TEMP_SV_NIGHT, &float_val);
+        hmi_settings_set_temp_night(float_val);
     }
-    if (xQueueReceive(bind_hum_day, &message, 0)) {
-        hmi_settings_set_hum_day(message.double_val);
+    if (changes & bind_hum_day) {
+        MODEL_LAST_FLOAT(HUM_SV_DAY, &float_val);
+        hmi_settings_set_hum_day(float_val);
     }
-    if (xQueueReceive(bind_hum_night, &message, 0)) {
-        hmi_settings_set_hum_night(message.double_val);
+    if (changes & bind_hum_night) {
+        MODEL_LAST_FLOAT(HUM_SV_NIGHT, &float_val);
+        hmi_settings_set_hum_night(float_val);
     }
-    if (xQueueReceive(bind_co2_day, &message, 0)) {
-        hmi_settings_set_co2_day(message.double_val);
+    if (changes & bind_co2_day) {
+        MODEL_LAST_FLOAT(CO2_SV_DAY, &float_val);
+        hmi_settings_set_co2_day(float_val);
     }
-    if (xQueueReceive(bind_co2_night, &message, 0)) {
-        hmi_settings_set_co2_night(message.double_val);
+    if (changes & bind_co2_night) {
+        MODEL_LAST_FLOAT(CO2_SV_NIGHT, &float_val);
+        hmi_settings_set_co2_night(float_val);
     }
 }
 
-static void bind_settings_subscribe()
+void bind_settings_subscribe(TaskHandle_t task, uint32_t notify_bits)
 {
-    bind_current_time = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_current_time, MODEL_CURRENT_TIME, true);
-
-    bind_begin_of_day = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_begin_of_day, MODEL_BEGIN_OF_DAY, true);
-
-    bind_begin_of_night = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_begin_of_night, MODEL_BEGIN_OF_NIGHT, true);
-
-    bind_temp_day = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_temp_day, MODEL_TEMP_SV_DAY, true);
-
-    bind_temp_night = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_temp_night, MODEL_TEMP_SV_NIGHT, true);
-
-    bind_hum_day = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_hum_day, MODEL_HUM_SV_DAY, true);
-
-    bind_hum_night = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_hum_night, MODEL_HUM_SV_NIGHT, true);
-
-    bind_co2_day = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_co2_day, MODEL_CO2_SV_DAY, true);
-
-    bind_co2_night = xQueueCreate(BIND_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(bind_co2_night, MODEL_CO2_SV_NIGHT, true);
+    latest = pubsub_latest_create(task, notify_bits);
+    // display, notified after actuators
+    pubsub_latest_set_priority(latest, PUBSUB_PRIORITY_LOW);
+
+    bind_current_time = pubsub_add_latest_subscription(latest, MODEL_CURRENT_TIME_H);
+    bind_begin_of_day = pubsub_add_latest_subscription(latest, MODEL_BEGIN_OF_DAY_H);
+    bind_begin_of_night = pubsub_add_latest_subscription(latest, MODEL_BEGIN_OF_NIGHT_H);
+    bind_temp_day = pubsub_add_latest_subscription(latest, MODEL_TEMP_SV_DAY_H);
+    bind_temp_night = pubsub_add_latest_subscription(latest, MODEL_TEMP_SV_NIGHT_H);
+    bind_hum_day = pubsub_add_latest_subscription(latest, MODEL_HUM_SV_DAY_H);
+    bind_hum_night = pubsub_add_latest_subscription(latest, MODEL_HUM_SV_NIGHT_H);
+    bind_co2_day = pubsub_add_latest_subscription(latest, MODEL_CO2_SV_DAY_H);
+    bind_co2_night = pubsub_add_latest_subscription(latest, MODEL_CO2_SV_NIGHT_H);
 }
 
 static void bind_settings_current_time_callback(time_t time)
 {
-    pubsub_publish_int(MODEL_CURRENT_TIME, time);
+    MODEL_PUBLISH_INT(CURRENT_TIME, time);
 }
 
 static void bind_settings_begin_of_day_callback(time_t time)
 {
-    pubsub_publish_int(MODEL_BEGIN_OF_DAY, time);
+    MODEL_PUBLISH_INT(BEGIN_OF_DAY, time);
 }
 
 static void bind_settings_begin_of_night_callback(time_t time)
 {
-    pubsub_publish_int(MODEL_BEGIN_OF_NIGHT, time);
+    MODEL_PUBLISH_INT(BEGIN_OF_NIGHT, time);
 }
 
-static void bind_settings_temp_day_callback(double value)
+static void bind_settings_temp_day_callback(float value)
 {
-    pubsub_publish_double(MODEL_TEMP_SV_DAY, value);
+    MODEL_PUBLISH_FLOAT(TEMP_SV_DAY, value);
 }
 
-static void bind_settings_temp_night_callback(double value)
+static void bind_settings_temp_night_callback(float value)
 {
-    pubsub_publish_double(MODEL_TEMP_SV_NIGHT, value);
+    MODEL_PUBLISH_FLOAT(TEMP_SV_NIGHT, value);
 }
 
-static void bind_settings_hum_day_callback(double value)
+static void bind_settings_hum_day_callback(float value)
 {
-    pubsub_publish_double(MODEL_HUM_SV_DAY, value);
+    MODEL_PUBLISH_FLOAT(HUM_SV_DAY, value);
 }
 
-static void bind_settings_hum_night_callback(double value)
+static void bind_settings_hum_night_callback(float value)
 {
-    pubsub_publish_double(MODEL_HUM_SV_NIGHT, value);
+    MODEL_PUBLISH_FLOAT(HUM_SV_NIGHT, value);
 }
 
-static void bind_settings_co2_day_callback(double value)
+static void bind_settings_co2_day_callback(float value)
 {
-    pubsub_publish_double(MODEL_CO2_SV_DAY, value);
+    MODEL_PUBLISH_FLOAT(CO2_SV_DAY, value);
 }
 
-static void bind_settings_co2_night_callback(double value)
+static void bind_settings_co2_night_callback(float value)
 {
-    pubsub_publish_double(MODEL_CO2_SV_NIGHT, value);
+    MODEL_PUBLISH_FLOAT(CO2_SV_NIGHT, value);
 }
 
 void bind_settings_initialize()
 {
     ESP_LOGD(TAG, "bind_settings_initialize");
 
-    bind_settings_subscribe();
-
     hmi_settings_set_current_time_callback(&bind_settings_current_time_callback);
     hmi_settings_set_begin_of_day_callback(&bind_settings_begin_of_day_callback);
     hmi_settings_set_begin_of_night_callback(&bind_settings_begin_of_night_callback);
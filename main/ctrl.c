@@ -1,51 +1,397 @@
 // The author disclaims copyright to this source code.
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "esp_log.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
+#include "clock.h"
 #include "pubsub.h"
 
 #include "model.h"
 
-#include "ctrl_circadian.h"
-#include "ctrl_day_night.h"
-#include "ctrl_auto.h"
-#include "ctrl_manual.h"
-#include "ctrl_off.h"
+#include "ctrl_zone.h"
 
 static const char *TAG = "ctrl";
 
+/** notification bit of zone, set by pubsub when a stage input of the zone changes */
+#define CTRL_NOTIFY_ZONE(zone) (1 << (zone))
+
+/** default hysteresis bands [ppm, %, K] */
+#define CTRL_DEFAULT_CO2_BAND 50.0f
+#define CTRL_DEFAULT_HUM_BAND 2.0f
+#define CTRL_DEFAULT_TEMP_BAND 0.3f
+/** default minimum on and off time of relays switching motors and heaters [s] */
+#define CTRL_DEFAULT_EXHAUST_MIN_TIME 60
+#define CTRL_DEFAULT_HEATER_MIN_TIME 60
+/** default heater PID tuning [1/K, s] and time proportioning window [s] */
+#define CTRL_DEFAULT_HEATER_KP 0.5f
+#define CTRL_DEFAULT_HEATER_TI 1800
+#define CTRL_DEFAULT_HEATER_TD 0
+#define CTRL_DEFAULT_HEATER_WINDOW 600
+
+/** wakeup statistics interval [us] */
+#define CTRL_WAKEUP_INTERVAL CLOCK_MS(60 * 1000)
+
+/** stages, in declaration order */
+static const ctrl_stage_t *const ctrl_stages[] = {
+    &ctrl_circadian_stage,
+    &ctrl_day_night_stage,
+    &ctrl_auto_stage,
+    &ctrl_heater_stage,
+    &ctrl_manual_stage,
+    &ctrl_off_stage,
+    &ctrl_output_stage
+};
+
+_Static_assert(sizeof(ctrl_stages) / sizeof(ctrl_stages[0]) == CTRL_STAGE_COUNT, "CTRL_STAGE_COUNT is the number of stages");
+_Static_assert(MODEL_ZONE_COUNT <= 32, "a notification bit per zone");
+_Static_assert(CTRL_ZONE_LATEST == CTRL_STAGE_COUNT, "CTRL_ZONE_LATEST is a latest value subscriber per stage");
+
+/** stage state, shared by all zones */
+typedef struct
+{
+    const ctrl_stage_t *stage;
+    ctrl_stage_stats_t stats;
+} ctrl_stage_state_t;
+
+/** stages, in run order */
+static ctrl_stage_state_t ctrl_order[CTRL_STAGE_COUNT];
+
+/** zones, stage state per zone */
+static ctrl_zone_t ctrl_zones[MODEL_ZONE_COUNT];
+
+/** wakeups during the previous interval */
+static volatile uint32_t ctrl_wakeups_per_minute;
+
+/**
+ * @return true if stage from publishes an input of stage to.
+ */
+static bool ctrl_depends(const ctrl_stage_t *from, const ctrl_stage_t *to)
+{
+    for (int output = 0; output < from->output_count; output++) {
+        for (int input = 0; input < to->input_count; input++) {
+            if (from->outputs[output] == to->inputs[input]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Order stages so that each stage runs after the stages it depends on (Kahn).
+ * Ties keep declaration order. On a cycle the remaining stages keep declaration order.
+ */
+static void ctrl_sort_stages()
+{
+    uint8_t in_degree[CTRL_STAGE_COUNT] = { 0 };
+    bool done[CTRL_STAGE_COUNT] = { false };
+    for (int from = 0; from < CTRL_STAGE_COUNT; from++) {
+        for (int to = 0; to < CTRL_STAGE_COUNT; to++) {
+            if (from != to && ctrl_depends(ctrl_stages[from], ctrl_stages[to])) {
+                in_degree[to]++;
+            }
+        }
+    }
+    int count = 0;
+    while (count < CTRL_STAGE_COUNT) {
+        // first ready stage, or first remaining stage on a cycle
+        int next = -1;
+        for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+            if (!done[index] && in_degree[index] == 0) {
+                next = index;
+                break;
+            }
+        }
+        if (next < 0) {
+            for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+                if (!done[index]) {
+                    ESP_LOGE(TAG, "ctrl_sort_stages, cycle at stage:%s", ctrl_stages[index]->name);
+                    next = index;
+                    break;
+                }
+            }
+        }
+        done[next] = true;
+        ctrl_order[count++].stage = ctrl_stages[next];
+        for (int to = 0; to < CTRL_STAGE_COUNT; to++) {
+            if (!done[to] && to != next && ctrl_depends(ctrl_stages[next], ctrl_stages[to]) && in_degree[to] > 0) {
+                in_degree[to]--;
+            }
+        }
+    }
+}
+
+static void ctrl_subscribe_stages(TaskHandle_t task)
+{
+    int inputs = 0;
+    for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+        ctrl_stage_state_t *state = &ctrl_order[index];
+        inputs += state->stage->input_count;
+        ESP_LOGI(TAG, "ctrl_subscribe_stages, order:%d, stage:%s", index, state->stage->name);
+        state->stats.name = state->stage->name;
+        state->stats.runs = 0;
+        state->stats.max_latency = 0;
+    }
+    if (inputs != CTRL_ZONE_SUBSCRIPTIONS) {
+        ESP_LOGE(TAG, "ctrl_subscribe_stages, inputs:%d, CTRL_ZONE_SUBSCRIPTIONS:%d", inputs, CTRL_ZONE_SUBSCRIPTIONS);
+    }
+    for (int zone_index = 0; zone_index < MODEL_ZONE_COUNT; zone_index++) {
+        ctrl_zone_t *zone = &ctrl_zones[zone_index];
+        zone->zone = zone_index;
+        zone->topics = model_zone(zone_index);
+        for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+            const ctrl_stage_t *stage = ctrl_order[index].stage;
+            zone->latest[index] = pubsub_latest_create(task, CTRL_NOTIFY_ZONE(zone_index));
+            for (int input = 0; input < stage->input_count; input++) {
+                pubsub_add_latest_subscription(zone->latest[index], zone->topics[stage->inputs[input]]);
+            }
+        }
+    }
+}
+
+/**
+ * @return true if the deadline of stage of zone passed.
+ */
+static bool ctrl_stage_due(const ctrl_stage_t *stage, const ctrl_zone_t *zone, int64_t now)
+{
+    if (stage->deadline == NULL) {
+        return false;
+    }
+    int64_t deadline = stage->deadline(zone);
+    return deadline != 0 && deadline <= now;
+}
+
+/**
+ * Run all stages of zone with changed inputs or passed deadline in order.
+ * A change propagates through the whole pipeline in one pass.
+ */
+static void ctrl_run_stages(ctrl_zone_t *zone)
+{
+    int64_t origin = INT64_MAX;
+    for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+        ctrl_stage_state_t *state = &ctrl_order[index];
+        int64_t since = pubsub_latest_since(zone->latest[index]);
+        uint32_t changes = pubsub_latest_changes(zone->latest[index]);
+        int64_t now = clock_now();
+        if (changes || ctrl_stage_due(state->stage, zone, now)) {
+            // latency from the earliest publish that started this pass
+            if (since == 0) {
+                since = now;
+            }
+            if (since < origin) {
+                origin = since;
+            }
+            state->stage->run(zone, changes);
+            state->stats.runs++;
+            int64_t latency = clock_now() - origin;
+            if (latency > state->stats.max_latency) {
+                state->stats.max_latency = latency;
+            }
+        }
+    }
+}
+
+/**
+ * @return notification bits of zones with changed stage inputs or passed deadline.
+ */
+static uint32_t ctrl_pending_zones()
+{
+    uint32_t pending = 0;
+    int64_t now = clock_now();
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+            if (pubsub_latest_since(ctrl_zones[zone].latest[index]) != 0
+                    || ctrl_stage_due(ctrl_order[index].stage, &ctrl_zones[zone], now)) {
+                pending |= CTRL_NOTIFY_ZONE(zone);
+                break;
+            }
+        }
+    }
+    return pending;
+}
+
+/**
+ * @return earliest stage deadline of all zones [us], 0 if none.
+ */
+static int64_t ctrl_next_deadline()
+{
+    int64_t next = 0;
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+            const ctrl_stage_t *stage = ctrl_order[index].stage;
+            int64_t deadline = stage->deadline != NULL ? stage->deadline(&ctrl_zones[zone]) : 0;
+            if (deadline != 0 && (next == 0 || deadline < next)) {
+                next = deadline;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * Run stages of zones with notification bit in notified.
+ */
+static void ctrl_run_zones(uint32_t notified)
+{
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        if (notified & CTRL_NOTIFY_ZONE(zone)) {
+            ctrl_run_stages(&ctrl_zones[zone]);
+        }
+    }
+}
+
+static void ctrl_log_stats(uint32_t wakeups)
+{
+    ESP_LOGI(TAG, "ctrl_task, wakeups per minute:%u, polling:%u", wakeups, (unsigned) CTRL_POLLING_WAKEUPS_PER_MINUTE);
+    for (int index = 0; index < CTRL_STAGE_COUNT; index++) {
+        ctrl_stage_stats_t *stats = &ctrl_order[index].stats;
+        ESP_LOGI(TAG, "ctrl_task, stage:%s, runs:%u, max latency:%lldus", stats->name, stats->runs, stats->max_latency);
+    }
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        const ctrl_switch_stats_t *switches = &ctrl_zones[zone].switches;
+        ESP_LOGI(TAG, "ctrl_task, zone:%d, crossings co2:%u hum:%u temp:%u, indicator switches co2:%u hum:%u temp:%u",
+                zone + 1, switches->crossings[CTRL_QUANTITY_CO2], switches->crossings[CTRL_QUANTITY_HUM],
+                switches->crossings[CTRL_QUANTITY_TEMP], switches->indicator_switches[CTRL_QUANTITY_CO2],
+                switches->indicator_switches[CTRL_QUANTITY_HUM], switches->indicator_switches[CTRL_QUANTITY_TEMP]);
+        ESP_LOGI(TAG, "ctrl_task, zone:%d, demand/output switches exhaust:%u/%u heater:%u/%u light:%u/%u recirc:%u/%u",
+                zone + 1, switches->demand_switches[CTRL_OUTPUT_EXHAUST], switches->output_switches[CTRL_OUTPUT_EXHAUST],
+                switches->demand_switches[CTRL_OUTPUT_HEATER], switches->output_switches[CTRL_OUTPUT_HEATER],
+                switches->demand_switches[CTRL_OUTPUT_LIGHT], switches->output_switches[CTRL_OUTPUT_LIGHT],
+                switches->demand_switches[CTRL_OUTPUT_RECIRC], switches->output_switches[CTRL_OUTPUT_RECIRC]);
+    }
+}
+
 static void ctrl_task(void *pvParameter)
 {
-    while (true) {
-        ctrl_circadian_task();
-        ctrl_day_night_task();
-        ctrl_auto_task();
-        ctrl_manual_task();
-        ctrl_off_task();
+    // subscribe from the task itself, pubsub notifies this task
+    ctrl_subscribe_stages(xTaskGetCurrentTaskHandle());
 
-        vTaskDelay(1);
+    uint32_t wakeups = 0;
+    int64_t interval_start = clock_now();
+    while (true) {
+        // sleep until an input changed, a stage deadline or held back publish passes or the wakeup interval ends
+        int64_t now = clock_now();
+        int64_t timeout = interval_start + CTRL_WAKEUP_INTERVAL - now;
+        int64_t deadline = ctrl_next_deadline();
+        if (deadline != 0 && deadline - now < timeout) {
+            timeout = deadline - now;
+        }
+        deadline = pubsub_forward_pending(now);
+        if (deadline != 0 && deadline - now < timeout) {
+            timeout = deadline - now;
+        }
+        uint32_t notified = 0;
+        if (clock_notify_wait(0, UINT32_MAX, &notified, timeout) != pdTRUE) {
+            notified = ctrl_pending_zones();
+        }
+        if (notified != 0) {
+            wakeups++;
+            // only zones with changed inputs or passed deadlines
+            while (notified != 0) {
+                ctrl_run_zones(notified);
+                // stages notified each other during the pass, already handled
+                xTaskNotifyWait(0, UINT32_MAX, NULL, 0);
+                notified = ctrl_pending_zones();
+            }
+        }
+        if (clock_now() - interval_start >= CTRL_WAKEUP_INTERVAL) {
+            ctrl_wakeups_per_minute = wakeups;
+            ctrl_log_stats(wakeups);
+            wakeups = 0;
+            interval_start = clock_now();
+        }
     };
 }
 
+uint32_t ctrl_get_wakeups_per_minute()
+{
+    return ctrl_wakeups_per_minute;
+}
+
+uint8_t ctrl_get_stage_count()
+{
+    return CTRL_STAGE_COUNT;
+}
+
+bool ctrl_get_stage_stats(uint8_t index, ctrl_stage_stats_t *stats)
+{
+    if (index >= CTRL_STAGE_COUNT) {
+        return false;
+    }
+    *stats = ctrl_order[index].stats;
+    return true;
+}
+
+bool ctrl_get_switch_stats(uint8_t zone, ctrl_switch_stats_t *stats)
+{
+    if (zone >= MODEL_ZONE_COUNT) {
+        return false;
+    }
+    *stats = ctrl_zones[zone].switches;
+    return true;
+}
+
+/**
+ * Publish defaults of hysteresis bands, minimum on and off times and heater tuning,
+ * before the stored settings (NVS) replace them.
+ */
+static void ctrl_publish_defaults()
+{
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        const pubsub_topic_t *topics = model_zone(zone);
+        MODEL_ZONE_PUBLISH_FLOAT(topics, CO2_BAND, CTRL_DEFAULT_CO2_BAND);
+        MODEL_ZONE_PUBLISH_FLOAT(topics, HUM_BAND, CTRL_DEFAULT_HUM_BAND);
+        MODEL_ZONE_PUBLISH_FLOAT(topics, TEMP_BAND, CTRL_DEFAULT_TEMP_BAND);
+        MODEL_ZONE_PUBLISH_INT(topics, EXHAUST_MIN_ON, CTRL_DEFAULT_EXHAUST_MIN_TIME);
+        MODEL_ZONE_PUBLISH_INT(topics, EXHAUST_MIN_OFF, CTRL_DEFAULT_EXHAUST_MIN_TIME);
+        MODEL_ZONE_PUBLISH_INT(topics, HEATER_MIN_ON, CTRL_DEFAULT_HEATER_MIN_TIME);
+        MODEL_ZONE_PUBLISH_INT(topics, HEATER_MIN_OFF, CTRL_DEFAULT_HEATER_MIN_TIME);
+        MODEL_ZONE_PUBLISH_INT(topics, LIGHT_MIN_ON, 0);
+        MODEL_ZONE_PUBLISH_INT(topics, LIGHT_MIN_OFF, 0);
+        MODEL_ZONE_PUBLISH_INT(topics, RECIRC_MIN_ON, 0);
+        MODEL_ZONE_PUBLISH_INT(topics, RECIRC_MIN_OFF, 0);
+        MODEL_ZONE_PUBLISH_FLOAT(topics, HEATER_KP, CTRL_DEFAULT_HEATER_KP);
+        MODEL_ZONE_PUBLISH_INT(topics, HEATER_TI, CTRL_DEFAULT_HEATER_TI);
+        MODEL_ZONE_PUBLISH_INT(topics, HEATER_TD, CTRL_DEFAULT_HEATER_TD);
+        MODEL_ZONE_PUBLISH_INT(topics, HEATER_WINDOW, CTRL_DEFAULT_HEATER_WINDOW);
+    }
+}
+
+void ctrl_initialize_stepped()
+{
+    ESP_LOGD(TAG, "ctrl_initialize_stepped, zones:%d", MODEL_ZONE_COUNT);
+
+    ctrl_publish_defaults();
+    ctrl_sort_stages();
+    // no task to notify, ctrl_step polls the change bits
+    ctrl_subscribe_stages(NULL);
+}
+
+void ctrl_step()
+{
+    pubsub_forward_pending(clock_now());
+    uint32_t pending = ctrl_pending_zones();
+    while (pending != 0) {
+        ctrl_run_zones(pending);
+        pending = ctrl_pending_zones();
+    }
+}
+
 void ctrl_initialize()
 {
-    ESP_LOGD(TAG, "ctrl_initialize");
+    ESP_LOGD(TAG, "ctrl_initialize, zones:%d", MODEL_ZONE_COUNT);
 
-    ctrl_circadian_initialize();
-    ctrl_day_night_initialize();
-    ctrl_auto_initialize();
-    ctrl_manual_initialize();
-    ctrl_off_initialize();
+    ctrl_publish_defaults();
+
+    ctrl_sort_stages();
 
     BaseType_t ret = xTaskCreate(&ctrl_task, TAG, 2048, NULL, (tskIDLE_PRIORITY + 1), NULL);
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "ctrl_initialize, failed to create task (FATAL)");
     }
 }
-
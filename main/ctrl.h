@@ -7,9 +7,95 @@
 extern "C" {
 #endif
 
-#define CTRL_QUEUE_DEPTH 10
+#include <stdint.h>
+
+#include "pubsub.h"
+
+#include "model.h"
+
+/**
+ * pubsub capacity of the ctrl task per zone: a latest value subscriber per stage
+ * and a subscription per stage input, checked by ctrl_initialize.
+ */
+#define CTRL_ZONE_LATEST 7
+#define CTRL_ZONE_SUBSCRIPTIONS 54
+
+/** Control zone, state of all stages of one zone (ctrl_zone.h) */
+typedef struct ctrl_zone ctrl_zone_t;
+
+/**
+ * Control pipeline stage.
+ * The scheduler subscribes the inputs of each zone and orders the stages so that
+ * a stage runs after all stages that publish its inputs.
+ */
+typedef struct
+{
+    const char *name;
+    /** input topics, a change of input i sets change bit (1 << i) */
+    const model_topic_id_t *inputs;
+    uint8_t input_count;
+    /** output topics */
+    const model_topic_id_t *outputs;
+    uint8_t output_count;
+    /** run stage of zone with change bits of changed inputs, no bits when only the deadline passed */
+    void (*run)(ctrl_zone_t *zone, uint32_t changes);
+    /** optional, time to run again without input change [us, clock_now], 0 if none */
+    int64_t (*deadline)(const ctrl_zone_t *zone);
+} ctrl_stage_t;
+
+/** Quantities with a hysteresis band */
+typedef enum
+{
+    CTRL_QUANTITY_CO2 = 0, CTRL_QUANTITY_HUM, CTRL_QUANTITY_TEMP, CTRL_QUANTITY_COUNT
+} ctrl_quantity_t;
+
+/** Actuator outputs with minimum on and off time */
+typedef enum
+{
+    CTRL_OUTPUT_EXHAUST = 0, CTRL_OUTPUT_HEATER, CTRL_OUTPUT_LIGHT, CTRL_OUTPUT_RECIRC, CTRL_OUTPUT_COUNT
+} ctrl_output_t;
+
+/**
+ * Switch statistics of a zone.
+ * Crossings vs indicator switches is the reduction by hysteresis,
+ * demand vs output switches the reduction by minimum on and off time.
+ */
+typedef struct
+{
+    /** measurement crossed the setpoint, the indicator switches without hysteresis */
+    uint32_t crossings[CTRL_QUANTITY_COUNT];
+    /** lo and hi indicator switches */
+    uint32_t indicator_switches[CTRL_QUANTITY_COUNT];
+    /** actuator demand switches of the control mode */
+    uint32_t demand_switches[CTRL_OUTPUT_COUNT];
+    /** actuator switches, each one relay cycle, a publish and a MCP23S17 write */
+    uint32_t output_switches[CTRL_OUTPUT_COUNT];
+} ctrl_switch_stats_t;
+
+/** Stage statistics */
+typedef struct
+{
+    const char *name;
+    /** number of runs */
+    uint32_t runs;
+    /** worst case time from input publish to end of this stage [us] */
+    int64_t max_latency;
+} ctrl_stage_stats_t;
 
 void ctrl_initialize();
+/** Simulation: prepare the stages without the ctrl task, ctrl_step runs them. */
+void ctrl_initialize_stepped();
+/** Simulation: run the stages of all zones with changed inputs or passed deadline, until none. */
+void ctrl_step();
+/** Wakeups per minute of the former vTaskDelay(1) polling loop, baseline for ctrl_get_wakeups_per_minute. */
+#define CTRL_POLLING_WAKEUPS_PER_MINUTE (configTICK_RATE_HZ * 60)
+/** Number of ctrl task wakeups during the previous minute. */
+uint32_t ctrl_get_wakeups_per_minute();
+uint8_t ctrl_get_stage_count();
+/** Statistics of stage in run order, all zones. */
+bool ctrl_get_stage_stats(uint8_t index, ctrl_stage_stats_t *stats);
+/** Switch statistics of zone. */
+bool ctrl_get_switch_stats(uint8_t zone, ctrl_switch_stats_t *stats);
 
 #ifdef __cplusplus
 }
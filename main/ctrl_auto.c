@@ -6,7 +6,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 #include "pubsub.h"
 
@@ -14,227 +13,179 @@
 
 #include "ctrl_auto.h"
 #include "ctrl.h"
-
-static const char *TAG = "ctrl_auto";
-
-/** circadian */
-static QueueHandle_t circadian_queue;
-static model_circadian_t circadian;
-
-/** control mode */
-static QueueHandle_t control_mode_queue;
-static model_control_mode_t control_mode;
-
-/** measurement co2 concentration */
-static QueueHandle_t co2_pv_queue;
-static double co2_pv;
-/** automatic control setpoint co2 concentration */
-static QueueHandle_t co2_sv_queue;
-static double co2_sv;
-static bool co2_lo;
-static bool co2_hi;
-
-/** measurement humidity */
-static QueueHandle_t hum_pv_queue;
-static double hum_pv;
-/** automatic control setpoint humidity */
-static QueueHandle_t hum_sv_queue;
-static double hum_sv;
-static bool hum_lo;
-static bool hum_hi;
-
-/** measurement temperature */
-static QueueHandle_t temp_pv_queue;
-static double temp_pv;
-/** automatic control setpoint temperature */
-static QueueHandle_t temp_sv_queue;
-static double temp_sv;
-static bool temp_lo;
-static bool temp_hi;
-
-static void ctrl_auto_set_co2_lo(bool value)
+#include "ctrl_hysteresis.h"
+#include "ctrl_zone.h"
+
+/** input change bits, in order of inputs */
+#define CTRL_AUTO_CIRCADIAN (1 << 0)
+#define CTRL_AUTO_CONTROL_MODE (1 << 1)
+/** per quantity, in order of ctrl_quantity_t */
+#define CTRL_AUTO_PV(quantity) (1 << (2 + 3 * (quantity)))
+#define CTRL_AUTO_SV(quantity) (1 << (3 + 3 * (quantity)))
+#define CTRL_AUTO_BAND(quantity) (1 << (4 + 3 * (quantity)))
+
+/** Topics of a quantity */
+typedef struct
 {
-    if (value != co2_lo) {
-        co2_lo = value;
-        pubsub_publish_bool(MODEL_CO2_LO, value);
-    }
-}
-
-static void ctrl_auto_set_co2_hi(bool value)
+    model_topic_id_t pv;
+    model_topic_id_t sv;
+    model_topic_id_t band;
+    model_topic_id_t lo;
+    model_topic_id_t hi;
+} ctrl_auto_topics_t;
+
+static const ctrl_auto_topics_t ctrl_auto_topics[CTRL_QUANTITY_COUNT] = {
+    [CTRL_QUANTITY_CO2] = { MODEL_CO2_PV_ID, MODEL_CO2_SV_ID, MODEL_CO2_BAND_ID, MODEL_CO2_LO_ID, MODEL_CO2_HI_ID },
+    [CTRL_QUANTITY_HUM] = { MODEL_HUM_PV_ID, MODEL_HUM_SV_ID, MODEL_HUM_BAND_ID, MODEL_HUM_LO_ID, MODEL_HUM_HI_ID },
+    [CTRL_QUANTITY_TEMP] = { MODEL_TEMP_PV_ID, MODEL_TEMP_SV_ID, MODEL_TEMP_BAND_ID, MODEL_TEMP_LO_ID, MODEL_TEMP_HI_ID }
+};
+
+static void ctrl_auto_light(ctrl_zone_t *zone)
 {
-    if (value != co2_hi) {
-        co2_hi = value;
-        pubsub_publish_bool(MODEL_CO2_HI, value);
-    }
+    bool light_on = (zone->automatic.circadian == MODEL_CIRCADIAN_DAY);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, LIGHT_DEMAND, light_on);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, LIGHT_SV, light_on);
 }
 
-static void ctrl_auto_set_hum_lo(bool value)
+static void ctrl_auto_exhaust(ctrl_zone_t *zone)
 {
-    if (value != hum_lo) {
-        hum_lo = value;
-        pubsub_publish_bool(MODEL_HUM_LO, value);
-    }
+    const ctrl_auto_quantity_t *quantities = zone->automatic.quantities;
+    bool exhaust_on = (quantities[CTRL_QUANTITY_TEMP].hi || quantities[CTRL_QUANTITY_HUM].hi
+            || quantities[CTRL_QUANTITY_CO2].hi);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, EXHAUST_DEMAND, exhaust_on);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, EXHAUST_SV, exhaust_on);
 }
 
-static void ctrl_auto_set_hum_hi(bool value)
+static void ctrl_auto_recirculation(ctrl_zone_t *zone)
 {
-    if (value != hum_hi) {
-        hum_hi = value;
-        pubsub_publish_bool(MODEL_HUM_HI, value);
-    }
+    bool recirc_on = (zone->automatic.circadian == MODEL_CIRCADIAN_DAY);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, RECIRC_DEMAND, recirc_on);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, RECIRC_SV, recirc_on);
 }
 
-static void ctrl_auto_set_temp_lo(bool value)
+static void ctrl_auto_control(ctrl_zone_t *zone)
 {
-    if (value != temp_lo) {
-        temp_lo = value;
-        pubsub_publish_bool(MODEL_TEMP_LO, value);
-    }
+    ctrl_auto_light(zone);
+    ctrl_auto_exhaust(zone);
+    ctrl_auto_recirculation(zone);
 }
 
-static void ctrl_auto_set_temp_hi(bool value)
+/**
+ * Update lo and hi indicators of quantity with hysteresis, publish changes.
+ */
+static void ctrl_auto_indicate(ctrl_zone_t *zone, ctrl_quantity_t index)
 {
-    if (value != temp_hi) {
-        temp_hi = value;
-        pubsub_publish_bool(MODEL_TEMP_HI, value);
+    ctrl_auto_quantity_t *quantity = &zone->automatic.quantities[index];
+    const ctrl_auto_topics_t *topics = &ctrl_auto_topics[index];
+    ctrl_switch_stats_t *switches = &zone->switches;
+
+    bool strict_lo = quantity->pv < quantity->sv;
+    bool strict_hi = quantity->pv > quantity->sv;
+    switches->crossings[index] += (strict_lo != quantity->strict_lo) + (strict_hi != quantity->strict_hi);
+    quantity->strict_lo = strict_lo;
+    quantity->strict_hi = strict_hi;
+
+    bool lo = ctrl_hysteresis_lo(quantity->lo, quantity->pv, quantity->sv, quantity->band);
+    if (lo != quantity->lo) {
+        quantity->lo = lo;
+        switches->indicator_switches[index]++;
+        pubsub_publish_bool_h(zone->topics[topics->lo], lo);
+    }
+    bool hi = ctrl_hysteresis_hi(quantity->hi, quantity->pv, quantity->sv, quantity->band);
+    if (hi != quantity->hi) {
+        quantity->hi = hi;
+        switches->indicator_switches[index]++;
+        pubsub_publish_bool_h(zone->topics[topics->hi], hi);
     }
 }
 
-static void ctrl_auto_light()
-{
-    bool light_on = (circadian == MODEL_CIRCADIAN_DAY);
-    pubsub_publish_bool(MODEL_LIGHT, light_on);
-    pubsub_publish_bool(MODEL_LIGHT_SV, light_on);
-}
-
-static void ctrl_auto_exhaust()
-{
-    bool exhaust_on = (temp_hi || hum_hi || co2_hi);
-    pubsub_publish_bool(MODEL_EXHAUST, exhaust_on);
-    pubsub_publish_bool(MODEL_EXHAUST_SV, exhaust_on);
-}
-
-static void ctrl_auto_recirculation()
-{
-    bool recirc_on = (circadian == MODEL_CIRCADIAN_DAY);
-    pubsub_publish_bool(MODEL_RECIRC, recirc_on);
-    pubsub_publish_bool(MODEL_RECIRC_SV, recirc_on);
-}
-
-static void ctrl_auto_heater()
+static void ctrl_auto_run(ctrl_zone_t *zone, uint32_t changes)
 {
-    bool heater_on;
-    // in order of importance
-    if (temp_hi) {
-        heater_on = false;
-    } else if (temp_lo) {
-        heater_on = true;
-    } else if (hum_hi) {
-        heater_on = true;
-    } else {
-        heater_on = false;
+    ctrl_auto_state_t *state = &zone->automatic;
+    int64_t int_val;
+
+    if (changes & CTRL_AUTO_CIRCADIAN) {
+        MODEL_ZONE_LAST_INT(zone->topics, CIRCADIAN, &int_val);
+        state->circadian = int_val;
+    }
+
+    if (changes & CTRL_AUTO_CONTROL_MODE) {
+        MODEL_ZONE_LAST_INT(zone->topics, CONTROL_MODE, &int_val);
+        state->control_mode = int_val;
+    }
+
+    // humidity and temperature of one sample, published as one batch
+    unsigned int sequence;
+    do {
+        sequence = pubsub_snapshot_begin();
+        for (int index = 0; index < CTRL_QUANTITY_COUNT; index++) {
+            if (changes & CTRL_AUTO_PV(index)) {
+                pubsub_last_float_h(zone->topics[ctrl_auto_topics[index].pv], &state->quantities[index].pv);
+            }
+        }
+    } while (pubsub_snapshot_retry(sequence));
+
+    state->measured = true;
+    for (int index = 0; index < CTRL_QUANTITY_COUNT; index++) {
+        ctrl_auto_quantity_t *quantity = &state->quantities[index];
+        if (changes & CTRL_AUTO_PV(index)) {
+            quantity->measured = pubsub_published_h(zone->topics[ctrl_auto_topics[index].pv]);
+        }
+        state->measured = state->measured && quantity->measured;
+    }
+
+    for (int index = 0; index < CTRL_QUANTITY_COUNT; index++) {
+        ctrl_auto_quantity_t *quantity = &state->quantities[index];
+        if (changes & CTRL_AUTO_SV(index)) {
+            pubsub_last_float_h(zone->topics[ctrl_auto_topics[index].sv], &quantity->sv);
+        }
+        if (changes & CTRL_AUTO_BAND(index)) {
+            pubsub_last_float_h(zone->topics[ctrl_auto_topics[index].band], &quantity->band);
+        }
+        if (quantity->measured) {
+            ctrl_auto_indicate(zone, index);
+        }
+    }
+
+    // no demands on a zone without (all) sensors
+    if (state->control_mode == MODEL_CONTROL_MODE_AUTO && state->measured && changes) {
+        ctrl_auto_control(zone);
     }
-    pubsub_publish_bool(MODEL_HEATER, heater_on);
-    pubsub_publish_bool(MODEL_HEATER_SV, heater_on);
-}
-
-static void ctrl_auto_control()
-{
-    ctrl_auto_light();
-    ctrl_auto_exhaust();
-    ctrl_auto_recirculation();
-    ctrl_auto_heater();
-}
-
-static void ctrl_auto_indicate()
-{
-    ctrl_auto_set_co2_lo(co2_pv < co2_sv);
-    ctrl_auto_set_co2_hi(co2_pv > co2_sv);
-
-    ctrl_auto_set_hum_lo(hum_pv < hum_sv);
-    ctrl_auto_set_hum_hi(hum_pv > hum_sv);
-
-    ctrl_auto_set_temp_lo(temp_pv < temp_sv);
-    ctrl_auto_set_temp_hi(temp_pv > temp_sv);
-}
-
-void ctrl_auto_task()
-{
-    pubsub_message_t message;
-    bool changed = false;
-
-    if (xQueueReceive(circadian_queue, &message, 0)) {
-        circadian = message.int_val;
-        changed = true;
-    }
-
-    if (xQueueReceive(control_mode_queue, &message, 0)) {
-        control_mode = message.int_val;
-        changed = true;
-    }
-
-    if (xQueueReceive(co2_pv_queue, &message, 0)) {
-        co2_pv = message.double_val;
-        changed = true;
-    }
-    if (xQueueReceive(co2_sv_queue, &message, 0)) {
-        co2_sv = message.double_val;
-        changed = true;
-    }
-
-    if (xQueueReceive(hum_pv_queue, &message, 0)) {
-        hum_pv = message.double_val;
-        changed = true;
-    }
-    if (xQueueReceive(hum_sv_queue, &message, 0)) {
-        hum_sv = message.double_val;
-        changed = true;
-    }
-
-    if (xQueueReceive(temp_pv_queue, &message, 0)) {
-        temp_pv = message.double_val;
-        changed = true;
-    }
-    if (xQueueReceive(temp_sv_queue, &message, 0)) {
-        temp_sv = message.double_val;
-        changed = true;
-    }
-
-    ctrl_auto_indicate();
-
-    if (control_mode == MODEL_CONTROL_MODE_AUTO && changed) {
-        ctrl_auto_control();
-    }
-}
-
-static void ctrl_auto_subscribe()
-{
-    circadian_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(circadian_queue, MODEL_CIRCADIAN, true);
-
-    control_mode_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(control_mode_queue, MODEL_CONTROL_MODE, true);
-
-    co2_pv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(co2_pv_queue, MODEL_CO2_PV, true);
-    co2_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(co2_sv_queue, MODEL_CO2_SV, true);
-
-    hum_pv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(hum_pv_queue, MODEL_HUM_PV, true);
-    hum_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(hum_sv_queue, MODEL_HUM_SV, true);
-
-    temp_pv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(temp_pv_queue, MODEL_TEMP_PV, true);
-    temp_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(temp_sv_queue, MODEL_TEMP_SV, true);
-}
-
-void ctrl_auto_initialize()
-{
-    ESP_LOGD(TAG, "ctrl_auto_initialize");
-
-    ctrl_auto_subscribe();
 }
 
+static const model_topic_id_t ctrl_auto_inputs[] = {
+    MODEL_CIRCADIAN_ID,
+    MODEL_CONTROL_MODE_ID,
+    MODEL_CO2_PV_ID,
+    MODEL_CO2_SV_ID,
+    MODEL_CO2_BAND_ID,
+    MODEL_HUM_PV_ID,
+    MODEL_HUM_SV_ID,
+    MODEL_HUM_BAND_ID,
+    MODEL_TEMP_PV_ID,
+    MODEL_TEMP_SV_ID,
+    MODEL_TEMP_BAND_ID
+};
+static const model_topic_id_t ctrl_auto_outputs[] = {
+    MODEL_CO2_LO_ID,
+    MODEL_CO2_HI_ID,
+    MODEL_HUM_LO_ID,
+    MODEL_HUM_HI_ID,
+    MODEL_TEMP_LO_ID,
+    MODEL_TEMP_HI_ID,
+    MODEL_LIGHT_DEMAND_ID,
+    MODEL_LIGHT_SV_ID,
+    MODEL_EXHAUST_DEMAND_ID,
+    MODEL_EXHAUST_SV_ID,
+    MODEL_RECIRC_DEMAND_ID,
+    MODEL_RECIRC_SV_ID
+};
+
+const ctrl_stage_t ctrl_auto_stage = {
+    .name = "ctrl_auto",
+    .inputs = ctrl_auto_inputs,
+    .input_count = sizeof(ctrl_auto_inputs) / sizeof(ctrl_auto_inputs[0]),
+    .outputs = ctrl_auto_outputs,
+    .output_count = sizeof(ctrl_auto_outputs) / sizeof(ctrl_auto_outputs[0]),
+    .run = &ctrl_auto_run
+};
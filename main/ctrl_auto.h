@@ -7,8 +7,43 @@
 extern "C" {
 #endif
 
-void ctrl_auto_initialize();
-void ctrl_auto_task();
+#include <stdbool.h>
+
+#include "model.h"
+
+#include "ctrl.h"
+
+/** Automatic control quantity (co2 concentration, humidity, temperature) */
+typedef struct
+{
+    /** measurement */
+    float pv;
+    /** automatic control setpoint */
+    float sv;
+    /** hysteresis band */
+    float band;
+    bool lo;
+    bool hi;
+    /** indicators without hysteresis, for the switch statistics */
+    bool strict_lo;
+    bool strict_hi;
+    /** pv published, an unpublished pv reads 0 */
+    bool measured;
+} ctrl_auto_quantity_t;
+
+/** Automatic control state of a zone */
+typedef struct
+{
+    /** circadian */
+    model_circadian_t circadian;
+    /** control mode */
+    model_control_mode_t control_mode;
+    ctrl_auto_quantity_t quantities[CTRL_QUANTITY_COUNT];
+    /** pv of all quantities published, demands held off until then */
+    bool measured;
+} ctrl_auto_state_t;
+
+extern const ctrl_stage_t ctrl_auto_stage;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,91 @@
+// The author disclaims copyright to this source code.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "ctrl_benchmark.h"
+
+/** Samples per measurement */
+#define CTRL_BENCHMARK_SAMPLES 10000
+
+static const char *TAG = "ctrl_benchmark";
+
+/** Prevent the compiler from optimizing the pipeline away */
+static volatile int32_t ctrl_benchmark_sink;
+
+/** Inputs, volatile so they are not folded into constants */
+static volatile float ctrl_benchmark_sv_day = 295.15f;
+static volatile float ctrl_benchmark_sv_night = 290.15f;
+static volatile float ctrl_benchmark_bias = 10.0f;
+static volatile float ctrl_benchmark_gain = 0.02f;
+static volatile float ctrl_benchmark_granularity = 0.5f;
+
+/**
+ * Pipeline math per sample in double, as before float values.
+ * Mirrors ctrl_day_night, ctrl_auto, bind_control, hmi_control and hmi_numberspinner.
+ */
+static int32_t ctrl_benchmark_double(double pv, bool day)
+{
+    double sv = day ? ctrl_benchmark_sv_day : ctrl_benchmark_sv_night;
+    bool lo = pv < sv;
+    bool hi = pv > sv;
+    double pv_c = pv - 273.15;
+    double sv_c = sv - 273.15;
+    double fraction = (pv_c + ctrl_benchmark_bias) * ctrl_benchmark_gain;
+    int16_t bar = fraction * 100.0;
+    int16_t y = 10 + 100 - (fraction * 100) - 5;
+    double granularity = ctrl_benchmark_granularity;
+    int multiples = (int) (sv_c / granularity);
+    double next = granularity * multiples + granularity;
+    return bar + y + lo + (hi << 1) + (int32_t) next;
+}
+
+/**
+ * Pipeline math per sample in float, as now.
+ */
+static int32_t ctrl_benchmark_float(float pv, bool day)
+{
+    float sv = day ? ctrl_benchmark_sv_day : ctrl_benchmark_sv_night;
+    bool lo = pv < sv;
+    bool hi = pv > sv;
+    float pv_c = pv - 273.15f;
+    float sv_c = sv - 273.15f;
+    float fraction = (pv_c + ctrl_benchmark_bias) * ctrl_benchmark_gain;
+    int16_t bar = fraction * 100.0f;
+    int16_t y = 10 + 100 - (fraction * 100) - 5;
+    float granularity = ctrl_benchmark_granularity;
+    int multiples = (int) (sv_c / granularity);
+    float next = granularity * multiples + granularity;
+    return bar + y + lo + (hi << 1) + (int32_t) next;
+}
+
+void ctrl_benchmark()
+{
+    int32_t sum = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (int sample = 0; sample < CTRL_BENCHMARK_SAMPLES; sample++) {
+        double pv = 285.15 + (sample % 200) * 0.1;
+        sum += ctrl_benchmark_double(pv, sample & 1);
+    }
+    int64_t double_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int sample = 0; sample < CTRL_BENCHMARK_SAMPLES; sample++) {
+        float pv = 285.15f + (sample % 200) * 0.1f;
+        sum += ctrl_benchmark_float(pv, sample & 1);
+    }
+    int64_t float_us = esp_timer_get_time() - start;
+
+    ctrl_benchmark_sink = sum;
+
+    // cycles per sample from time and cpu frequency
+    uint32_t double_cycles = double_us * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ / CTRL_BENCHMARK_SAMPLES;
+    uint32_t float_cycles = float_us * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ / CTRL_BENCHMARK_SAMPLES;
+    ESP_LOGI(TAG, "ctrl_benchmark, samples:%d, double:%lldus (%u cycles/sample), float:%lldus (%u cycles/sample)",
+            CTRL_BENCHMARK_SAMPLES, double_us, double_cycles, float_us, float_cycles);
+}
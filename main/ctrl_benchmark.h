@@ -0,0 +1,22 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _CTRL_BENCHMARK_H_
+#define _CTRL_BENCHMARK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Run ctrl + bind arithmetic benchmark.
+ * Runs the per sample math of the pipeline (day/night select, auto indicators,
+ * Kelvin to Celsius, control bar and spinner rounding) in double and in float.
+ * Results are logged.
+ */
+extern void ctrl_benchmark();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CTRL_BENCHMARK_H_ */
@@ -7,7 +7,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 #include "pubsub.h"
 
@@ -15,48 +14,48 @@
 
 #include "ctrl_circadian.h"
 #include "ctrl.h"
+#include "ctrl_zone.h"
 
-static const char *TAG = "ctrl_circadian";
+/** input change bits, in order of inputs */
+#define CTRL_CIRCADIAN_TIME (1 << 0)
+#define CTRL_CIRCADIAN_BEGIN_OF_DAY (1 << 1)
+#define CTRL_CIRCADIAN_BEGIN_OF_NIGHT (1 << 2)
 
-static QueueHandle_t time_queue;
-static uint16_t time_minutes;
-static QueueHandle_t begin_of_day_queue;
-static uint16_t begin_of_day_minutes;
-static QueueHandle_t begin_of_night_queue;
-static uint16_t begin_of_night_minutes;
-static bool day;
-
-static void ctrl_circadian_set_day(bool value)
+static void ctrl_circadian_set_day(ctrl_zone_t *zone, bool value)
 {
-    if (day != value) {
-        day = value;
-        pubsub_publish_int(MODEL_CIRCADIAN, day ? MODEL_CIRCADIAN_DAY : MODEL_CIRCADIAN_NIGHT);
+    if (zone->circadian.day != value) {
+        zone->circadian.day = value;
+        MODEL_ZONE_PUBLISH_INT(zone->topics, CIRCADIAN, value ? MODEL_CIRCADIAN_DAY : MODEL_CIRCADIAN_NIGHT);
     }
 }
 
-void ctrl_circadian_task()
+static void ctrl_circadian_run(ctrl_zone_t *zone, uint32_t changes)
 {
-    pubsub_message_t message;
+    ctrl_circadian_state_t *state = &zone->circadian;
+    int64_t int_val;
     bool change = false;
-    if (xQueueReceive(time_queue, &message, 0)) {
+    if (changes & CTRL_CIRCADIAN_TIME) {
+        MODEL_ZONE_LAST_INT(zone->topics, CURRENT_TIME, &int_val);
         struct tm brokentime;
-        time_t time = message.int_val;
+        time_t time = int_val;
         gmtime_r(&time, &brokentime);
-        time_minutes = brokentime.tm_hour * 60 + brokentime.tm_min;
+        state->time_minutes = brokentime.tm_hour * 60 + brokentime.tm_min;
         change = true;
     }
-    if (xQueueReceive(begin_of_day_queue, &message, 0)) {
+    if (changes & CTRL_CIRCADIAN_BEGIN_OF_DAY) {
+        MODEL_ZONE_LAST_INT(zone->topics, BEGIN_OF_DAY, &int_val);
         struct tm brokentime;
-        time_t time = message.int_val;
+        time_t time = int_val;
         gmtime_r(&time, &brokentime);
-        begin_of_day_minutes = brokentime.tm_hour * 60 + brokentime.tm_min;
+        state->begin_of_day_minutes = brokentime.tm_hour * 60 + brokentime.tm_min;
         change = true;
     }
-    if (xQueueReceive(begin_of_night_queue, &message, 0)) {
+    if (changes & CTRL_CIRCADIAN_BEGIN_OF_NIGHT) {
+        MODEL_ZONE_LAST_INT(zone->topics, BEGIN_OF_NIGHT, &int_val);
         struct tm brokentime;
-        time_t time = message.int_val;
+        time_t time = int_val;
         gmtime_r(&time, &brokentime);
-        begin_of_night_minutes = brokentime.tm_hour * 60 + brokentime.tm_min;
+        state->begin_of_night_minutes = brokentime.tm_hour * 60 + brokentime.tm_min;
         change = true;
     }
 
@@ -64,30 +63,33 @@ void ctrl_circadian_task()
         // minute:    0...........1439
         // day night: nnnnnDdddddddNnn
         // night day: ddNnnnnnnnDddddd
+        uint16_t time_minutes = state->time_minutes;
+        uint16_t begin_of_day_minutes = state->begin_of_day_minutes;
+        uint16_t begin_of_night_minutes = state->begin_of_night_minutes;
         uint16_t day;
         if (begin_of_day_minutes < begin_of_night_minutes) {
             day = (time_minutes >= begin_of_day_minutes) && (time_minutes < begin_of_night_minutes);
         } else {
             day = (time_minutes < begin_of_night_minutes) || (time_minutes >= begin_of_day_minutes);
         }
-        ctrl_circadian_set_day(day);
+        ctrl_circadian_set_day(zone, day);
     }
 }
 
-static void ctrl_circadian_subscribe()
-{
-    time_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(time_queue, MODEL_CURRENT_TIME, true);
-    begin_of_day_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(begin_of_day_queue, MODEL_BEGIN_OF_DAY, true);
-    begin_of_night_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(begin_of_night_queue, MODEL_BEGIN_OF_NIGHT, true);
-}
-
-void ctrl_circadian_initialize()
-{
-    ESP_LOGD(TAG, "ctrl_circadian_initialize");
-
-    ctrl_circadian_subscribe();
-}
+static const model_topic_id_t ctrl_circadian_inputs[] = {
+    MODEL_CURRENT_TIME_ID,
+    MODEL_BEGIN_OF_DAY_ID,
+    MODEL_BEGIN_OF_NIGHT_ID
+};
+static const model_topic_id_t ctrl_circadian_outputs[] = {
+    MODEL_CIRCADIAN_ID
+};
 
+const ctrl_stage_t ctrl_circadian_stage = {
+    .name = "ctrl_circadian",
+    .inputs = ctrl_circadian_inputs,
+    .input_count = sizeof(ctrl_circadian_inputs) / sizeof(ctrl_circadian_inputs[0]),
+    .outputs = ctrl_circadian_outputs,
+    .output_count = sizeof(ctrl_circadian_outputs) / sizeof(ctrl_circadian_outputs[0]),
+    .run = &ctrl_circadian_run
+};
@@ -7,8 +7,21 @@
 extern "C" {
 #endif
 
-void ctrl_circadian_initialize();
-void ctrl_circadian_task();
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ctrl.h"
+
+/** Circadian state of a zone */
+typedef struct
+{
+    uint16_t time_minutes;
+    uint16_t begin_of_day_minutes;
+    uint16_t begin_of_night_minutes;
+    bool day;
+} ctrl_circadian_state_t;
+
+extern const ctrl_stage_t ctrl_circadian_stage;
 
 #ifdef __cplusplus
 }
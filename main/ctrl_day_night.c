@@ -6,7 +6,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 #include "pubsub.h"
 
@@ -14,147 +13,129 @@
 
 #include "ctrl_day_night.h"
 #include "ctrl.h"
-
-static const char *TAG = "ctrl_day_night";
-
-/** circadian */
-static QueueHandle_t circadian_queue;
-static model_circadian_t circadian;
-
-/** automatic control setpoint day time co2 concentration */
-static QueueHandle_t co2_sv_day_queue;
-static double co2_sv_day;
-/** automatic control setpoint night time co2 concentration */
-static QueueHandle_t co2_sv_night_queue;
-static double co2_sv_night;
-static double co2_sv;
-
-/** automatic control setpoint day time humidity */
-static QueueHandle_t hum_sv_day_queue;
-static double hum_sv_day;
-/** automatic control setpoint night time humidity */
-static QueueHandle_t hum_sv_night_queue;
-static double hum_sv_night;
-static double hum_sv;
-
-/** automatic control setpoint day time temperature */
-static QueueHandle_t temp_sv_day_queue;
-static double temp_sv_day;
-/** automatic control setpoint night time temperature */
-static QueueHandle_t temp_sv_night_queue;
-static double temp_sv_night;
-static double temp_sv;
-
-static void ctrl_day_night_set_co2_sv(double value)
+#include "ctrl_zone.h"
+
+/** input change bits, in order of inputs */
+#define CTRL_DAY_NIGHT_CIRCADIAN (1 << 0)
+#define CTRL_DAY_NIGHT_CO2_SV_DAY (1 << 1)
+#define CTRL_DAY_NIGHT_CO2_SV_NIGHT (1 << 2)
+#define CTRL_DAY_NIGHT_HUM_SV_DAY (1 << 3)
+#define CTRL_DAY_NIGHT_HUM_SV_NIGHT (1 << 4)
+#define CTRL_DAY_NIGHT_TEMP_SV_DAY (1 << 5)
+#define CTRL_DAY_NIGHT_TEMP_SV_NIGHT (1 << 6)
+
+static void ctrl_day_night_set_co2_sv(ctrl_zone_t *zone, float value)
 {
-    if (value != co2_sv) {
-        co2_sv = value;
-        pubsub_publish_double(MODEL_CO2_SV, value);
+    if (value != zone->day_night.co2_sv) {
+        zone->day_night.co2_sv = value;
+        MODEL_ZONE_PUBLISH_FLOAT(zone->topics, CO2_SV, value);
     }
 }
 
-static void ctrl_day_night_set_hum_sv(double value)
+static void ctrl_day_night_set_hum_sv(ctrl_zone_t *zone, float value)
 {
-    if (value != hum_sv) {
-        hum_sv = value;
-        pubsub_publish_double(MODEL_HUM_SV, value);
+    if (value != zone->day_night.hum_sv) {
+        zone->day_night.hum_sv = value;
+        MODEL_ZONE_PUBLISH_FLOAT(zone->topics, HUM_SV, value);
     }
 }
 
-static void ctrl_day_night_set_temp_sv(double value)
+static void ctrl_day_night_set_temp_sv(ctrl_zone_t *zone, float value)
 {
-    if (value != temp_sv) {
-        temp_sv = value;
-        pubsub_publish_double(MODEL_TEMP_SV, value);
+    if (value != zone->day_night.temp_sv) {
+        zone->day_night.temp_sv = value;
+        MODEL_ZONE_PUBLISH_FLOAT(zone->topics, TEMP_SV, value);
     }
 }
 
-static void ctrl_day_night_set_circadian(model_circadian_t value)
+static void ctrl_day_night_set_circadian(ctrl_zone_t *zone, model_circadian_t value)
 {
+    const ctrl_day_night_state_t *state = &zone->day_night;
     if (value == MODEL_CIRCADIAN_DAY) {
-        ctrl_day_night_set_co2_sv(co2_sv_day);
-        ctrl_day_night_set_hum_sv(hum_sv_day);
-        ctrl_day_night_set_temp_sv(temp_sv_day);
+        ctrl_day_night_set_co2_sv(zone, state->co2_sv_day);
+        ctrl_day_night_set_hum_sv(zone, state->hum_sv_day);
+        ctrl_day_night_set_temp_sv(zone, state->temp_sv_day);
     } else {
-        ctrl_day_night_set_co2_sv(co2_sv_night);
-        ctrl_day_night_set_hum_sv(hum_sv_night);
-        ctrl_day_night_set_temp_sv(temp_sv_night);
+        ctrl_day_night_set_co2_sv(zone, state->co2_sv_night);
+        ctrl_day_night_set_hum_sv(zone, state->hum_sv_night);
+        ctrl_day_night_set_temp_sv(zone, state->temp_sv_night);
     }
 }
 
-void ctrl_day_night_task()
+static void ctrl_day_night_run(ctrl_zone_t *zone, uint32_t changes)
 {
-    pubsub_message_t message;
-    if (xQueueReceive(circadian_queue, &message, 0)) {
-        circadian = message.int_val;
-        ctrl_day_night_set_circadian(circadian);
+    ctrl_day_night_state_t *state = &zone->day_night;
+
+    if (changes & CTRL_DAY_NIGHT_CIRCADIAN) {
+        int64_t int_val;
+        MODEL_ZONE_LAST_INT(zone->topics, CIRCADIAN, &int_val);
+        state->circadian = int_val;
+        ctrl_day_night_set_circadian(zone, state->circadian);
     }
 
-    if (xQueueReceive(co2_sv_day_queue, &message, 0)) {
-        co2_sv_day = message.double_val;
-        if (circadian == MODEL_CIRCADIAN_DAY) {
-            ctrl_day_night_set_co2_sv(co2_sv_day);
+    if (changes & CTRL_DAY_NIGHT_CO2_SV_DAY) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, CO2_SV_DAY, &state->co2_sv_day);
+        if (state->circadian == MODEL_CIRCADIAN_DAY) {
+            ctrl_day_night_set_co2_sv(zone, state->co2_sv_day);
         }
     }
-    if (xQueueReceive(co2_sv_night_queue, &message, 0)) {
-        co2_sv_night = message.double_val;
-        if (circadian == MODEL_CIRCADIAN_NIGHT) {
-            ctrl_day_night_set_co2_sv(co2_sv_night);
+
+    if (changes & CTRL_DAY_NIGHT_CO2_SV_NIGHT) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, CO2_SV_NIGHT, &state->co2_sv_night);
+        if (state->circadian == MODEL_CIRCADIAN_NIGHT) {
+            ctrl_day_night_set_co2_sv(zone, state->co2_sv_night);
         }
     }
 
-    if (xQueueReceive(hum_sv_day_queue, &message, 0)) {
-        hum_sv_day = message.double_val;
-        if (circadian == MODEL_CIRCADIAN_DAY) {
-            ctrl_day_night_set_hum_sv(hum_sv_day);
+    if (changes & CTRL_DAY_NIGHT_HUM_SV_DAY) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, HUM_SV_DAY, &state->hum_sv_day);
+        if (state->circadian == MODEL_CIRCADIAN_DAY) {
+            ctrl_day_night_set_hum_sv(zone, state->hum_sv_day);
         }
     }
-    if (xQueueReceive(hum_sv_night_queue, &message, 0)) {
-        hum_sv_night = message.double_val;
-        if (circadian == MODEL_CIRCADIAN_NIGHT) {
-            ctrl_day_night_set_hum_sv(hum_sv_night);
+
+    if (changes & CTRL_DAY_NIGHT_HUM_SV_NIGHT) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, HUM_SV_NIGHT, &state->hum_sv_night);
+        if (state->circadian == MODEL_CIRCADIAN_NIGHT) {
+            ctrl_day_night_set_hum_sv(zone, state->hum_sv_night);
         }
     }
 
-    if (xQueueReceive(temp_sv_day_queue, &message, 0)) {
-        temp_sv_day = message.double_val;
-        if (circadian == MODEL_CIRCADIAN_DAY) {
-            ctrl_day_night_set_temp_sv(temp_sv_day);
+    if (changes & CTRL_DAY_NIGHT_TEMP_SV_DAY) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, TEMP_SV_DAY, &state->temp_sv_day);
+        if (state->circadian == MODEL_CIRCADIAN_DAY) {
+            ctrl_day_night_set_temp_sv(zone, state->temp_sv_day);
         }
     }
-    if (xQueueReceive(temp_sv_night_queue, &message, 0)) {
-        temp_sv_night = message.double_val;
-        if (circadian == MODEL_CIRCADIAN_NIGHT) {
-            ctrl_day_night_set_temp_sv(temp_sv_night);
+
+    if (changes & CTRL_DAY_NIGHT_TEMP_SV_NIGHT) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, TEMP_SV_NIGHT, &state->temp_sv_night);
+        if (state->circadian == MODEL_CIRCADIAN_NIGHT) {
+            ctrl_day_night_set_temp_sv(zone, state->temp_sv_night);
         }
     }
 }
 
-static void ctrl_day_night_subscribe()
-{
-    circadian_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(circadian_queue, MODEL_CIRCADIAN, true);
-
-    co2_sv_day_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(co2_sv_day_queue, MODEL_CO2_SV_DAY, true);
-    co2_sv_night_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(co2_sv_night_queue, MODEL_CO2_SV_NIGHT, true);
-
-    hum_sv_day_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(hum_sv_day_queue, MODEL_HUM_SV_DAY, true);
-    hum_sv_night_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(hum_sv_night_queue, MODEL_HUM_SV_NIGHT, true);
-
-    temp_sv_day_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(temp_sv_day_queue, MODEL_TEMP_SV_DAY, true);
-    temp_sv_night_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(temp_sv_night_queue, MODEL_TEMP_SV_NIGHT, true);
-}
-
-void ctrl_day_night_initialize()
-{
-    ESP_LOGD(TAG, "ctrl_day_night_initialize");
-
-    ctrl_day_night_subscribe();
-}
-
+static const model_topic_id_t ctrl_day_night_inputs[] = {
+    MODEL_CIRCADIAN_ID,
+    MODEL_CO2_SV_DAY_ID,
+    MODEL_CO2_SV_NIGHT_ID,
+    MODEL_HUM_SV_DAY_ID,
+    MODEL_HUM_SV_NIGHT_ID,
+    MODEL_TEMP_SV_DAY_ID,
+    MODEL_TEMP_SV_NIGHT_ID
+};
+static const model_topic_id_t ctrl_day_night_outputs[] = {
+    MODEL_CO2_SV_ID,
+    MODEL_HUM_SV_ID,
+    MODEL_TEMP_SV_ID
+};
+
+const ctrl_stage_t ctrl_day_night_stage = {
+    .name = "ctrl_day_night",
+    .inputs = ctrl_day_night_inputs,
+    .input_count = sizeof(ctrl_day_night_inputs) / sizeof(ctrl_day_night_inputs[0]),
+    .outputs = ctrl_day_night_outputs,
+    .output_count = sizeof(ctrl_day_night_outputs) / sizeof(ctrl_day_night_outputs[0]),
+    .run = &ctrl_day_night_run
+};
@@ -7,8 +7,33 @@
 extern "C" {
 #endif
 
-void ctrl_day_night_initialize();
-void ctrl_day_night_task();
+#include "model.h"
+
+#include "ctrl.h"
+
+/** Day night setpoint state of a zone */
+typedef struct
+{
+    /** circadian */
+    model_circadian_t circadian;
+    /** automatic control setpoint day time co2 concentration */
+    float co2_sv_day;
+    /** automatic control setpoint night time co2 concentration */
+    float co2_sv_night;
+    float co2_sv;
+    /** automatic control setpoint day time humidity */
+    float hum_sv_day;
+    /** automatic control setpoint night time humidity */
+    float hum_sv_night;
+    float hum_sv;
+    /** automatic control setpoint day time temperature */
+    float temp_sv_day;
+    /** automatic control setpoint night time temperature */
+    float temp_sv_night;
+    float temp_sv;
+} ctrl_day_night_state_t;
+
+extern const ctrl_stage_t ctrl_day_night_stage;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,296 @@
+// The author disclaims copyright to this source code.
+
+#include <stdbool.h>
+
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "clock.h"
+#include "pubsub.h"
+
+#include "model.h"
+
+#include "ctrl_heater.h"
+#include "ctrl.h"
+#include "ctrl_zone.h"
+
+/**
+ * Heater in automatic control.
+ *
+ * PID on temperature computes a duty cycle, the time proportioning scheduler
+ * switches the heater on for duty * window at the start of each window.
+ * On and off pulses shorter than the heater minimum on and off time are dropped,
+ * so the output stage never holds a switch of the scheduler.
+ * Each run is O(1): integration of the held error since the previous run,
+ * the derivative from the last two measurements, spread up to now: a measurement held
+ * by the TEMP_PV deadband fades the derivative instead of keeping its last slope.
+ * A proportional gain of 0 selects on/off control by the temperature indicators.
+ * Humidity above the band heats at full duty, unless the temperature is above the band.
+ * The heater stays off until all measurements are published, an unpublished one reads 0.
+ */
+
+/** input change bits, in order of inputs */
+#define CTRL_HEATER_CONTROL_MODE (1 << 0)
+#define CTRL_HEATER_TEMP_LO (1 << 1)
+#define CTRL_HEATER_TEMP_HI (1 << 2)
+#define CTRL_HEATER_HUM_HI (1 << 3)
+#define CTRL_HEATER_TEMP_PV (1 << 4)
+#define CTRL_HEATER_TEMP_SV (1 << 5)
+#define CTRL_HEATER_KP (1 << 6)
+#define CTRL_HEATER_TI (1 << 7)
+#define CTRL_HEATER_TD (1 << 8)
+#define CTRL_HEATER_WINDOW (1 << 9)
+#define CTRL_HEATER_MIN_ON (1 << 10)
+#define CTRL_HEATER_MIN_OFF (1 << 11)
+#define CTRL_HEATER_HUM_PV (1 << 12)
+#define CTRL_HEATER_CO2_PV (1 << 13)
+
+#define CTRL_HEATER_SECOND_US 1000000LL
+
+static float ctrl_heater_clamp(float value)
+{
+    if (value < 0.0f) {
+        return 0.0f;
+    } else if (value > 1.0f) {
+        return 1.0f;
+    }
+    return value;
+}
+
+static void ctrl_heater_read_seconds(pubsub_topic_t topic, float *value)
+{
+    int64_t seconds;
+    if (pubsub_last_int_h(topic, &seconds)) {
+        *value = seconds > 0 ? seconds : 0;
+    }
+}
+
+static void ctrl_heater_read_time(pubsub_topic_t topic, int64_t *value)
+{
+    int64_t seconds;
+    if (pubsub_last_int_h(topic, &seconds)) {
+        *value = (seconds > 0 ? seconds : 0) * CTRL_HEATER_SECOND_US;
+    }
+}
+
+/**
+ * Restart control, no integral and no measurement history.
+ */
+static void ctrl_heater_reset(ctrl_heater_state_t *state)
+{
+    state->integrated = 0;
+    state->sampled = 0;
+    state->integral = 0.0f;
+    state->change = 0.0f;
+    state->change_since = 0;
+    state->window_start = 0;
+}
+
+/**
+ * Integrate error held since the previous run up to now, with anti-windup:
+ * no integration while the output saturates in the direction of the error.
+ */
+static void ctrl_heater_integrate(ctrl_heater_state_t *state, int64_t now)
+{
+    if (state->integrated != 0 && state->ti > 0.0f) {
+        float error = state->temp_sv - state->temp_pv;
+        float dt = (now - state->integrated) / (float) CTRL_HEATER_SECOND_US;
+        bool saturated = (state->duty >= 1.0f && error > 0.0f) || (state->duty <= 0.0f && error < 0.0f);
+        if (!saturated) {
+            state->integral = ctrl_heater_clamp(state->integral + state->kp * error * dt / state->ti);
+        }
+    }
+    state->integrated = now;
+}
+
+/**
+ * New measurement, derivative on measurement avoids a kick on setpoint changes.
+ */
+static void ctrl_heater_sample(ctrl_heater_state_t *state, float previous_pv, int64_t now)
+{
+    if (state->sampled != 0 && now > state->sampled) {
+        state->change = state->temp_pv - previous_pv;
+        state->change_since = state->sampled;
+    }
+    state->sampled = now;
+}
+
+/**
+ * @return temperature slope at now [K/s], the last change over the time since the measurement before it.
+ */
+static float ctrl_heater_slope(const ctrl_heater_state_t *state, int64_t now)
+{
+    if (state->change_since == 0 || now <= state->change_since) {
+        return 0.0f;
+    }
+    return state->change * CTRL_HEATER_SECOND_US / (now - state->change_since);
+}
+
+static float ctrl_heater_pid(const ctrl_heater_state_t *state, int64_t now)
+{
+    float error = state->temp_sv - state->temp_pv;
+    return ctrl_heater_clamp(state->kp * (error - state->td * ctrl_heater_slope(state, now)) + state->integral);
+}
+
+/**
+ * @return on time in the window for duty, pulses shorter than minimum on or off time dropped [us].
+ */
+static int64_t ctrl_heater_on_time(const ctrl_heater_state_t *state)
+{
+    int64_t on_time = state->duty * state->window;
+    if (on_time < state->min_on || on_time == 0) {
+        return 0;
+    }
+    if (state->window - on_time < state->min_off) {
+        return state->window;
+    }
+    return on_time;
+}
+
+/**
+ * @return true if the heater is on at now, starts the next window when the current one ended.
+ */
+static bool ctrl_heater_schedule(ctrl_heater_state_t *state, int64_t now)
+{
+    if (state->window_start == 0 || now >= state->window_start + state->window) {
+        state->window_start = now;
+    }
+    return now < state->window_start + ctrl_heater_on_time(state);
+}
+
+static void ctrl_heater_run(ctrl_zone_t *zone, uint32_t changes)
+{
+    ctrl_heater_state_t *state = &zone->heater;
+    int64_t now = clock_now();
+
+    if (state->control_mode == MODEL_CONTROL_MODE_AUTO) {
+        ctrl_heater_integrate(state, now);
+    }
+
+    if (changes & CTRL_HEATER_CONTROL_MODE) {
+        int64_t int_val;
+        MODEL_ZONE_LAST_INT(zone->topics, CONTROL_MODE, &int_val);
+        if (int_val != state->control_mode) {
+            ctrl_heater_reset(state);
+        }
+        state->control_mode = int_val;
+    }
+    if (changes & CTRL_HEATER_TEMP_LO) {
+        MODEL_ZONE_LAST_BOOL(zone->topics, TEMP_LO, &state->temp_lo);
+    }
+    if (changes & CTRL_HEATER_TEMP_HI) {
+        MODEL_ZONE_LAST_BOOL(zone->topics, TEMP_HI, &state->temp_hi);
+    }
+    if (changes & CTRL_HEATER_HUM_HI) {
+        MODEL_ZONE_LAST_BOOL(zone->topics, HUM_HI, &state->hum_hi);
+    }
+    if (changes & CTRL_HEATER_TEMP_PV) {
+        float previous_pv = state->temp_pv;
+        MODEL_ZONE_LAST_FLOAT(zone->topics, TEMP_PV, &state->temp_pv);
+        ctrl_heater_sample(state, previous_pv, now);
+    }
+    if (changes & (CTRL_HEATER_TEMP_PV | CTRL_HEATER_HUM_PV | CTRL_HEATER_CO2_PV)) {
+        state->measured = pubsub_published_h(zone->topics[MODEL_TEMP_PV_ID])
+                && pubsub_published_h(zone->topics[MODEL_HUM_PV_ID]) && pubsub_published_h(zone->topics[MODEL_CO2_PV_ID]);
+    }
+    if (changes & CTRL_HEATER_TEMP_SV) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, TEMP_SV, &state->temp_sv);
+    }
+    if (changes & CTRL_HEATER_KP) {
+        MODEL_ZONE_LAST_FLOAT(zone->topics, HEATER_KP, &state->kp);
+    }
+    if (changes & CTRL_HEATER_TI) {
+        ctrl_heater_read_seconds(zone->topics[MODEL_HEATER_TI_ID], &state->ti);
+    }
+    if (changes & CTRL_HEATER_TD) {
+        ctrl_heater_read_seconds(zone->topics[MODEL_HEATER_TD_ID], &state->td);
+    }
+    if (changes & CTRL_HEATER_WINDOW) {
+        ctrl_heater_read_time(zone->topics[MODEL_HEATER_WINDOW_ID], &state->window);
+        state->window_start = 0;
+    }
+    if (changes & CTRL_HEATER_MIN_ON) {
+        ctrl_heater_read_time(zone->topics[MODEL_HEATER_MIN_ON_ID], &state->min_on);
+    }
+    if (changes & CTRL_HEATER_MIN_OFF) {
+        ctrl_heater_read_time(zone->topics[MODEL_HEATER_MIN_OFF_ID], &state->min_off);
+    }
+
+    if (state->control_mode != MODEL_CONTROL_MODE_AUTO) {
+        return;
+    }
+
+    bool heater_on;
+    if (!state->measured) {
+        // starts without history once measured
+        ctrl_heater_reset(state);
+        state->duty = 0.0f;
+        heater_on = false;
+    } else if (state->kp <= 0.0f || state->window <= 0) {
+        // on/off, in order of importance
+        if (state->temp_hi) {
+            heater_on = false;
+        } else if (state->temp_lo) {
+            heater_on = true;
+        } else {
+            heater_on = state->hum_hi;
+        }
+        state->duty = heater_on ? 1.0f : 0.0f;
+    } else {
+        state->duty = (state->hum_hi && !state->temp_hi) ? 1.0f : ctrl_heater_pid(state, now);
+        heater_on = ctrl_heater_schedule(state, now);
+    }
+    state->on = heater_on;
+    MODEL_ZONE_PUBLISH_FLOAT(zone->topics, HEATER_DUTY, state->duty);
+    MODEL_ZONE_PUBLISH_BOOL(zone->topics, HEATER_DEMAND, heater_on);
+}
+
+/**
+ * @return next switch of the time proportioning scheduler or start of the next window, 0 if none.
+ * Each window starts with a new duty, also without a new measurement.
+ */
+static int64_t ctrl_heater_deadline(const ctrl_zone_t *zone)
+{
+    const ctrl_heater_state_t *state = &zone->heater;
+    if (state->control_mode != MODEL_CONTROL_MODE_AUTO || state->window_start == 0) {
+        return 0;
+    }
+    int64_t on_time = ctrl_heater_on_time(state);
+    if (state->on && on_time < state->window) {
+        return state->window_start + on_time;
+    }
+    return state->window_start + state->window;
+}
+
+static const model_topic_id_t ctrl_heater_inputs[] = {
+    MODEL_CONTROL_MODE_ID,
+    MODEL_TEMP_LO_ID,
+    MODEL_TEMP_HI_ID,
+    MODEL_HUM_HI_ID,
+    MODEL_TEMP_PV_ID,
+    MODEL_TEMP_SV_ID,
+    MODEL_HEATER_KP_ID,
+    MODEL_HEATER_TI_ID,
+    MODEL_HEATER_TD_ID,
+    MODEL_HEATER_WINDOW_ID,
+    MODEL_HEATER_MIN_ON_ID,
+    MODEL_HEATER_MIN_OFF_ID,
+    MODEL_HUM_PV_ID,
+    MODEL_CO2_PV_ID
+};
+static const model_topic_id_t ctrl_heater_outputs[] = {
+    MODEL_HEATER_DUTY_ID,
+    MODEL_HEATER_DEMAND_ID
+};
+
+const ctrl_stage_t ctrl_heater_stage = {
+    .name = "ctrl_heater",
+    .inputs = ctrl_heater_inputs,
+    .input_count = sizeof(ctrl_heater_inputs) / sizeof(ctrl_heater_inputs[0]),
+    .outputs = ctrl_heater_outputs,
+    .output_count = sizeof(ctrl_heater_outputs) / sizeof(ctrl_heater_outputs[0]),
+    .run = &ctrl_heater_run,
+    .deadline = &ctrl_heater_deadline
+};
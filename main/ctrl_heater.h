@@ -0,0 +1,61 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _CTRL_HEATER_H_
+#define _CTRL_HEATER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+
+#include "ctrl.h"
+
+/** Heater automatic control state of a zone */
+typedef struct
+{
+    model_control_mode_t control_mode;
+    bool temp_lo;
+    bool temp_hi;
+    bool hum_hi;
+    /** measurement temperature */
+    float temp_pv;
+    /** automatic control setpoint temperature */
+    float temp_sv;
+    /** proportional gain [1/K] */
+    float kp;
+    /** integral and derivative time [s] */
+    float ti;
+    float td;
+    /** time proportioning window, minimum on and off pulse [us] */
+    int64_t window;
+    int64_t min_on;
+    int64_t min_off;
+    /** time of last integration and of last measurement [us], 0 if none */
+    int64_t integrated;
+    int64_t sampled;
+    /** integral part of duty */
+    float integral;
+    /** temperature change at last measurement [K] and time of the measurement before it [us], 0 if none */
+    float change;
+    int64_t change_since;
+    /** duty cycle 0..1 */
+    float duty;
+    /** start of time proportioning window [us], 0 if none */
+    int64_t window_start;
+    /** heater on in the window */
+    bool on;
+    /** temperature, humidity and co2 pv published */
+    bool measured;
+} ctrl_heater_state_t;
+
+extern const ctrl_stage_t ctrl_heater_stage;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CTRL_HEATER_H_ */
@@ -0,0 +1,36 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _CTRL_HYSTERESIS_H_
+#define _CTRL_HYSTERESIS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/**
+ * Hysteresis of a low and high indicator around a setpoint.
+ * The low indicator switches on below setpoint - band and off again at the setpoint,
+ * the high indicator on above setpoint + band and off at the setpoint.
+ * Measurement noise smaller than the band does not switch the indicators,
+ * a band of 0 is the strict comparison.
+ */
+
+/** @return next low indicator */
+static inline bool ctrl_hysteresis_lo(bool lo, float pv, float sv, float band)
+{
+    return lo ? pv < sv : pv < sv - band;
+}
+
+/** @return next high indicator */
+static inline bool ctrl_hysteresis_hi(bool hi, float pv, float sv, float band)
+{
+    return hi ? pv > sv : pv > sv + band;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CTRL_HYSTERESIS_H_ */
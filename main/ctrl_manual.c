@@ -6,7 +6,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 #include "pubsub.h"
 
@@ -14,75 +13,77 @@
 
 #include "ctrl_manual.h"
 #include "ctrl.h"
+#include "ctrl_zone.h"
 
-static const char *TAG = "ctrl_manual";
+/** input change bits, in order of inputs */
+#define CTRL_MANUAL_CONTROL_MODE (1 << 0)
+#define CTRL_MANUAL_LIGHT_SV (1 << 1)
+#define CTRL_MANUAL_EXHAUST_SV (1 << 2)
+#define CTRL_MANUAL_RECIRC_SV (1 << 3)
+#define CTRL_MANUAL_HEATER_SV (1 << 4)
 
-static QueueHandle_t control_mode_queue;
-static model_control_mode_t control_mode;
-
-static QueueHandle_t light_sv_queue;
-
-static QueueHandle_t exhaust_sv_queue;
-
-static QueueHandle_t recirc_sv_queue;
-
-static QueueHandle_t heater_sv_queue;
-
-void ctrl_manual_task()
+static void ctrl_manual_run(ctrl_zone_t *zone, uint32_t changes)
 {
-    pubsub_message_t message;
+    ctrl_manual_state_t *state = &zone->manual;
 
-    if (xQueueReceive(control_mode_queue, &message, 0)) {
-        control_mode = message.int_val;
+    if (changes & CTRL_MANUAL_CONTROL_MODE) {
+        int64_t int_val;
+        MODEL_ZONE_LAST_INT(zone->topics, CONTROL_MODE, &int_val);
+        state->control_mode = int_val;
     }
-    if (xQueueReceive(light_sv_queue, &message, 0)) {
-        if (control_mode == MODEL_CONTROL_MODE_MANUAL) {
-            bool light_sv = message.boolean_val;
-            pubsub_publish_bool(MODEL_LIGHT, light_sv);
+
+    if (changes & CTRL_MANUAL_LIGHT_SV) {
+        if (state->control_mode == MODEL_CONTROL_MODE_MANUAL) {
+            bool light_sv;
+            MODEL_ZONE_LAST_BOOL(zone->topics, LIGHT_SV, &light_sv);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, LIGHT_DEMAND, light_sv);
         }
     }
-    if (xQueueReceive(exhaust_sv_queue, &message, 0)) {
-        if (control_mode == MODEL_CONTROL_MODE_MANUAL) {
-            bool exhaust_sv = message.boolean_val;
-            pubsub_publish_bool(MODEL_EXHAUST, exhaust_sv);
+
+    if (changes & CTRL_MANUAL_EXHAUST_SV) {
+        if (state->control_mode == MODEL_CONTROL_MODE_MANUAL) {
+            bool exhaust_sv;
+            MODEL_ZONE_LAST_BOOL(zone->topics, EXHAUST_SV, &exhaust_sv);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, EXHAUST_DEMAND, exhaust_sv);
         }
     }
-    if (xQueueReceive(recirc_sv_queue, &message, 0)) {
-        if (control_mode == MODEL_CONTROL_MODE_MANUAL) {
-            bool recirc_sv = message.boolean_val;
-            pubsub_publish_bool(MODEL_RECIRC, recirc_sv);
+
+    if (changes & CTRL_MANUAL_RECIRC_SV) {
+        if (state->control_mode == MODEL_CONTROL_MODE_MANUAL) {
+            bool recirc_sv;
+            MODEL_ZONE_LAST_BOOL(zone->topics, RECIRC_SV, &recirc_sv);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, RECIRC_DEMAND, recirc_sv);
         }
     }
-    if (xQueueReceive(heater_sv_queue, &message, 0)) {
-        if (control_mode == MODEL_CONTROL_MODE_MANUAL) {
-            bool heater_sv = message.boolean_val;
-            pubsub_publish_bool(MODEL_HEATER, heater_sv);
+
+    if (changes & CTRL_MANUAL_HEATER_SV) {
+        if (state->control_mode == MODEL_CONTROL_MODE_MANUAL) {
+            bool heater_sv;
+            MODEL_ZONE_LAST_BOOL(zone->topics, HEATER_SV, &heater_sv);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, HEATER_DEMAND, heater_sv);
         }
     }
 }
 
-static void ctrl_manual_subscribe()
-{
-    control_mode_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(control_mode_queue, MODEL_CONTROL_MODE, true);
-
-    light_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(light_sv_queue, MODEL_LIGHT_SV, true);
-
-    exhaust_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(exhaust_sv_queue, MODEL_EXHAUST_SV, true);
-
-    recirc_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(recirc_sv_queue, MODEL_RECIRC_SV, true);
-
-    heater_sv_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(heater_sv_queue, MODEL_HEATER_SV, true);
-}
-
-void ctrl_manual_initialize()
-{
-    ESP_LOGD(TAG, "ctrl_manual_initialize");
-
-    ctrl_manual_subscribe();
-}
-
+static const model_topic_id_t ctrl_manual_inputs[] = {
+    MODEL_CONTROL_MODE_ID,
+    MODEL_LIGHT_SV_ID,
+    MODEL_EXHAUST_SV_ID,
+    MODEL_RECIRC_SV_ID,
+    MODEL_HEATER_SV_ID
+};
+static const model_topic_id_t ctrl_manual_outputs[] = {
+    MODEL_LIGHT_DEMAND_ID,
+    MODEL_EXHAUST_DEMAND_ID,
+    MODEL_RECIRC_DEMAND_ID,
+    MODEL_HEATER_DEMAND_ID
+};
+
+const ctrl_stage_t ctrl_manual_stage = {
+    .name = "ctrl_manual",
+    .inputs = ctrl_manual_inputs,
+    .input_count = sizeof(ctrl_manual_inputs) / sizeof(ctrl_manual_inputs[0]),
+    .outputs = ctrl_manual_outputs,
+    .output_count = sizeof(ctrl_manual_outputs) / sizeof(ctrl_manual_outputs[0]),
+    .run = &ctrl_manual_run
+};
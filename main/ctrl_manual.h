@@ -7,8 +7,17 @@
 extern "C" {
 #endif
 
-void ctrl_manual_initialize();
-void ctrl_manual_task();
+#include "model.h"
+
+#include "ctrl.h"
+
+/** Manual control state of a zone */
+typedef struct
+{
+    model_control_mode_t control_mode;
+} ctrl_manual_state_t;
+
+extern const ctrl_stage_t ctrl_manual_stage;
 
 #ifdef __cplusplus
 }
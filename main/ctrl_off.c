@@ -6,7 +6,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 #include "pubsub.h"
 
@@ -14,40 +13,49 @@
 
 #include "ctrl_off.h"
 #include "ctrl.h"
+#include "ctrl_zone.h"
 
-static const char *TAG = "ctrl_off";
+/** input change bits, in order of inputs */
+#define CTRL_OFF_CONTROL_MODE (1 << 0)
 
-static QueueHandle_t control_mode_queue;
-
-void ctrl_off_task()
+static void ctrl_off_run(ctrl_zone_t *zone, uint32_t changes)
 {
-    pubsub_message_t message;
-
-    if (xQueueReceive(control_mode_queue, &message, 0)) {
-        model_control_mode_t control_mode = message.int_val;
+    if (changes & CTRL_OFF_CONTROL_MODE) {
+        int64_t int_val;
+        MODEL_ZONE_LAST_INT(zone->topics, CONTROL_MODE, &int_val);
+        model_control_mode_t control_mode = int_val;
         if (control_mode == MODEL_CONTROL_MODE_OFF) {
-            pubsub_publish_bool(MODEL_LIGHT_SV, false);
-            pubsub_publish_bool(MODEL_LIGHT, false);
-            pubsub_publish_bool(MODEL_EXHAUST_SV, false);
-            pubsub_publish_bool(MODEL_EXHAUST, false);
-            pubsub_publish_bool(MODEL_RECIRC_SV, false);
-            pubsub_publish_bool(MODEL_RECIRC, false);
-            pubsub_publish_bool(MODEL_HEATER_SV, false);
-            pubsub_publish_bool(MODEL_HEATER, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, LIGHT_SV, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, LIGHT_DEMAND, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, EXHAUST_SV, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, EXHAUST_DEMAND, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, RECIRC_SV, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, RECIRC_DEMAND, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, HEATER_SV, false);
+            MODEL_ZONE_PUBLISH_BOOL(zone->topics, HEATER_DEMAND, false);
         }
     }
 }
 
-static void ctrl_off_subscribe()
-{
-    control_mode_queue = xQueueCreate(CTRL_QUEUE_DEPTH, sizeof(pubsub_message_t));
-    pubsub_add_subscription(control_mode_queue, MODEL_CONTROL_MODE, true);
-}
-
-void ctrl_off_initialize()
-{
-    ESP_LOGD(TAG, "ctrl_off_initialize");
-
-    ctrl_off_subscribe();
-}
-
+static const model_topic_id_t ctrl_off_inputs[] = {
+    MODEL_CONTROL_MODE_ID
+};
+static const model_topic_id_t ctrl_off_outputs[] = {
+    MODEL_LIGHT_SV_ID,
+    MODEL_LIGHT_DEMAND_ID,
+    MODEL_EXHAUST_SV_ID,
+    MODEL_EXHAUST_DEMAND_ID,
+    MODEL_RECIRC_SV_ID,
+    MODEL_RECIRC_DEMAND_ID,
+    MODEL_HEATER_SV_ID,
+    MODEL_HEATER_DEMAND_ID
+};
+
+const ctrl_stage_t ctrl_off_stage = {
+    .name = "ctrl_off",
+    .inputs = ctrl_off_inputs,
+    .input_count = sizeof(ctrl_off_inputs) / sizeof(ctrl_off_inputs[0]),
+    .outputs = ctrl_off_outputs,
+    .output_count = sizeof(ctrl_off_outputs) / sizeof(ctrl_off_outputs[0]),
+    .run = &ctrl_off_run
+};
@@ -7,8 +7,9 @@
 extern "C" {
 #endif
 
-void ctrl_off_initialize();
-void ctrl_off_task();
+#include "ctrl.h"
+
+extern const ctrl_stage_t ctrl_off_stage;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,170 @@
+// The author disclaims copyright to this source code.
+
+#include <stdbool.h>
+
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "clock.h"
+#include "pubsub.h"
+
+#include "model.h"
+
+#include "ctrl_output.h"
+#include "ctrl.h"
+#include "ctrl_zone.h"
+
+/**
+ * Actuator outputs follow the demand of the control mode,
+ * a switch waits until the output was on for min on time or off for min off time.
+ * Protects relays and compressors against short cycling.
+ * The first demand and switching off in control mode off do not wait.
+ */
+
+/** input change bits, in order of inputs */
+#define CTRL_OUTPUT_CONTROL_MODE (1 << 0)
+/** per actuator, in order of ctrl_output_t */
+#define CTRL_OUTPUT_DEMAND(output) (1 << (1 + 3 * (output)))
+#define CTRL_OUTPUT_MIN_ON(output) (1 << (2 + 3 * (output)))
+#define CTRL_OUTPUT_MIN_OFF(output) (1 << (3 + 3 * (output)))
+
+#define CTRL_OUTPUT_SECOND_US 1000000LL
+
+/** Topics of an actuator */
+typedef struct
+{
+    model_topic_id_t demand;
+    model_topic_id_t min_on;
+    model_topic_id_t min_off;
+    model_topic_id_t output;
+} ctrl_output_topics_t;
+
+static const ctrl_output_topics_t ctrl_output_topics[CTRL_OUTPUT_COUNT] = {
+    [CTRL_OUTPUT_EXHAUST] = { MODEL_EXHAUST_DEMAND_ID, MODEL_EXHAUST_MIN_ON_ID, MODEL_EXHAUST_MIN_OFF_ID, MODEL_EXHAUST_ID },
+    [CTRL_OUTPUT_HEATER] = { MODEL_HEATER_DEMAND_ID, MODEL_HEATER_MIN_ON_ID, MODEL_HEATER_MIN_OFF_ID, MODEL_HEATER_ID },
+    [CTRL_OUTPUT_LIGHT] = { MODEL_LIGHT_DEMAND_ID, MODEL_LIGHT_MIN_ON_ID, MODEL_LIGHT_MIN_OFF_ID, MODEL_LIGHT_ID },
+    [CTRL_OUTPUT_RECIRC] = { MODEL_RECIRC_DEMAND_ID, MODEL_RECIRC_MIN_ON_ID, MODEL_RECIRC_MIN_OFF_ID, MODEL_RECIRC_ID }
+};
+
+/**
+ * @return true if output of actuator differs from its demand.
+ */
+static bool ctrl_output_pending(const ctrl_output_actuator_t *actuator)
+{
+    return actuator->valid && (actuator->switched == 0 || actuator->demand != actuator->output);
+}
+
+/**
+ * @return earliest time output of a pending actuator may switch [us].
+ */
+static int64_t ctrl_output_due(const ctrl_output_state_t *state, const ctrl_output_actuator_t *actuator)
+{
+    if (actuator->switched == 0) {
+        return 0;
+    }
+    if (state->control_mode == MODEL_CONTROL_MODE_OFF && !actuator->demand) {
+        return 0;
+    }
+    return actuator->switched + (actuator->output ? actuator->min_on : actuator->min_off);
+}
+
+static void ctrl_output_read_time(pubsub_topic_t topic, int64_t *value)
+{
+    int64_t seconds;
+    if (pubsub_last_int_h(topic, &seconds)) {
+        *value = (seconds > 0 ? seconds : 0) * CTRL_OUTPUT_SECOND_US;
+    }
+}
+
+static void ctrl_output_run(ctrl_zone_t *zone, uint32_t changes)
+{
+    ctrl_output_state_t *state = &zone->output;
+
+    if (changes & CTRL_OUTPUT_CONTROL_MODE) {
+        int64_t int_val;
+        MODEL_ZONE_LAST_INT(zone->topics, CONTROL_MODE, &int_val);
+        state->control_mode = int_val;
+    }
+
+    int64_t now = clock_now();
+    for (int index = 0; index < CTRL_OUTPUT_COUNT; index++) {
+        ctrl_output_actuator_t *actuator = &state->actuators[index];
+        const ctrl_output_topics_t *topics = &ctrl_output_topics[index];
+
+        if (changes & CTRL_OUTPUT_DEMAND(index)) {
+            bool demand;
+            if (pubsub_last_bool_h(zone->topics[topics->demand], &demand)) {
+                if (actuator->valid && demand != actuator->demand) {
+                    zone->switches.demand_switches[index]++;
+                }
+                actuator->demand = demand;
+                actuator->valid = true;
+            }
+        }
+        if (changes & CTRL_OUTPUT_MIN_ON(index)) {
+            ctrl_output_read_time(zone->topics[topics->min_on], &actuator->min_on);
+        }
+        if (changes & CTRL_OUTPUT_MIN_OFF(index)) {
+            ctrl_output_read_time(zone->topics[topics->min_off], &actuator->min_off);
+        }
+
+        if (ctrl_output_pending(actuator) && ctrl_output_due(state, actuator) <= now) {
+            if (actuator->switched != 0) {
+                zone->switches.output_switches[index]++;
+            }
+            actuator->output = actuator->demand;
+            actuator->switched = now;
+            pubsub_publish_bool_h(zone->topics[topics->output], actuator->output);
+        }
+    }
+}
+
+static int64_t ctrl_output_deadline(const ctrl_zone_t *zone)
+{
+    const ctrl_output_state_t *state = &zone->output;
+    int64_t deadline = 0;
+    for (int index = 0; index < CTRL_OUTPUT_COUNT; index++) {
+        const ctrl_output_actuator_t *actuator = &state->actuators[index];
+        if (ctrl_output_pending(actuator)) {
+            int64_t due = ctrl_output_due(state, actuator);
+            if (deadline == 0 || due < deadline) {
+                deadline = due;
+            }
+        }
+    }
+    return deadline;
+}
+
+static const model_topic_id_t ctrl_output_inputs[] = {
+    MODEL_CONTROL_MODE_ID,
+    MODEL_EXHAUST_DEMAND_ID,
+    MODEL_EXHAUST_MIN_ON_ID,
+    MODEL_EXHAUST_MIN_OFF_ID,
+    MODEL_HEATER_DEMAND_ID,
+    MODEL_HEATER_MIN_ON_ID,
+    MODEL_HEATER_MIN_OFF_ID,
+    MODEL_LIGHT_DEMAND_ID,
+    MODEL_LIGHT_MIN_ON_ID,
+    MODEL_LIGHT_MIN_OFF_ID,
+    MODEL_RECIRC_DEMAND_ID,
+    MODEL_RECIRC_MIN_ON_ID,
+    MODEL_RECIRC_MIN_OFF_ID
+};
+static const model_topic_id_t ctrl_output_outputs[] = {
+    MODEL_EXHAUST_ID,
+    MODEL_HEATER_ID,
+    MODEL_LIGHT_ID,
+    MODEL_RECIRC_ID
+};
+
+const ctrl_stage_t ctrl_output_stage = {
+    .name = "ctrl_output",
+    .inputs = ctrl_output_inputs,
+    .input_count = sizeof(ctrl_output_inputs) / sizeof(ctrl_output_inputs[0]),
+    .outputs = ctrl_output_outputs,
+    .output_count = sizeof(ctrl_output_outputs) / sizeof(ctrl_output_outputs[0]),
+    .run = &ctrl_output_run,
+    .deadline = &ctrl_output_deadline
+};
@@ -0,0 +1,46 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _CTRL_OUTPUT_H_
+#define _CTRL_OUTPUT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+
+#include "ctrl.h"
+
+/** Actuator output of a zone */
+typedef struct
+{
+    /** demand received */
+    bool valid;
+    /** demand of the control mode */
+    bool demand;
+    /** published output */
+    bool output;
+    /** time of last output publish [us], 0 if never published */
+    int64_t switched;
+    /** minimum on and off time [us] */
+    int64_t min_on;
+    int64_t min_off;
+} ctrl_output_actuator_t;
+
+/** Actuator output state of a zone */
+typedef struct
+{
+    model_control_mode_t control_mode;
+    ctrl_output_actuator_t actuators[CTRL_OUTPUT_COUNT];
+} ctrl_output_state_t;
+
+extern const ctrl_stage_t ctrl_output_stage;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CTRL_OUTPUT_H_ */
@@ -0,0 +1,53 @@
+// The author disclaims copyright to this source code.
+
+#ifndef _CTRL_ZONE_H_
+#define _CTRL_ZONE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "pubsub.h"
+
+#include "model.h"
+
+#include "ctrl.h"
+#include "ctrl_circadian.h"
+#include "ctrl_day_night.h"
+#include "ctrl_auto.h"
+#include "ctrl_heater.h"
+#include "ctrl_manual.h"
+#include "ctrl_off.h"
+#include "ctrl_output.h"
+
+/** Stages per zone */
+#define CTRL_STAGE_COUNT 7
+
+/**
+ * Control zone, one grow space.
+ * All zones are one array, the ctrl task runs the stages of each zone with changed inputs.
+ */
+struct ctrl_zone
+{
+    /** zone index, see model_zone */
+    uint8_t zone;
+    /** topic handles, indexed by MODEL_<id>_ID */
+    const pubsub_topic_t *topics;
+    /** input subscription per stage, in run order */
+    pubsub_latest_t *latest[CTRL_STAGE_COUNT];
+    ctrl_circadian_state_t circadian;
+    ctrl_day_night_state_t day_night;
+    ctrl_auto_state_t automatic;
+    ctrl_heater_state_t heater;
+    ctrl_manual_state_t manual;
+    ctrl_output_state_t output;
+    ctrl_switch_stats_t switches;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CTRL_ZONE_H_ */
@@ -51,6 +51,7 @@ static lv_obj_t *hmi_led_recirculation_switch;
  * you should lock on the very same semaphore!
  *
  * Use hmi_semaphore_take and hmi_semaphore_give.
+ * Recursive, a batch of hmi_set_* calls can be made under one take.
  */
 static SemaphoreHandle_t hmi_semaphore = 0;
 
@@ -190,7 +191,7 @@ static void hmi_task(void *pvParameter)
 void hmi_initialize()
 {
 
-    hmi_semaphore = xSemaphoreCreateMutex();
+    hmi_semaphore = xSemaphoreCreateRecursiveMutex();
     lv_init();
 
     /* the display driver */
@@ -246,7 +247,7 @@ void hmi_set_current_time(time_t timestamp)
 bool hmi_semaphore_take(const char *function_name)
 {
     bool success;
-    if (xSemaphoreTake(hmi_semaphore, HMI_SEMAPHORE_TICKS)) {
+    if (xSemaphoreTakeRecursive(hmi_semaphore, HMI_SEMAPHORE_TICKS)) {
         success = true;
     } else {
         success = false;
@@ -257,7 +258,7 @@ bool hmi_semaphore_take(const char *function_name)
 
 void hmi_semaphore_give()
 {
-    xSemaphoreGive(hmi_semaphore);
+    xSemaphoreGiveRecursive(hmi_semaphore);
 }
 
 void hmi_set_control_mode(hmi_control_mode_t mode)
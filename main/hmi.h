@@ -29,7 +29,7 @@ extern "C" {
 typedef void (*hmi_bool_callback_t)(bool value);
 typedef void (*hmi_int_callback_t)(uint64_t value);
 typedef void (*hmi_time_callback_t)(time_t time);
-typedef void (*hmi_double_callback_t)(double value);
+typedef void (*hmi_float_callback_t)(float value);
 
 typedef enum
 {
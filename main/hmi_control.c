@@ -13,8 +13,8 @@ static const char *TAG = "hmi_control";
 typedef struct
 {
     lv_obj_t *bar;
-    double bar_bias;
-    double bar_gain;
+    float bar_bias;
+    float bar_gain;
     char *format_sv;
     char *format_pv;
     char *format_minmax;
@@ -46,10 +46,10 @@ static hmi_bool_callback_t hmi_control_recirc_sv_callback;
 /**
  * Calculate fraction of value on control bar.
  */
-static double hmi_control_bar_fraction(hmi_control_t *control, double value)
+static float hmi_control_bar_fraction(hmi_control_t *control, float value)
 {
 
-    double fraction = (value + control->bar_bias) * control->bar_gain;
+    float fraction = (value + control->bar_bias) * control->bar_gain;
     ESP_LOGD(TAG, "hmi_control_bar_fraction, value:%lf, bias:%lf, gain:%lf, fraction:%lf", value, control->bar_bias, control->bar_gain, fraction);
     return fraction;
 }
@@ -57,27 +57,27 @@ static double hmi_control_bar_fraction(hmi_control_t *control, double value)
 /**
  * Calculate value on control bar.
  */
-static int16_t hmi_control_bar_value(hmi_control_t *control, double value)
+static int16_t hmi_control_bar_value(hmi_control_t *control, float value)
 {
 
-    return hmi_control_bar_fraction(control, value) * 100.0;
+    return hmi_control_bar_fraction(control, value) * 100.0f;
 }
 
 /**
  * Calculate location of value on control bar.
  */
-static lv_coord_t hmi_control_get_y(hmi_control_t *control, double value)
+static lv_coord_t hmi_control_get_y(hmi_control_t *control, float value)
 {
 
     lv_obj_t *bar = control->bar;
     lv_coord_t y = lv_obj_get_y(bar);
     lv_coord_t height = lv_obj_get_height(bar);
 
-    double fraction = hmi_control_bar_fraction(control, value);
+    float fraction = hmi_control_bar_fraction(control, value);
     return y + height - (fraction * height) - 5;
 }
 
-static void hmi_control_set_pv(hmi_control_t *target, double pv)
+static void hmi_control_set_pv(hmi_control_t *target, float pv)
 {
     if (hmi_semaphore_take("hmi_control_set_pv")) {
 
@@ -97,7 +97,7 @@ static void hmi_control_set_pv(hmi_control_t *target, double pv)
     }
 }
 
-static void hmi_control_set_sv(hmi_control_t *target, double sv)
+static void hmi_control_set_sv(hmi_control_t *target, float sv)
 {
     if (hmi_semaphore_take("hmi_control_set_sv")) {
 
@@ -139,7 +139,7 @@ static void hmi_control_set_lo(hmi_control_t *target, bool lo)
 }
 
 static void hmi_control_create_control(hmi_control_t *target, lv_obj_t *parent, lv_coord_t x, lv_coord_t y, lv_coord_t w,
-        lv_coord_t h, const char *name, double min, double max, int decimals)
+        lv_coord_t h, const char *name, float min, float max, int decimals)
 {
 
     lv_obj_t *control = lv_cont_create(parent, NULL);
@@ -173,7 +173,7 @@ static void hmi_control_create_control(hmi_control_t *target, lv_obj_t *parent,
     lv_obj_set_size(bar, bar_width, label_lo_coords.y1 - label_hi_coords.y2 - 10);
     // use bias and scale to convert value to [0.0, 1.0] range
     target->bar_bias = -min;
-    target->bar_gain = 1.0 / (max - min);
+    target->bar_gain = 1.0f / (max - min);
     lv_bar_set_type(bar, LV_BAR_TYPE_NORMAL);
     lv_bar_set_range(bar, 0, 100);
     lv_obj_align(bar, label_hi, LV_ALIGN_OUT_BOTTOM_MID, 0, HMI_MARGIN);
@@ -372,13 +372,13 @@ void hmi_control_set_control_mode_callback(hmi_control_mode_callback_t callback)
     hmi_control_mode_callback = callback;
 }
 
-void hmi_control_set_temp_pv(double pv)
+void hmi_control_set_temp_pv(float pv)
 {
     // model in K, display in C
-    hmi_control_set_pv(&hmi_control_temperature, pv - 273.15);
+    hmi_control_set_pv(&hmi_control_temperature, pv - 273.15f);
 }
 
-void hmi_control_set_temp_sv(double sv)
+void hmi_control_set_temp_sv(float sv)
 {
     hmi_control_set_sv(&hmi_control_temperature, sv);
 }
@@ -393,12 +393,12 @@ void hmi_control_set_temp_lo(bool lo)
     hmi_control_set_lo(&hmi_control_temperature, lo);
 }
 
-void hmi_control_set_hum_pv(double pv)
+void hmi_control_set_hum_pv(float pv)
 {
     hmi_control_set_pv(&hmi_control_humidity, pv);
 }
 
-void hmi_control_set_hum_sv(double sv)
+void hmi_control_set_hum_sv(float sv)
 {
     hmi_control_set_sv(&hmi_control_humidity, sv);
 }
@@ -413,12 +413,12 @@ void hmi_control_set_hum_lo(bool lo)
     hmi_control_set_lo(&hmi_control_humidity, lo);
 }
 
-void hmi_control_set_co2_pv(double pv)
+void hmi_control_set_co2_pv(float pv)
 {
     hmi_control_set_pv(&hmi_control_co2, pv);
 }
 
-void hmi_control_set_co2_sv(double sv)
+void hmi_control_set_co2_sv(float sv)
 {
     hmi_control_set_sv(&hmi_control_co2, sv);
 }
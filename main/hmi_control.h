@@ -23,18 +23,18 @@ typedef void (*hmi_control_mode_callback_t)(hmi_control_mode_t mode);
 
 lv_obj_t* hmi_control_create_tab(lv_obj_t *parent);
 
-void hmi_control_set_temp_pv(double pv);
-void hmi_control_set_temp_sv(double sv);
+void hmi_control_set_temp_pv(float pv);
+void hmi_control_set_temp_sv(float sv);
 void hmi_control_set_temp_hi(bool hi);
 void hmi_control_set_temp_lo(bool lo);
 
-void hmi_control_set_hum_pv(double pv);
-void hmi_control_set_hum_sv(double sv);
+void hmi_control_set_hum_pv(float pv);
+void hmi_control_set_hum_sv(float sv);
 void hmi_control_set_hum_hi(bool hi);
 void hmi_control_set_hum_lo(bool lo);
 
-void hmi_control_set_co2_pv(double pv);
-void hmi_control_set_co2_sv(double sv);
+void hmi_control_set_co2_pv(float pv);
+void hmi_control_set_co2_sv(float sv);
 void hmi_control_set_co2_hi(bool hi);
 void hmi_control_set_co2_lo(bool lo);
 
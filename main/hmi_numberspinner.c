@@ -10,10 +10,10 @@ static void hmi_numberspinner_increment_event_cb(lv_obj_t *btn, lv_event_t e)
         hmi_numberspinner_t *spinner = (hmi_numberspinner_t*) btn->user_data;
         if (spinner->callback != NULL) {
             // to next granularity
-            double value = spinner->value;
+            float value = spinner->value;
             uint32_t multiples = (int) (value / spinner->granularity);
-            double rounded = spinner->granularity * multiples;
-            double next = rounded + spinner->granularity;
+            float rounded = spinner->granularity * multiples;
+            float next = rounded + spinner->granularity;
             // limit to boundary
             if (next > spinner->max) {
                 next = spinner->max;
@@ -29,10 +29,10 @@ static void hmi_numberspinner_decrement_event_cb(lv_obj_t *btn, lv_event_t e)
         hmi_numberspinner_t *spinner = (hmi_numberspinner_t*) btn->user_data;
         if (spinner->callback != NULL) {
             // to previous granularity
-            double value = spinner->value;
+            float value = spinner->value;
             int multiples = (int) (value / spinner->granularity);
-            double rounded = spinner->granularity * multiples;
-            double prev = rounded - spinner->granularity;
+            float rounded = spinner->granularity * multiples;
+            float prev = rounded - spinner->granularity;
             // limit to boundary
             if (prev < spinner->min) {
                 prev = spinner->min;
@@ -42,8 +42,8 @@ static void hmi_numberspinner_decrement_event_cb(lv_obj_t *btn, lv_event_t e)
     }
 }
 
-void hmi_numberspinner_create(lv_obj_t *parent, lv_coord_t x, lv_coord_t y, lv_coord_t width, lv_coord_t height, double min,
-        double max, double granularity, char *representation, size_t representation_size, char *representation_format,
+void hmi_numberspinner_create(lv_obj_t *parent, lv_coord_t x, lv_coord_t y, lv_coord_t width, lv_coord_t height, float min,
+        float max, float granularity, char *representation, size_t representation_size, char *representation_format,
         hmi_numberspinner_t *spinner)
 {
     lv_coord_t button_width = height;
@@ -84,7 +84,7 @@ void hmi_numberspinner_create(lv_obj_t *parent, lv_coord_t x, lv_coord_t y, lv_c
     lv_obj_align(label, btn_min, LV_ALIGN_OUT_RIGHT_MID, 0, 0);
 }
 
-void hmi_numberspinner_set_value(hmi_numberspinner_t *spinner, double value)
+void hmi_numberspinner_set_value(hmi_numberspinner_t *spinner, float value)
 {
     if (hmi_semaphore_take("hmi_numberspinner_set_value")) {
 
@@ -15,21 +15,21 @@ extern "C" {
 typedef struct
 {
     lv_obj_t *label;
-    double value;
-    double min;
-    double max;
-    double granularity;
+    float value;
+    float min;
+    float max;
+    float granularity;
     char *representation;
     size_t representation_size;
     char *representation_format;
-    hmi_double_callback_t callback;
+    hmi_float_callback_t callback;
 } hmi_numberspinner_t;
 
-void hmi_numberspinner_create(lv_obj_t *parent, lv_coord_t x, lv_coord_t y, lv_coord_t width, lv_coord_t height, double min,
-        double max, double granularity, char *representation, size_t representation_size, char *representation_format,
+void hmi_numberspinner_create(lv_obj_t *parent, lv_coord_t x, lv_coord_t y, lv_coord_t width, lv_coord_t height, float min,
+        float max, float granularity, char *representation, size_t representation_size, char *representation_format,
         hmi_numberspinner_t *spinner);
 
-void hmi_numberspinner_set_value(hmi_numberspinner_t *spinner, double value);
+void hmi_numberspinner_set_value(hmi_numberspinner_t *spinner, float value);
 
 #ifdef __cplusplus
 }
@@ -218,62 +218,62 @@ void hmi_settings_set_begin_of_night_callback(hmi_time_callback_t callback)
     hmi_timespinner_begin_of_night.callback = callback;
 }
 
-void hmi_settings_set_temp_day(double value)
+void hmi_settings_set_temp_day(float value)
 {
     hmi_numberspinner_set_value(&hmi_numberspinner_day_temperature, value);
 }
 
-void hmi_settings_set_temp_day_callback(hmi_double_callback_t callback)
+void hmi_settings_set_temp_day_callback(hmi_float_callback_t callback)
 {
     hmi_numberspinner_day_temperature.callback = callback;
 }
 
-void hmi_settings_set_temp_night(double value)
+void hmi_settings_set_temp_night(float value)
 {
     hmi_numberspinner_set_value(&hmi_numberspinner_night_temperature, value);
 }
 
-void hmi_settings_set_temp_night_callback(hmi_double_callback_t callback)
+void hmi_settings_set_temp_night_callback(hmi_float_callback_t callback)
 {
     hmi_numberspinner_night_temperature.callback = callback;
 }
 
-void hmi_settings_set_hum_day(double value)
+void hmi_settings_set_hum_day(float value)
 {
     hmi_numberspinner_set_value(&hmi_numberspinner_day_humidity, value);
 }
 
-void hmi_settings_set_hum_day_callback(hmi_double_callback_t callback)
+void hmi_settings_set_hum_day_callback(hmi_float_callback_t callback)
 {
     hmi_numberspinner_day_humidity.callback = callback;
 }
 
-void hmi_settings_set_hum_night(double value)
+void hmi_settings_set_hum_night(float value)
 {
     hmi_numberspinner_set_value(&hmi_numberspinner_night_humidity, value);
 }
 
-void hmi_settings_set_hum_night_callback(hmi_double_callback_t callback)
+void hmi_settings_set_hum_night_callback(hmi_float_callback_t callback)
 {
     hmi_numberspinner_night_humidity.callback = callback;
 }
 
-void hmi_settings_set_co2_day(double value)
+void hmi_settings_set_co2_day(float value)
 {
     hmi_numberspinner_set_value(&hmi_numberspinner_day_co2, value);
 }
 
-void hmi_settings_set_co2_day_callback(hmi_double_callback_t callback)
+void hmi_settings_set_co2_day_callback(hmi_float_callback_t callback)
 {
     hmi_numberspinner_day_co2.callback = callback;
 }
 
-void hmi_settings_set_co2_night(double value)
+void hmi_settings_set_co2_night(float value)
 {
     hmi_numberspinner_set_value(&hmi_numberspinner_night_co2, value);
 }
 
-void hmi_settings_set_co2_night_callback(hmi_double_callback_t callback)
+void hmi_settings_set_co2_night_callback(hmi_float_callback_t callback)
 {
     hmi_numberspinner_night_co2.callback = callback;
 }
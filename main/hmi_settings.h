@@ -28,23 +28,23 @@ void hmi_settings_set_begin_of_day_callback(hmi_time_callback_t callback);
 void hmi_settings_set_begin_of_night(time_t timestamp);
 void hmi_settings_set_begin_of_night_callback(hmi_time_callback_t callback);
 
-void hmi_settings_set_temp_day(double value);
-void hmi_settings_set_temp_day_callback(hmi_double_callback_t callback);
+void hmi_settings_set_temp_day(float value);
+void hmi_settings_set_temp_day_callback(hmi_float_callback_t callback);
 
-void hmi_settings_set_temp_night(double value);
-void hmi_settings_set_temp_night_callback(hmi_double_callback_t callback);
+void hmi_settings_set_temp_night(float value);
+void hmi_settings_set_temp_night_callback(hmi_float_callback_t callback);
 
-void hmi_settings_set_hum_day(double value);
-void hmi_settings_set_hum_day_callback(hmi_double_callback_t callback);
+void hmi_settings_set_hum_day(float value);
+void hmi_settings_set_hum_day_callback(hmi_float_callback_t callback);
 
-void hmi_settings_set_hum_night(double value);
-void hmi_settings_set_hum_night_callback(hmi_double_callback_t callback);
+void hmi_settings_set_hum_night(float value);
+void hmi_settings_set_hum_night_callback(hmi_float_callback_t callback);
 
-void hmi_settings_set_co2_day(double value);
-void hmi_settings_set_co2_day_callback(hmi_double_callback_t callback);
+void hmi_settings_set_co2_day(float value);
+void hmi_settings_set_co2_day_callback(hmi_float_callback_t callback);
 
-void hmi_settings_set_co2_night(double value);
-void hmi_settings_set_co2_night_callback(hmi_double_callback_t callback);
+void hmi_settings_set_co2_night(float value);
+void hmi_settings_set_co2_night_callback(hmi_float_callback_t callback);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,7 @@
 
 extern "C" {
 
+#include <stdio.h>
 #include <string.h>
 
 #include "driver/spi_master.h"
@@ -12,8 +13,12 @@ extern "C" {
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 
-#include "pubsub.h"
+#include "binlog.h"
+#include "clock.h"
+#include "pubsub.hpp"
 #include "pubsub_test.h"
+#include "pubsub_benchmark.h"
+#include "pubsub_trace.h"
 #include "LED.h"
 #include "DO.h"
 #include "AM2301.h"
@@ -26,6 +31,7 @@ extern "C" {
 #include "bind.h"
 #include "ctrl.h"
 #include "NVS.h"
+#include "ctrl_benchmark.h"
 
 #define TAG "main"
 
@@ -57,12 +63,27 @@ extern "C" {
 #define AM2301_MEASUREMENT_PERIOD_MS 60000
 #define MHZ19B_MEASUREMENT_PERIOD_MS 120000
 #define NVS_HOLD_OFF_MS (60 * 1000)
+/** MCP23S17 output bits per zone */
+#define IOX_ZONE_BITS 4
+#define STATS_PERIOD CLOCK_MS(60 * 60 * 1000)
 /**
  * Limit for non-DMA SPI transfers.
  * Can not use DMA because need HALF DUPLEX transfers to avoid data corruption.
  */
 #define MAX_TRANSFER_SIZE 64
 
+static_assert(MODEL_ZONE_COUNT * IOX_ZONE_BITS <= 16, "MCP23S17 output bits for all zones");
+
+/**
+ * pubsub subscriptions wired by app_main: bind, LED, DS3234, the status log and the trace dump once,
+ * the ctrl task, NVS and MCP23S17 outputs per zone, the shared persistent topics in the NVS of zone 1.
+ */
+#define MAIN_SUBSCRIPTIONS (BIND_SUBSCRIPTIONS + 4 + MODEL_PERSIST_COUNT - MODEL_ZONE_PERSIST_COUNT \
+        + MODEL_ZONE_COUNT * (CTRL_ZONE_SUBSCRIPTIONS + MODEL_ZONE_PERSIST_COUNT + IOX_ZONE_BITS))
+static_assert(MAIN_SUBSCRIPTIONS <= PUBSUB_MAX_SUBSCRIBERS, "PUBSUB_MAX_SUBSCRIBERS too small for CTRL_ZONES zones");
+static_assert(BIND_LATEST + MODEL_ZONE_COUNT * CTRL_ZONE_LATEST <= PUBSUB_MAX_LATEST,
+        "PUBSUB_MAX_LATEST too small for CTRL_ZONES zones");
+
 LED led;
 AM2301 am2301;
 DS3234 ds3234;
@@ -70,28 +91,35 @@ DO light;
 DO exhaust;
 DO recirc;
 DO heater;
-NVS nvs;
+NVS nvs[MODEL_ZONE_COUNT];
 MHZ19B mhz19b;
 MCP23S17 iox;
 
 void nvs_setup()
 {
-    const char *nvs_settings[] { //
-    MODEL_BEGIN_OF_DAY, //
-            MODEL_BEGIN_OF_NIGHT, //
-            MODEL_CO2_SV_DAY, //
-            MODEL_CO2_SV_NIGHT, //
-            MODEL_HUM_SV_DAY, //
-            MODEL_HUM_SV_NIGHT, //
-            MODEL_TEMP_SV_DAY, //
-            MODEL_TEMP_SV_NIGHT, //
-            MODEL_EXHAUST_SV, //
-            MODEL_HEATER_SV, //
-            MODEL_LIGHT_SV, //
-            MODEL_RECIRC_SV //
-    };
-
-    nvs.setup("settings", nvs_settings, sizeof(nvs_settings) / sizeof(nvs_settings[0]), NVS_HOLD_OFF_MS);
+    // persistent topics from the model topic table
+    static const char *nvs_settings[MODEL_ZONE_COUNT][MODEL_TOPIC_COUNT];
+    // zone 1 in "settings", zone n in "zone<n>" with the keys of zone 1
+    static char nvs_namespaces[MODEL_ZONE_COUNT][NVS_KEY_NAME_MAX_SIZE];
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        const pubsub_topic_t *topics = model_zone(zone);
+        size_t count = 0;
+        size_t key_offset = 0;
+        for (int id = 0; id < MODEL_TOPIC_COUNT; id++) {
+            uint8_t flags = model_topics[id].flags;
+            if ((flags & MODEL_FLAG_PERSIST) && (zone == 0 || (flags & MODEL_FLAG_ZONE))) {
+                const char *name = pubsub_topic_name(topics[id]);
+                key_offset = strlen(name) - strlen(model_topics[id].name);
+                nvs_settings[zone][count++] = name;
+            }
+        }
+        if (zone == 0) {
+            strcpy(nvs_namespaces[zone], "settings");
+        } else {
+            snprintf(nvs_namespaces[zone], sizeof(nvs_namespaces[zone]), "zone%d", zone + 1);
+        }
+        nvs[zone].setup(nvs_namespaces[zone], nvs_settings[zone], count, NVS_HOLD_OFF_MS, key_offset);
+    }
 }
 
 void spi_setup()
@@ -116,16 +144,17 @@ void spi_setup()
 
 void iox_setup()
 {
-    const char *iox_bits[] {
-    // topic vs bits
-    // A0
-            MODEL_EXHAUST,
-            // A1
-            MODEL_HEATER,
-            // A2
-            MODEL_LIGHT,
-            // A3
-            MODEL_RECIRC };
+    // remaining bits are inputs
+    pubsub::Topic<bool> iox_bits[16];
+    // topic vs bits, zone 1 A0..A3, zone 2 A4..A7, zone 3 B0..B3, zone 4 B4..B7
+    // in each zone: exhaust, heater, light, recirculation
+    for (int zone = 0; zone < MODEL_ZONE_COUNT; zone++) {
+        pubsub::Topic<bool> *bits = &iox_bits[zone * IOX_ZONE_BITS];
+        bits[0] = MODEL_ZONE_TOPIC(zone, EXHAUST);
+        bits[1] = MODEL_ZONE_TOPIC(zone, HEATER);
+        bits[2] = MODEL_ZONE_TOPIC(zone, LIGHT);
+        bits[3] = MODEL_ZONE_TOPIC(zone, RECIRC);
+    }
 
     iox.setup(SPI_HOST_A, GPIO_MCP23S17_CS, MCP23S17_HOST_ADDR, iox_bits);
 }
@@ -134,6 +163,9 @@ void app_main()
 {
     ESP_LOGI(TAG, "app_main");
 
+    // first, components log to the binary log from the start
+    binlog_initialize();
+
     BaseType_t ret = gpio_install_isr_service(
     ESP_INTR_FLAG_LEVEL3 | ESP_INTR_FLAG_IRAM);
     if (ret != ESP_OK) {
@@ -153,60 +185,94 @@ void app_main()
         return;
     }
 
+#ifdef CONFIG_PUBSUB_STRESS_TEST
+    succes = pubsub_stress_test();
+    if (succes) {
+        ESP_LOGI(TAG, "pubsub_stress_test succes");
+    } else {
+        ESP_LOGE(TAG, "pubsub_stress_test failed (FATAL)");
+        return;
+    }
+#endif
+
+#ifdef CONFIG_CTRL_BENCHMARK
+    ctrl_benchmark();
+#endif
+
     model_initialize();
+
+#ifdef CONFIG_PUBSUB_BENCHMARK
+    // after the model topics, the registry benchmark takes only what is left
+    pubsub_benchmark();
+#endif
+
     bind_initialize();
     ctrl_initialize();
 
     spi_setup();
     iox_setup();
 
-    led.setup(GPIO_LED, true, MODEL_ACTIVITY);
+    led.setup(GPIO_LED, true, MODEL_TOPIC(ACTIVITY));
 
 // disabled needs to be connected through io expander
-//    light.setup(GPIO_LIGHT, true, MODEL_LIGHT);
-//    exhaust.setup(GPIO_EXHAUST, true, MODEL_EXHAUST);
-//    recirc.setup(GPIO_RECIRC, true, MODEL_RECIRC);
-//    heater.setup(GPIO_HEATER, true, MODEL_HEATER);
+//    light.setup(GPIO_LIGHT, true, MODEL_TOPIC(LIGHT));
+//    exhaust.setup(GPIO_EXHAUST, true, MODEL_TOPIC(EXHAUST));
+//    recirc.setup(GPIO_RECIRC, true, MODEL_TOPIC(RECIRC));
+//    heater.setup(GPIO_HEATER, true, MODEL_TOPIC(HEATER));
 
     nvs_setup();
 
     // LOG: big queue not useful
-    QueueHandle_t log_queue = xQueueCreate(10, sizeof(pubsub_message_t));
-    if (log_queue == 0) {
+    pubsub::Subscription<int32_t> log_subscription;
+    if (!log_subscription.create(10)) {
         ESP_LOGE(TAG, "failed to create log queue (FATAL)");
         return;
     }
-    pubsub_add_subscription(log_queue, MODEL_AM2301_STATUS, false);
+    log_subscription.add(MODEL_TOPIC(AM2301_STATUS), false);
+    // most recent publishes on demand, for tools/pubsub_trace.py (CONFIG_PUBSUB_TRACE)
+    log_subscription.add(MODEL_TOPIC(TRACE_DUMP), false);
 
-    am2301.setup(GPIO_AM2301, MODEL_TEMP_PV, MODEL_HUM_PV, MODEL_AM2301_STATUS, MODEL_AM2301_TIMESTAMP,
-    AM2301_MEASUREMENT_PERIOD_MS);
+    am2301.setup(GPIO_AM2301, MODEL_TOPIC(TEMP_PV), MODEL_TOPIC(HUM_PV), MODEL_TOPIC(AM2301_STATUS),
+            MODEL_TOPIC(AM2301_TIMESTAMP), AM2301_MEASUREMENT_PERIOD_MS);
 
-    ds3234.setup(SPI_HOST_DS3234, GPIO_DS3234_CS, MODEL_CURRENT_TIME);
+    ds3234.setup(SPI_HOST_DS3234, GPIO_DS3234_CS, MODEL_TOPIC(CURRENT_TIME));
 
-    mhz19b.setup(UART_PORT_MHZ19B, GPIO_MHZ19B_RXD, GPIO_MHZ19B_RXD, MODEL_CO2_PV, MHZ19B_MEASUREMENT_PERIOD_MS);
+    mhz19b.setup(UART_PORT_MHZ19B, GPIO_MHZ19B_RXD, GPIO_MHZ19B_RXD, MODEL_TOPIC(CO2_PV), MHZ19B_MEASUREMENT_PERIOD_MS);
 
-    // universal mixed message type can be received only
-    pubsub_message_t log_message;
+    pubsub_capacity_t capacity;
+    pubsub_get_capacity(&capacity);
+    ESP_LOGI(TAG, "pubsub capacity, topics:%d/%d, subscribers:%d/%d, latest:%d/%d, patterns:%d/%d, names:%d/%d",
+            capacity.topics_used, capacity.topics_max, capacity.subscribers_used, capacity.subscribers_max, capacity.latest_used,
+            capacity.latest_max, capacity.patterns_used, capacity.patterns_max, capacity.names_used, capacity.names_max);
+    ESP_LOGI(TAG, "pubsub queue RAM:%u bytes (with full messages:%u bytes)", capacity.queue_bytes, capacity.queue_bytes_full);
+
+    pubsub_topic_t log_topic;
+    int32_t status;
+    int64_t stats_logged = clock_now();
 
     while (1) {
 
-        if (xQueueReceive(log_queue, &log_message, portMAX_DELAY)) {
+        if (clock_now() - stats_logged >= STATS_PERIOD) {
+            // delivery counts, to size queues
+            pubsub_log_stats();
+            stats_logged = clock_now();
+        }
+        if (log_subscription.receive(&log_topic, &status, portMAX_DELAY)) {
             // something
-            if (strcmp(log_message.topic, MODEL_AM2301_STATUS) == 0) {
-                int64_t status = log_message.int_val;
+            if (log_topic == MODEL_AM2301_STATUS_H) {
                 if (status == AM2301::result_status_t::RESULT_OK) {
 
                     ESP_LOGD(TAG, "AM2301 OK");
 
                     // blink 1x
-                    pubsub_publish_int(MODEL_ACTIVITY, 1);
+                    MODEL_PUBLISH_INT(ACTIVITY, 1);
 
                 } else if (status == AM2301::result_status_t::RESULT_RECOVERABLE) {
 
                     ESP_LOGW(TAG, "AM2301 RECOVERABLE");
 
                     // blink 2x
-                    pubsub_publish_int(MODEL_ACTIVITY, 2);
+                    MODEL_PUBLISH_INT(ACTIVITY, 2);
 
                 } else if (status == AM2301::result_status_t::RESULT_FATAL) {
 
@@ -216,8 +282,10 @@ void app_main()
 
                 } else {
                     // unknown
-                    ESP_LOGE(TAG, "AM2301 %lld", status);
+                    ESP_LOGE(TAG, "AM2301 %d", status);
                 }
+            } else if (log_topic == MODEL_TRACE_DUMP_H) {
+                pubsub_trace_dump();
             }
         }
     }
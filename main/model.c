@@ -1,119 +1,93 @@
 // The author disclaims copyright to this source code.
 
-#include "model.h"
-
-/******************
- * actuator state
- */
-
-const char *MODEL_ACTIVITY = "activity";
-
-const char *MODEL_EXHAUST = "exhaust.out";
-const char *MODEL_HEATER = "heater.out";
-const char *MODEL_LIGHT = "light.out";
-const char *MODEL_RECIRC = "recirc.out";
-
-/******************
- * sensor state
- */
-
-const char *MODEL_CURRENT_TIME = "time";
-
-const char *MODEL_AM2301_STATUS = "am2301.status";
-const char *MODEL_AM2301_TIMESTAMP = "am2301.time";
+#include <stdio.h>
 
-const char *MODEL_CO2_PV = "co2.pv";
-const char *MODEL_HUM_PV = "hum.pv";
-const char *MODEL_TEMP_PV = "temp.pv";
+#include "esp_log.h"
 
-/******************
- * controller state
- */
-
-const char *MODEL_CONTROL_MODE = "control.mode";
-
-const char *MODEL_CIRCADIAN = "circadian";
-
-const char *MODEL_CO2_SV = "co2.sv";
-const char *MODEL_HUM_SV = "hum.sv";
-const char *MODEL_TEMP_SV = "temp.sv";
-
-const char *MODEL_CO2_HI = "co2.hi";
-const char *MODEL_CO2_LO = "co2.lo";
-
-const char *MODEL_HUM_HI = "hum.hi";
-const char *MODEL_HUM_LO = "hum.lo";
-
-const char *MODEL_TEMP_HI = "temp.hi";
-const char *MODEL_TEMP_LO = "temp.lo";
+#include "model.h"
 
-/******************
- * setpoints
- * (user settings)
+static const char *TAG = "model";
+
+#define MODEL_TOPIC_DEFINE(id, name, type, flags) \
+    const char *MODEL_##id = name; \
+    pubsub_topic_t MODEL_##id##_H = PUBSUB_TOPIC_INVALID;
+MODEL_TOPICS(MODEL_TOPIC_DEFINE)
+#undef MODEL_TOPIC_DEFINE
+
+#define MODEL_TOPIC_DESCRIBE(id, name, type, flags) { name, MODEL_TYPE_##type, flags },
+const model_topic_t model_topics[MODEL_TOPIC_COUNT] = {
+    MODEL_TOPICS(MODEL_TOPIC_DESCRIBE)
+};
+#undef MODEL_TOPIC_DESCRIBE
+
+/** publish filters, indexed by MODEL_<id>_ID, zero is no filter */
+#define MODEL_TOPIC_FILTER(id, deadband, relative, min_interval_ms) [MODEL_##id##_ID] = { deadband, relative, min_interval_ms },
+static const pubsub_filter_t model_filters[MODEL_TOPIC_COUNT] = {
+    MODEL_FILTERS(MODEL_TOPIC_FILTER)
+};
+#undef MODEL_TOPIC_FILTER
+
+/** handle variables, indexed by MODEL_<id>_ID */
+#define MODEL_TOPIC_HANDLE(id, name, type, flags) &MODEL_##id##_H,
+static pubsub_topic_t *const model_handles[MODEL_TOPIC_COUNT] = {
+    MODEL_TOPICS(MODEL_TOPIC_HANDLE)
+};
+#undef MODEL_TOPIC_HANDLE
+
+MODEL_STATIC_ASSERT(MODEL_REGISTERED_TOPICS <= PUBSUB_MAX_TOPICS,
+        "PUBSUB_MAX_TOPICS too small for the model topics of CTRL_ZONES zones");
+MODEL_STATIC_ASSERT(MODEL_REGISTERED_NAME_BYTES <= PUBSUB_NAME_ARENA_SIZE,
+        "PUBSUB_NAME_ARENA_SIZE too small for the model topic names of CTRL_ZONES zones");
+
+/** topic handles per zone, zone 0 copies the MODEL_<id>_H handles */
+static pubsub_topic_t model_zones[MODEL_ZONE_COUNT][MODEL_TOPIC_COUNT];
+
+/** Longest topic name */
+#define MODEL_NAME_SIZE 32
+
+/**
+ * Register the zone topics of the zones after zone 0.
  */
+static void model_initialize_zones()
+{
+    for (int id = 0; id < MODEL_TOPIC_COUNT; id++) {
+        model_zones[0][id] = *model_handles[id];
+    }
+    for (int zone = 1; zone < MODEL_ZONE_COUNT; zone++) {
+        for (int id = 0; id < MODEL_TOPIC_COUNT; id++) {
+            const model_topic_t *topic = &model_topics[id];
+            if (!(topic->flags & MODEL_FLAG_ZONE)) {
+                model_zones[zone][id] = *model_handles[id];
+                continue;
+            }
+            char name[MODEL_ZONE_PREFIX_SIZE + MODEL_NAME_SIZE];
+            snprintf(name, sizeof(name), "zone%d.%s", zone + 1, topic->name);
+            model_zones[zone][id] = pubsub_register_topic_filter(name, topic->type, topic->flags & MODEL_FLAG_ALWAYS,
+                    &model_filters[id]);
+            if (model_zones[zone][id] == PUBSUB_TOPIC_INVALID) {
+                ESP_LOGE(TAG, "model_initialize, failed to register topic:%s", name);
+            }
+        }
+    }
+}
 
-const char *MODEL_BEGIN_OF_DAY = "day";
-const char *MODEL_BEGIN_OF_NIGHT = "night";
-
-const char *MODEL_CO2_SV_DAY = "co2.sv.day";
-const char *MODEL_CO2_SV_NIGHT = "co2.sv.night";
-
-const char *MODEL_HUM_SV_DAY = "hum.sv.day";
-const char *MODEL_HUM_SV_NIGHT = "hum.sv.night";
-
-const char *MODEL_TEMP_SV_DAY = "temp.sv.day";
-const char *MODEL_TEMP_SV_NIGHT = "temp.sv.night";
-
-const char *MODEL_EXHAUST_SV = "exhaust.sv";
-const char *MODEL_HEATER_SV = "heater.sv";
-const char *MODEL_LIGHT_SV = "light.sv";
-const char *MODEL_RECIRC_SV = "recirc.sv";
+const pubsub_topic_t* model_zone(uint8_t zone)
+{
+    if (zone >= MODEL_ZONE_COUNT) {
+        return NULL;
+    }
+    return model_zones[zone];
+}
 
 void model_initialize()
 {
-    pubsub_register_topic(MODEL_ACTIVITY, PUBSUB_TYPE_INT, true);
-
-    pubsub_register_topic(MODEL_LIGHT, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_EXHAUST, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_RECIRC, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_HEATER, PUBSUB_TYPE_BOOLEAN, false);
-
-    pubsub_register_topic(MODEL_AM2301_STATUS, PUBSUB_TYPE_INT, true);
-    pubsub_register_topic(MODEL_AM2301_TIMESTAMP, PUBSUB_TYPE_INT, true);
-
-    pubsub_register_topic(MODEL_CIRCADIAN, PUBSUB_TYPE_INT, false);
-
-    pubsub_register_topic(MODEL_CONTROL_MODE, PUBSUB_TYPE_INT, false);
-
-    pubsub_register_topic(MODEL_CO2_HI, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_CO2_LO, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_HUM_HI, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_HUM_LO, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_TEMP_HI, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_TEMP_LO, PUBSUB_TYPE_BOOLEAN, false);
-
-    pubsub_register_topic(MODEL_TEMP_SV_DAY, PUBSUB_TYPE_DOUBLE, false);
-    pubsub_register_topic(MODEL_HUM_SV_DAY, PUBSUB_TYPE_DOUBLE, false);
-    pubsub_register_topic(MODEL_CO2_SV_DAY, PUBSUB_TYPE_DOUBLE, false);
-
-    pubsub_register_topic(MODEL_EXHAUST_SV, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_HEATER_SV, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_LIGHT_SV, PUBSUB_TYPE_BOOLEAN, false);
-    pubsub_register_topic(MODEL_RECIRC_SV, PUBSUB_TYPE_BOOLEAN, false);
-
-    pubsub_register_topic(MODEL_TEMP_PV, PUBSUB_TYPE_DOUBLE, true);
-    pubsub_register_topic(MODEL_HUM_PV, PUBSUB_TYPE_DOUBLE, true);
-    pubsub_register_topic(MODEL_CO2_PV, PUBSUB_TYPE_DOUBLE, true);
-
-    pubsub_register_topic(MODEL_TEMP_SV_NIGHT, PUBSUB_TYPE_DOUBLE, false);
-    pubsub_register_topic(MODEL_HUM_SV_NIGHT, PUBSUB_TYPE_DOUBLE, false);
-    pubsub_register_topic(MODEL_CO2_SV_NIGHT, PUBSUB_TYPE_DOUBLE, false);
-
-    pubsub_register_topic(MODEL_CURRENT_TIME, PUBSUB_TYPE_INT, true);
-    pubsub_register_topic(MODEL_BEGIN_OF_DAY, PUBSUB_TYPE_INT, false);
-    pubsub_register_topic(MODEL_BEGIN_OF_NIGHT, PUBSUB_TYPE_INT, false);
-
-    pubsub_register_topic(MODEL_TEMP_SV, PUBSUB_TYPE_DOUBLE, false);
-    pubsub_register_topic(MODEL_HUM_SV, PUBSUB_TYPE_DOUBLE, false);
-    pubsub_register_topic(MODEL_CO2_SV, PUBSUB_TYPE_DOUBLE, false);
+    for (int id = 0; id < MODEL_TOPIC_COUNT; id++) {
+        const model_topic_t *topic = &model_topics[id];
+        *model_handles[id] = pubsub_register_topic_filter(topic->name, topic->type, topic->flags & MODEL_FLAG_ALWAYS,
+                &model_filters[id]);
+        if (*model_handles[id] == PUBSUB_TOPIC_INVALID) {
+            ESP_LOGE(TAG, "model_initialize, failed to register topic:%s", topic->name);
+        }
+    }
+    model_initialize_zones();
 }
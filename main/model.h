@@ -7,132 +7,275 @@
 extern "C" {
 #endif
 
-#include "pubsub.h"
-
-/******************
- * actuator state
- */
-
-/** Activity indicator (integer) */
-extern const char *MODEL_ACTIVITY;
-
-/** Exhaust fan actuator (boolean) */
-extern const char *MODEL_EXHAUST;
-
-/** Heater actuator (boolean) */
-extern const char *MODEL_HEATER;
-
-/** Light actuator (boolean) */
-extern const char *MODEL_LIGHT;
-
-/** Recirculation fan actuator (boolean) */
-extern const char *MODEL_RECIRC;
-
-/******************
- * sensor state
- */
-
-/** Current time in seconds after epoch (integer, time_t) */
-extern const char *MODEL_CURRENT_TIME;
-
-/** AM2301 status (integer, model_component_status_t) */
-extern const char *MODEL_AM2301_STATUS;
-
-/** AM2301 measurement timestamp (integer) */
-extern const char *MODEL_AM2301_TIMESTAMP;
-
-/** Measured CO2 concentration [ppm] (double) */
-extern const char *MODEL_CO2_PV;
-
-/** Measured humidity [%] (double) */
-extern const char *MODEL_HUM_PV;
-
-/** Measured temperature [K] (double) */
-extern const char *MODEL_TEMP_PV;
-
-/******************
- * controller state
- */
-
-/** Control mode (integer, model_control_mode_t) */
-extern const char *MODEL_CONTROL_MODE;
-
-/** Circadian (integer, model_circadian_t) */
-extern const char *MODEL_CIRCADIAN;
-
-/** Current CO2 concentration setpoint [ppm] (double) */
-extern const char *MODEL_CO2_SV;
-
-/** Current humidity setpoint [%] (double) */
-extern const char *MODEL_HUM_SV;
-
-/** Current temperature setpoint [K] (double) */
-extern const char *MODEL_TEMP_SV;
-
-/** Automatic control CO2 concentration high (boolean) */
-extern const char *MODEL_CO2_HI;
-
-/** Automatic control CO2 concentration low (boolean) */
-extern const char *MODEL_CO2_LO;
+#include <stdint.h>
 
-/** Automatic control humidity high (boolean) */
-extern const char *MODEL_HUM_HI;
+#include "sdkconfig.h"
 
-/** Automatic control humidity low (boolean) */
-extern const char *MODEL_HUM_LO;
-
-/** Automatic control temperature high (boolean) */
-extern const char *MODEL_TEMP_HI;
-
-/** Automatic control temperature low (boolean) */
-extern const char *MODEL_TEMP_LO;
+#include "pubsub.h"
 
-/******************
- * setpoints
- * (user settings)
+/**
+ * Model topics, one line per topic: X(id, name, type, flags).
+ * Generates for each topic:
+ * - MODEL_<id> topic name
+ * - MODEL_<id>_H topic handle (valid after model_initialize)
+ * - MODEL_<id>_ID dense index in model_topics
+ * - MODEL_<id>_TYPE pubsub type, checked at compile time by MODEL_PUBLISH_* and MODEL_LAST_*
+ * - MODEL_TOPIC(id) typed C++ topic (pubsub::Topic<T>)
+ * Types: BOOLEAN, INT (32 bit), INT64 (64 bit INT), TIME (time_t, 64 bit INT), FLOAT, DOUBLE.
+ * Topics with MODEL_FLAG_ZONE exist once per control zone, see model_zone.
  */
+#define MODEL_TOPICS(X) \
+    /* actuator state */ \
+    /* Activity indicator */ \
+    X(ACTIVITY, "activity", INT, MODEL_FLAG_ALWAYS) \
+    /* Publish any value to dump the pubsub trace ring (CONFIG_PUBSUB_TRACE), e.g. after a pubsub_trace_mark */ \
+    X(TRACE_DUMP, "pubsub.trace.dump", INT, MODEL_FLAG_ALWAYS) \
+    /* Exhaust fan actuator */ \
+    X(EXHAUST, "exhaust.out", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Heater actuator */ \
+    X(HEATER, "heater.out", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Light actuator */ \
+    X(LIGHT, "light.out", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Recirculation fan actuator */ \
+    X(RECIRC, "recirc.out", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* actuator demand of the control mode, the actuator follows after minimum on and off time */ \
+    X(EXHAUST_DEMAND, "exhaust.demand", BOOLEAN, MODEL_FLAG_ZONE) \
+    X(HEATER_DEMAND, "heater.demand", BOOLEAN, MODEL_FLAG_ZONE) \
+    X(LIGHT_DEMAND, "light.demand", BOOLEAN, MODEL_FLAG_ZONE) \
+    X(RECIRC_DEMAND, "recirc.demand", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Heater duty cycle of the automatic control, 0..1 */ \
+    X(HEATER_DUTY, "heater.duty", FLOAT, MODEL_FLAG_ZONE) \
+    /* sensor state */ \
+    /* Current time in seconds after epoch (time_t) */ \
+    X(CURRENT_TIME, "time", TIME, MODEL_FLAG_ALWAYS) \
+    /* AM2301 status (model_component_status_t) */ \
+    X(AM2301_STATUS, "am2301.status", INT, MODEL_FLAG_ALWAYS) \
+    /* AM2301 measurement timestamp [us since boot] */ \
+    X(AM2301_TIMESTAMP, "am2301.time", INT64, MODEL_FLAG_ALWAYS) \
+    /* Measured CO2 concentration [ppm] */ \
+    X(CO2_PV, "co2.pv", FLOAT, MODEL_FLAG_ZONE) \
+    /* Measured humidity [%] */ \
+    X(HUM_PV, "hum.pv", FLOAT, MODEL_FLAG_ZONE) \
+    /* Measured temperature [K] */ \
+    X(TEMP_PV, "temp.pv", FLOAT, MODEL_FLAG_ZONE) \
+    /* controller state */ \
+    /* Control mode (model_control_mode_t) */ \
+    X(CONTROL_MODE, "control.mode", INT, MODEL_FLAG_ZONE) \
+    /* Circadian (model_circadian_t) */ \
+    X(CIRCADIAN, "circadian", INT, MODEL_FLAG_ZONE) \
+    /* Current CO2 concentration setpoint [ppm] */ \
+    X(CO2_SV, "co2.sv", FLOAT, MODEL_FLAG_ZONE) \
+    /* Current humidity setpoint [%] */ \
+    X(HUM_SV, "hum.sv", FLOAT, MODEL_FLAG_ZONE) \
+    /* Current temperature setpoint [K] */ \
+    X(TEMP_SV, "temp.sv", FLOAT, MODEL_FLAG_ZONE) \
+    /* Automatic control CO2 concentration high */ \
+    X(CO2_HI, "co2.hi", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Automatic control CO2 concentration low */ \
+    X(CO2_LO, "co2.lo", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Automatic control humidity high */ \
+    X(HUM_HI, "hum.hi", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Automatic control humidity low */ \
+    X(HUM_LO, "hum.lo", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Automatic control temperature high */ \
+    X(TEMP_HI, "temp.hi", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* Automatic control temperature low */ \
+    X(TEMP_LO, "temp.lo", BOOLEAN, MODEL_FLAG_ZONE) \
+    /* setpoints (user settings) */ \
+    /* Begin of day in seconds after epoch (time_t), always in the same day (2000-01-01) */ \
+    X(BEGIN_OF_DAY, "day", TIME, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Begin of night in seconds after epoch (time_t), always in the same day (2000-01-01) */ \
+    X(BEGIN_OF_NIGHT, "night", TIME, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Day time CO2 concentration setpoint [ppm] */ \
+    X(CO2_SV_DAY, "co2.sv.day", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Night time CO2 concentration setpoint [ppm] */ \
+    X(CO2_SV_NIGHT, "co2.sv.night", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Day time humidity setpoint [%] */ \
+    X(HUM_SV_DAY, "hum.sv.day", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Night time humidity setpoint [%] */ \
+    X(HUM_SV_NIGHT, "hum.sv.night", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Day time temperature setpoint [K] */ \
+    X(TEMP_SV_DAY, "temp.sv.day", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Night time temperature setpoint [K] */ \
+    X(TEMP_SV_NIGHT, "temp.sv.night", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Manual control exhaust fan setpoint */ \
+    X(EXHAUST_SV, "exhaust.sv", BOOLEAN, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Manual control heater setpoint */ \
+    X(HEATER_SV, "heater.sv", BOOLEAN, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Manual control light setpoint */ \
+    X(LIGHT_SV, "light.sv", BOOLEAN, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Manual control recirculation fan setpoint */ \
+    X(RECIRC_SV, "recirc.sv", BOOLEAN, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Automatic control CO2 concentration hysteresis band [ppm] */ \
+    X(CO2_BAND, "co2.band", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Automatic control humidity hysteresis band [%] */ \
+    X(HUM_BAND, "hum.band", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Automatic control temperature hysteresis band [K] */ \
+    X(TEMP_BAND, "temp.band", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Actuator minimum on and off time [s] */ \
+    X(EXHAUST_MIN_ON, "exhaust.min.on", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(EXHAUST_MIN_OFF, "exhaust.min.off", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(HEATER_MIN_ON, "heater.min.on", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(HEATER_MIN_OFF, "heater.min.off", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(LIGHT_MIN_ON, "light.min.on", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(LIGHT_MIN_OFF, "light.min.off", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(RECIRC_MIN_ON, "recirc.min.on", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(RECIRC_MIN_OFF, "recirc.min.off", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Heater PID proportional gain [1/K], 0 for on/off control by the temperature indicators */ \
+    X(HEATER_KP, "heater.kp", FLOAT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Heater PID integral and derivative time [s], integral time 0 for none */ \
+    X(HEATER_TI, "heater.ti", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    X(HEATER_TD, "heater.td", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE) \
+    /* Heater time proportioning window [s] */ \
+    X(HEATER_WINDOW, "heater.window", INT, MODEL_FLAG_PERSIST | MODEL_FLAG_ZONE)
 
 /**
- * Begin of day in seconds after epoch (time_t)
- * always in the same day (2000-01-01)
+ * Publish filters, one line per filtered topic: X(id, deadband, relative, min_interval_ms), see pubsub_filter_t.
+ * Sensor jitter inside the deadband does not reach control, HMI and NVS.
  */
-extern const char *MODEL_BEGIN_OF_DAY;
+#define MODEL_FILTERS(X) \
+    /* MHZ19B resolution 1 ppm, accuracy 50 ppm */ \
+    X(CO2_PV, 10.0f, false, 0) \
+    /* AM2301 resolution 0.1 % */ \
+    X(HUM_PV, 0.5f, false, 0) \
+    /* AM2301 resolution 0.1 K */ \
+    X(TEMP_PV, 0.2f, false, 0)
+
+/** Model type to pubsub type, INT64 and TIME are an INT */
+#define MODEL_TYPE_BOOLEAN PUBSUB_TYPE_BOOLEAN
+#define MODEL_TYPE_INT PUBSUB_TYPE_INT
+#define MODEL_TYPE_INT64 PUBSUB_TYPE_INT
+#define MODEL_TYPE_TIME PUBSUB_TYPE_INT
+#define MODEL_TYPE_FLOAT PUBSUB_TYPE_FLOAT
+#define MODEL_TYPE_DOUBLE PUBSUB_TYPE_DOUBLE
+
+/** Topic flags */
+#define MODEL_FLAG_NONE 0
+/** publish always, also when unchanged */
+#define MODEL_FLAG_ALWAYS (1 << 0)
+/** persist in non-volatile storage */
+#define MODEL_FLAG_PERSIST (1 << 1)
+/** one topic per control zone */
+#define MODEL_FLAG_ZONE (1 << 2)
 
 /**
- * Begin of day in seconds after epoch (time_t)
- * always in the same day (2000-01-01)
+ * Control zones (grow spaces), CONFIG_CTRL_ZONES.
+ * Zone 0 uses the model topic names and MODEL_<id>_H handles,
+ * zone n the name prefixed with "zone<n + 1>.", e.g. "zone2.temp.pv".
+ * Topics without MODEL_FLAG_ZONE are shared by all zones.
  */
-extern const char *MODEL_BEGIN_OF_NIGHT;
-
-/** Day time CO2 concentration setpoint [ppm] (double) */
-extern const char *MODEL_CO2_SV_DAY;
-
-/** Night time CO2 concentration setpoint [ppm] (double) */
-extern const char *MODEL_CO2_SV_NIGHT;
-
-/** Day time humidity setpoint [%] (double) */
-extern const char *MODEL_HUM_SV_DAY;
-
-/** Night time humidity setpoint [%] (double) */
-extern const char *MODEL_HUM_SV_NIGHT;
+#define MODEL_ZONE_COUNT CONFIG_CTRL_ZONES
+/** Longest zone topic name prefix, "zone<n>." */
+#define MODEL_ZONE_PREFIX_SIZE 6
+
+#define MODEL_TOPIC_EXTERN(id, name, type, flags) \
+    extern const char *MODEL_##id; \
+    extern pubsub_topic_t MODEL_##id##_H;
+MODEL_TOPICS(MODEL_TOPIC_EXTERN)
+#undef MODEL_TOPIC_EXTERN
+
+/** Dense topic index */
+#define MODEL_TOPIC_ID(id, name, type, flags) MODEL_##id##_ID,
+typedef enum
+{
+    MODEL_TOPICS(MODEL_TOPIC_ID) MODEL_TOPIC_COUNT
+} model_topic_id_t;
+#undef MODEL_TOPIC_ID
 
-/** Day time temperature setpoint [K] (double) */
-extern const char *MODEL_TEMP_SV_DAY;
+/** Topic type as compile time constant */
+#define MODEL_TOPIC_TYPE(id, name, type, flags) MODEL_##id##_TYPE = MODEL_TYPE_##type,
+enum
+{
+    MODEL_TOPICS(MODEL_TOPIC_TYPE)
+};
+#undef MODEL_TOPIC_TYPE
 
-/** Night time temperature setpoint [K] (double) */
-extern const char *MODEL_TEMP_SV_NIGHT;
+/**
+ * Compile time pubsub capacity of the model: topics and interned name bytes of zone 0
+ * (all topics), of each later zone (zone topics, prefixed) and persistent topics of each.
+ */
+#define MODEL_COUNT_ZONE(id, name, type, flags) + (((flags) & MODEL_FLAG_ZONE) ? 1 : 0)
+#define MODEL_COUNT_PERSIST(id, name, type, flags) + (((flags) & MODEL_FLAG_PERSIST) ? 1 : 0)
+#define MODEL_COUNT_ZONE_PERSIST(id, name, type, flags) \
+    + (((flags) & MODEL_FLAG_ZONE) && ((flags) & MODEL_FLAG_PERSIST) ? 1 : 0)
+#define MODEL_COUNT_NAME(id, name, type, flags) + sizeof(name)
+#define MODEL_COUNT_ZONE_NAME(id, name, type, flags) + (((flags) & MODEL_FLAG_ZONE) ? MODEL_ZONE_PREFIX_SIZE + sizeof(name) : 0)
+enum
+{
+    MODEL_ZONE_TOPIC_COUNT = 0 MODEL_TOPICS(MODEL_COUNT_ZONE),
+    MODEL_PERSIST_COUNT = 0 MODEL_TOPICS(MODEL_COUNT_PERSIST),
+    MODEL_ZONE_PERSIST_COUNT = 0 MODEL_TOPICS(MODEL_COUNT_ZONE_PERSIST),
+    MODEL_NAME_BYTES = 0 MODEL_TOPICS(MODEL_COUNT_NAME),
+    MODEL_ZONE_NAME_BYTES = 0 MODEL_TOPICS(MODEL_COUNT_ZONE_NAME)
+};
+#undef MODEL_COUNT_ZONE
+#undef MODEL_COUNT_PERSIST
+#undef MODEL_COUNT_ZONE_PERSIST
+#undef MODEL_COUNT_NAME
+#undef MODEL_COUNT_ZONE_NAME
+
+/** Topics registered by model_initialize */
+#define MODEL_REGISTERED_TOPICS (MODEL_TOPIC_COUNT + (MODEL_ZONE_COUNT - 1) * MODEL_ZONE_TOPIC_COUNT)
+/** Name arena bytes interned by model_initialize */
+#define MODEL_REGISTERED_NAME_BYTES (MODEL_NAME_BYTES + (MODEL_ZONE_COUNT - 1) * MODEL_ZONE_NAME_BYTES)
+
+/** Topic description */
+typedef struct
+{
+    const char *name;
+    pubsub_type_t type;
+    uint8_t flags;
+} model_topic_t;
 
-/** Manual control exhaust fan setpoint (boolean) */
-extern const char *MODEL_EXHAUST_SV;
+/** Topic descriptions, indexed by MODEL_<id>_ID */
+extern const model_topic_t model_topics[MODEL_TOPIC_COUNT];
 
-/** Manual control heater setpoint (boolean) */
-extern const char *MODEL_HEATER_SV;
+#ifdef __cplusplus
+#define MODEL_STATIC_ASSERT static_assert
+#else
+#define MODEL_STATIC_ASSERT _Static_assert
+#endif
 
-/** Manual control light setpoint (boolean) */
-extern const char *MODEL_LIGHT_SV;
+/** Fail to compile when topic id does not have the given type */
+#define MODEL_ASSERT_TYPE(id, type) \
+    MODEL_STATIC_ASSERT((int) MODEL_##id##_TYPE == (int) MODEL_TYPE_##type, "MODEL_" #id " is not " #type)
+
+/** Typed publish by handle, e.g. MODEL_PUBLISH_BOOL(HEATER, true) */
+#define MODEL_PUBLISH_BOOL(id, value) \
+    do { MODEL_ASSERT_TYPE(id, BOOLEAN); pubsub_publish_bool_h(MODEL_##id##_H, value); } while (0)
+#define MODEL_PUBLISH_INT(id, value) \
+    do { MODEL_ASSERT_TYPE(id, INT); pubsub_publish_int_h(MODEL_##id##_H, value); } while (0)
+#define MODEL_PUBLISH_DOUBLE(id, value) \
+    do { MODEL_ASSERT_TYPE(id, DOUBLE); pubsub_publish_double_h(MODEL_##id##_H, value); } while (0)
+#define MODEL_PUBLISH_FLOAT(id, value) \
+    do { MODEL_ASSERT_TYPE(id, FLOAT); pubsub_publish_float_h(MODEL_##id##_H, value); } while (0)
+
+/** Typed last value by handle, e.g. MODEL_LAST_FLOAT(TEMP_PV, &temp_pv) */
+#define MODEL_LAST_BOOL(id, value) \
+    do { MODEL_ASSERT_TYPE(id, BOOLEAN); pubsub_last_bool_h(MODEL_##id##_H, value); } while (0)
+#define MODEL_LAST_INT(id, value) \
+    do { MODEL_ASSERT_TYPE(id, INT); pubsub_last_int_h(MODEL_##id##_H, value); } while (0)
+#define MODEL_LAST_DOUBLE(id, value) \
+    do { MODEL_ASSERT_TYPE(id, DOUBLE); pubsub_last_double_h(MODEL_##id##_H, value); } while (0)
+#define MODEL_LAST_FLOAT(id, value) \
+    do { MODEL_ASSERT_TYPE(id, FLOAT); pubsub_last_float_h(MODEL_##id##_H, value); } while (0)
 
-/** Manual control recirculation fan setpoint (boolean) */
-extern const char *MODEL_RECIRC_SV;
+/**
+ * Typed publish and last value by the topic handles of a zone (model_zone),
+ * e.g. MODEL_ZONE_PUBLISH_BOOL(topics, HEATER, true)
+ */
+#define MODEL_ZONE_PUBLISH_BOOL(topics, id, value) \
+    do { MODEL_ASSERT_TYPE(id, BOOLEAN); pubsub_publish_bool_h((topics)[MODEL_##id##_ID], value); } while (0)
+#define MODEL_ZONE_PUBLISH_INT(topics, id, value) \
+    do { MODEL_ASSERT_TYPE(id, INT); pubsub_publish_int_h((topics)[MODEL_##id##_ID], value); } while (0)
+#define MODEL_ZONE_PUBLISH_FLOAT(topics, id, value) \
+    do { MODEL_ASSERT_TYPE(id, FLOAT); pubsub_publish_float_h((topics)[MODEL_##id##_ID], value); } while (0)
+#define MODEL_ZONE_LAST_BOOL(topics, id, value) \
+    do { MODEL_ASSERT_TYPE(id, BOOLEAN); pubsub_last_bool_h((topics)[MODEL_##id##_ID], value); } while (0)
+#define MODEL_ZONE_LAST_INT(topics, id, value) \
+    do { MODEL_ASSERT_TYPE(id, INT); pubsub_last_int_h((topics)[MODEL_##id##_ID], value); } while (0)
+#define MODEL_ZONE_LAST_FLOAT(topics, id, value) \
+    do { MODEL_ASSERT_TYPE(id, FLOAT); pubsub_last_float_h((topics)[MODEL_##id##_ID], value); } while (0)
 
 /** Control mode */
 typedef enum
@@ -153,9 +296,33 @@ typedef enum
 } model_circadian_t;
 
 void model_initialize();
+/**
+ * Topic handles of a zone, indexed by MODEL_<id>_ID (valid after model_initialize).
+ * @return NULL if zone >= MODEL_ZONE_COUNT.
+ */
+const pubsub_topic_t* model_zone(uint8_t zone);
 
 #ifdef __cplusplus
 }
+
+#include "pubsub.hpp"
+
+/** Model type to C++ value type */
+#define MODEL_VALUE_BOOLEAN bool
+#define MODEL_VALUE_INT int32_t
+#define MODEL_VALUE_INT64 int64_t
+#define MODEL_VALUE_TIME pubsub::Time
+#define MODEL_VALUE_FLOAT float
+#define MODEL_VALUE_DOUBLE double
+
+#define MODEL_TOPIC_VALUE(id, name, type, flags) typedef MODEL_VALUE_##type MODEL_##id##_VALUE;
+MODEL_TOPICS(MODEL_TOPIC_VALUE)
+#undef MODEL_TOPIC_VALUE
+
+/** Typed topic (valid after model_initialize), e.g. MODEL_TOPIC(TEMP_PV) is a pubsub::Topic<float> */
+#define MODEL_TOPIC(id) pubsub::Topic<MODEL_##id##_VALUE>(MODEL_##id##_H)
+/** Typed topic of a zone, e.g. MODEL_ZONE_TOPIC(1, HEATER) is zone2.heater.out */
+#define MODEL_ZONE_TOPIC(zone, id) pubsub::Topic<MODEL_##id##_VALUE>(model_zone(zone)[MODEL_##id##_ID])
 #endif
 
 #endif /* _MODEL_H_ */
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+# The author disclaims copyright to this source code.
+"""
+Rebuild causal chains from a pubsub trace dump (CONFIG_PUBSUB_TRACE).
+
+Reads a console log, uses the lines printed by pubsub_trace_dump:
+    pubsub_trace,<time us>,<event>,<topic or label>,<task>,<task name>,<target>
+
+Links, in order:
+- deliver: to the preceding publish of the topic by the same task,
+  a drop cancels the delivery of the topic to the same queue,
+- receive: to the oldest delivery still queued on the same queue (queues are FIFO),
+- latest: to the earliest delivery to the latest value subscriber since its previous read,
+- publish, mark: to the most recent receive or latest read of the same task,
+  at most --max-gap before it, otherwise the publish starts a chain.
+
+A chain is a path of publishes ending in a mark or in a publish nobody consumed:
+    temp.pv -> temp.hi -> heater -> mcp23s17.write
+Prints per chain path the number of occurrences and latency per hop and end to end.
+
+Usage: pubsub_trace.py [--through NAME] [--list] [--max-gap MS] [log ...]
+"""
+
+import argparse
+import collections
+import fileinput
+import statistics
+import sys
+
+PREFIX = "pubsub_trace,"
+
+
+class Event:
+    def __init__(self, fields):
+        self.time = int(fields[0])
+        self.event = fields[1]
+        self.name = fields[2]
+        self.task = fields[3]
+        self.task_name = fields[4]
+        self.target = fields[5]
+        # publish or mark this event follows from
+        self.cause = None
+        self.consumed = False
+
+
+def parse(lines):
+    events = []
+    for line in lines:
+        start = line.find(PREFIX)
+        if start < 0:
+            continue
+        fields = line[start + len(PREFIX):].strip().split(",")
+        if len(fields) != 6:
+            continue
+        try:
+            events.append(Event(fields))
+        except ValueError:
+            continue
+    return events
+
+
+def link(events, max_gap_us):
+    """Set the cause of each event, see module doc."""
+    last_publish = {}
+    queued = collections.defaultdict(collections.deque)
+    pending = collections.defaultdict(list)
+    last_consume = {}
+    for event in events:
+        if event.event == "deliver":
+            event.cause = last_publish.get((event.task, event.name))
+            queued[event.target].append(event)
+            pending[event.target].append(event)
+        elif event.event == "drop":
+            queue = queued[event.target]
+            for delivery in reversed(queue):
+                if delivery.name == event.name:
+                    queue.remove(delivery)
+                    break
+        elif event.event == "receive":
+            queue = queued[event.target]
+            while queue and queue[0].name != event.name:
+                # dropped oldest or coalesced, not received
+                queue.popleft()
+            if queue:
+                event.cause = queue.popleft().cause
+            pending.pop(event.target, None)
+            last_consume[event.task] = event
+        elif event.event == "latest":
+            deliveries = pending.pop(event.target, [])
+            if deliveries:
+                event.cause = min(deliveries, key=lambda delivery: delivery.time).cause
+            queued.pop(event.target, None)
+            last_consume[event.task] = event
+        elif event.event in ("publish", "mark"):
+            consume = last_consume.get(event.task)
+            if consume is not None and consume.cause is not None and event.time - consume.time <= max_gap_us:
+                event.cause = consume.cause
+                consume.cause.consumed = True
+            if event.event == "publish":
+                last_publish[(event.task, event.name)] = event
+
+
+def chains(events):
+    """Paths from a chain start to each mark or unconsumed publish that has a cause."""
+    result = []
+    for event in events:
+        if event.event not in ("publish", "mark") or event.cause is None:
+            continue
+        if event.event == "publish" and event.consumed:
+            continue
+        path = [event]
+        seen = {id(event)}
+        while path[0].cause is not None and id(path[0].cause) not in seen:
+            seen.add(id(path[0].cause))
+            path.insert(0, path[0].cause)
+        result.append(path)
+    return result
+
+
+def describe(values):
+    return "min:%d p50:%d max:%d" % (min(values), statistics.median_low(values), max(values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pubsub trace causal chains")
+    parser.add_argument("--through", help="only chains with this topic or mark")
+    parser.add_argument("--list", action="store_true", help="print each chain")
+    parser.add_argument("--max-gap", type=float, default=1000.0,
+                        help="longest time from a receive to a publish it causes [ms]")
+    parser.add_argument("logs", nargs="*", help="console logs, default stdin")
+    args = parser.parse_args()
+
+    events = parse(fileinput.input(args.logs))
+    if not events:
+        print("no pubsub_trace lines", file=sys.stderr)
+        return 1
+    link(events, int(args.max_gap * 1000))
+
+    paths = collections.OrderedDict()
+    for path in chains(events):
+        names = tuple(event.name for event in path)
+        if args.through is not None and args.through not in names:
+            continue
+        paths.setdefault(names, []).append(path)
+        if args.list:
+            hops = " -> ".join("%s (+%dus)" % (event.name, event.time - path[index - 1].time) if index > 0
+                               else "%s @%dus" % (event.name, event.time) for index, event in enumerate(path))
+            print(hops)
+
+    for names, instances in paths.items():
+        print("%s, chains:%d" % (" -> ".join(names), len(instances)))
+        for index in range(1, len(names)):
+            latencies = [path[index].time - path[index - 1].time for path in instances]
+            tasks = sorted(set(path[index].task_name for path in instances))
+            print("  %s -> %s [%s] %s us" % (names[index - 1], names[index], ",".join(tasks), describe(latencies)))
+        print("  end to end %s us" % describe([path[-1].time - path[0].time for path in instances]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())